@@ -0,0 +1,166 @@
+// -----------------------------------------------------------------------
+
+// mymap - bench/balance_bench.cpp
+//
+// balance_bench compares mymap's Balance policies: seesaw,
+// alpha 3/4 and 4/5, and scapegoat 2/3 and 3/4, with
+// random and sorted int keys at n/10 and n. For each it
+// reports ns per insert, nodes relinked by rebuilds per
+// insert (mymap_stats), the average and max node depth
+// and ns per get of a present key. The timings come from
+// maps without stats. Keys come from the seeded
+// generator, so a run reproduces. Results are CSV on
+// stdout:
+//
+//   balance_bench [--n N] [--lookups L] [--seed S]
+
+// -----------------------------------------------------------------------
+
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <algorithm>
+#include "mymap.h"
+#include "myrandom.h"
+using namespace std;
+
+// -----------------------------------------------------------------------
+
+struct result {
+    double insertNanos;  // per put
+    double rebuilt;  // nodes relinked per put
+    double averageDepth;  // over all nodes, the root at 1
+    int maxDepth;
+    double getNanos;  // per get
+    long long sum;  // of the values got, keeps the gets
+};
+
+/* _nodeDepths
+ * walks the pre-order (nL, nR) list of checkBalance
+ * from node i at depth, adding up the depths
+*/
+static size_t _nodeDepths(const vector<pair<int, int>>& nodes, size_t i,
+    int depth, long long& total, int& deepest) {
+    total += depth;
+    deepest = max(deepest, depth);
+    size_t next = i + 1;
+    if (nodes[i].first > 0)
+        next = _nodeDepths(nodes, next, depth + 1, total, deepest);
+    if (nodes[i].second > 0)
+        next = _nodeDepths(nodes, next, depth + 1, total, deepest);
+    return next;
+}
+
+/* runBalance
+ * puts keys into a fresh map with Balance, timed
+ * without stats and counted with them, then times get
+ * on every probe and measures the node depths
+*/
+template<typename Balance>
+static result runBalance(const vector<int>& keys, const vector<int>& probes) {
+    typedef allocator<pair<const int, int>> alloc;
+    mymap<int, int, less<int>, alloc, mymap_no_stats, Balance> m;
+
+    auto start = chrono::steady_clock::now();
+    for (size_t i = 0; i < keys.size(); i++)
+        m.put(keys[i], int(i));
+    double insertNanos = chrono::duration<double, nano>(
+        chrono::steady_clock::now() - start).count() / keys.size();
+
+    long long sum = 0;
+    start = chrono::steady_clock::now();
+    for (int k : probes)
+        sum += m.get(k);
+    double getNanos = chrono::duration<double, nano>(
+        chrono::steady_clock::now() - start).count() / probes.size();
+
+    mymap<int, int, less<int>, alloc, mymap_stats, Balance> counted;
+    for (size_t i = 0; i < keys.size(); i++)
+        counted.put(keys[i], int(i));
+
+    // no erases, so nL / nR count every node
+    vector<pair<int, int>> nodes;
+    stringstream ss(m.checkBalance());
+    string line;
+    while (getline(ss, line)) {
+        int key, nL, nR;
+        if (sscanf(line.c_str(), "key: %d, nL: %d, nR: %d", &key, &nL, &nR)
+            == 3)
+            nodes.push_back(make_pair(nL, nR));
+    }
+    long long totalDepth = 0;
+    int maxDepth = 0;
+    if (!nodes.empty())
+        _nodeDepths(nodes, 0, 1, totalDepth, maxDepth);
+
+    return result{insertNanos,
+        double(counted.stats().rebuiltNodes) / keys.size(),
+        nodes.empty() ? 0.0 : double(totalDepth) / nodes.size(), maxDepth,
+        getNanos, sum};
+}
+
+// -----------------------------------------------------------------------
+
+int main(int argc, char* argv[]) {
+    int n = 1000000;
+    int lookups = 1000000;
+    uint64_t seedValue = uint64_t(seed);
+
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--n" && i + 1 < argc) {
+            n = atoi(argv[++i]);
+        } else if (arg == "--lookups" && i + 1 < argc) {
+            lookups = atoi(argv[++i]);
+        } else if (arg == "--seed" && i + 1 < argc) {
+            seedValue = strtoull(argv[++i], nullptr, 10);
+        } else {
+            cerr << "usage: balance_bench [--n N] [--lookups L] [--seed S]"
+                << endl;
+            return 1;
+        }
+    }
+
+    cout << "balance,keys,n,insert_ns,rebuilt_per_insert,avg_depth,"
+        << "max_depth,get_ns" << endl;
+    auto run = [lookups, seedValue](const string& order, int size) {
+        if (size <= 0)
+            return;
+
+        xoshiro256 gen(seedValue);
+        vector<int> keys(size);
+        for (int i = 0; i < size; i++)
+            keys[i] = (order == "sorted") ? i : int(gen() >> 33);
+        vector<int> probes(lookups);
+        for (int& p : probes)
+            p = keys[gen.below(uint64_t(size))];
+
+        auto report = [&order, size](const string& name, const result& r) {
+            cout << name << "," << order << "," << size << ","
+                << r.insertNanos << "," << r.rebuilt << "," << r.averageDepth
+                << "," << r.maxDepth << "," << r.getNanos << endl;
+        };
+        report("seesaw", runBalance<mymap_seesaw_balance>(keys, probes));
+        report("alpha_3_4",
+            runBalance<mymap_alpha_balance<3, 4>>(keys, probes));
+        report("alpha_4_5",
+            runBalance<mymap_alpha_balance<4, 5>>(keys, probes));
+        report("scapegoat_2_3",
+            runBalance<mymap_scapegoat_balance<2, 3>>(keys, probes));
+        report("scapegoat_3_4",
+            runBalance<mymap_scapegoat_balance<3, 4>>(keys, probes));
+    };
+
+    run("random", n / 10);
+    run("sorted", n / 10);
+    run("random", n);
+    run("sorted", n);
+    return 0;
+}
+
+// -----------------------------------------------------------------------
@@ -0,0 +1,42 @@
+// -----------------------------------------------------------------------
+
+// mymap - bench/bench_heap.h
+//
+// heapBytes() for the benchmarks that report memory per
+// entry: the bytes the C heap has handed out, small
+// chunks and mmapped blocks alike. Read with mallinfo2
+// on glibc 2.33 and later, -1 where it cannot be read.
+
+// -----------------------------------------------------------------------
+
+#pragma once
+#include <cstdlib>
+#if defined(__GLIBC__) \
+    && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+#include <malloc.h>
+#define BENCH_HAS_MALLINFO2 1
+#endif
+
+// -----------------------------------------------------------------------
+
+static inline long long heapBytes() {
+#ifdef BENCH_HAS_MALLINFO2
+    struct mallinfo2 info = mallinfo2();
+    return (long long)(info.uordblks + info.hblkhd);
+#else
+    return -1;
+#endif
+}
+
+/* bytesPerEntry
+ * heap growth from before to after over n entries,
+ * -1 where the heap cannot be read
+*/
+static inline double bytesPerEntry(long long before, long long after,
+    int n) {
+    if (before < 0 || n <= 0)
+        return -1;
+    return double(after - before) / n;
+}
+
+// -----------------------------------------------------------------------
@@ -0,0 +1,113 @@
+// -----------------------------------------------------------------------
+
+// mymap - bench/bucket_bench.cpp
+//
+// bucket_bench measures ns per put and per get of a
+// present key for mymap and bucket_mymap (what
+// hybrid_mymap picks for arithmetic keys), with random
+// int keys at n/40, n/4 and n, and ascending keys at n/4.
+// Gets probe random keys either way. Keys come from the
+// seeded generator, so a run reproduces. Results are CSV
+// on stdout:
+//
+//   bucket_bench [--n N] [--lookups L] [--seed S]
+
+// -----------------------------------------------------------------------
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <cstdlib>
+#include <cstdint>
+#include "mymap.h"
+#include "bucket_mymap.h"
+#include "myrandom.h"
+using namespace std;
+
+// -----------------------------------------------------------------------
+
+struct result {
+    double putNanos;  // per put
+    double getNanos;  // per get
+    long long sum;  // of the values got, keeps the gets
+};
+
+/* runMap
+ * times putting keys into a fresh Map, then get on
+ * every probe
+*/
+template<typename Map>
+static result runMap(const vector<int>& keys, const vector<int>& probes) {
+    typedef chrono::steady_clock clock;
+    Map m;
+
+    auto start = clock::now();
+    for (int k : keys)
+        m.put(k, k);
+    auto putDone = clock::now();
+
+    long long sum = 0;
+    for (int k : probes)
+        sum += m.get(k);
+    auto getDone = clock::now();
+
+    return result{
+        chrono::duration<double, nano>(putDone - start).count()
+            / keys.size(),
+        chrono::duration<double, nano>(getDone - putDone).count()
+            / probes.size(),
+        sum};
+}
+
+// -----------------------------------------------------------------------
+
+int main(int argc, char* argv[]) {
+    int n = 4000000;
+    int lookups = 4000000;
+    uint64_t seedValue = uint64_t(seed);
+
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--n" && i + 1 < argc) {
+            n = atoi(argv[++i]);
+        } else if (arg == "--lookups" && i + 1 < argc) {
+            lookups = atoi(argv[++i]);
+        } else if (arg == "--seed" && i + 1 < argc) {
+            seedValue = strtoull(argv[++i], nullptr, 10);
+        } else {
+            cerr << "usage: bucket_bench [--n N] [--lookups L] [--seed S]"
+                << endl;
+            return 1;
+        }
+    }
+
+    cout << "container,keys,n,put_ns,get_ns" << endl;
+    auto run = [lookups, seedValue](const string& order, int size) {
+        if (size <= 0)
+            return;
+
+        xoshiro256 gen(seedValue);
+        vector<int> keys(size);
+        for (int i = 0; i < size; i++)
+            keys[i] = (order == "ascending") ? i : int(gen() >> 33);
+        vector<int> probes(lookups);
+        for (int& p : probes)
+            p = keys[gen.below(uint64_t(size))];
+
+        auto report = [&order, size](const string& name, const result& r) {
+            cout << name << "," << order << "," << size << "," << r.putNanos
+                << "," << r.getNanos << endl;
+        };
+        report("mymap", runMap<mymap<int, int>>(keys, probes));
+        report("bucket_mymap", runMap<bucket_mymap<int, int>>(keys, probes));
+    };
+
+    run("random", n / 40);
+    run("random", n / 4);
+    run("random", n);
+    run("ascending", n / 4);
+    return 0;
+}
+
+// -----------------------------------------------------------------------
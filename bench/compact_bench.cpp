@@ -0,0 +1,112 @@
+// -----------------------------------------------------------------------
+
+// mymap - bench/compact_bench.cpp
+//
+// compact_bench measures compact_mymap's index-linked
+// nodes against mymap's pointer-linked ones: heap bytes
+// per entry and ns per get of a present key, at n/40,
+// n/4 and n random int keys. compact_mymap is run with
+// and without reserve(), whose vector otherwise keeps
+// its doubling slack. Keys come from the seeded
+// generator, so a run reproduces. Results are CSV on
+// stdout:
+//
+//   compact_bench [--n N] [--lookups L] [--seed S]
+
+// -----------------------------------------------------------------------
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <cstdlib>
+#include <cstdint>
+#include "mymap.h"
+#include "compact_mymap.h"
+#include "myrandom.h"
+#include "bench_heap.h"
+using namespace std;
+
+// -----------------------------------------------------------------------
+
+struct result {
+    double bytes;  // heap bytes per entry
+    double getNanos;  // per get
+    long long sum;  // of the values got, keeps the gets
+};
+
+/* runMap
+ * puts keys into a fresh Map (reserving first when
+ * asked), then times get on every probe
+*/
+template<typename Map>
+static result runMap(const vector<int>& keys, const vector<int>& probes,
+    bool reserve) {
+    long long heapBefore = heapBytes();
+    Map m;
+    if (reserve)
+        m.reserve(int(keys.size()));
+    for (int k : keys)
+        m.put(k, k);
+    long long heapAfter = heapBytes();
+
+    long long sum = 0;
+    auto start = chrono::steady_clock::now();
+    for (int k : probes)
+        sum += m.get(k);
+    double nanos = chrono::duration<double, nano>(
+        chrono::steady_clock::now() - start).count() / probes.size();
+
+    return result{bytesPerEntry(heapBefore, heapAfter, m.Size()), nanos,
+        sum};
+}
+
+// -----------------------------------------------------------------------
+
+int main(int argc, char* argv[]) {
+    int n = 4000000;
+    int lookups = 4000000;
+    uint64_t seedValue = uint64_t(seed);
+
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--n" && i + 1 < argc) {
+            n = atoi(argv[++i]);
+        } else if (arg == "--lookups" && i + 1 < argc) {
+            lookups = atoi(argv[++i]);
+        } else if (arg == "--seed" && i + 1 < argc) {
+            seedValue = strtoull(argv[++i], nullptr, 10);
+        } else {
+            cerr << "usage: compact_bench [--n N] [--lookups L] [--seed S]"
+                << endl;
+            return 1;
+        }
+    }
+
+    cout << "container,n,bytes_per_entry,get_ns" << endl;
+    for (int size : {n / 40, n / 4, n}) {
+        if (size <= 0)
+            continue;
+
+        xoshiro256 gen(seedValue);
+        vector<int> keys(size);
+        for (int& k : keys)
+            k = int(gen() >> 33);
+        vector<int> probes(lookups);
+        for (int& p : probes)
+            p = keys[gen.below(uint64_t(size))];
+
+        auto report = [size](const string& name, const result& r) {
+            cout << name << "," << size << "," << r.bytes << ","
+                << r.getNanos << endl;
+        };
+        report("mymap", runMap<mymap<int, int>>(keys, probes, false));
+        report("compact_mymap",
+            runMap<compact_mymap<int, int>>(keys, probes, false));
+        report("compact_mymap_reserve",
+            runMap<compact_mymap<int, int>>(keys, probes, true));
+    }
+    return 0;
+}
+
+// -----------------------------------------------------------------------
@@ -0,0 +1,137 @@
+// -----------------------------------------------------------------------
+
+// mymap - bench/compare_bench.cpp
+//
+// compare_bench measures what a key comparison costs a
+// lookup: string keys that share a long prefix, looked
+// up half present and half absent, in mymap and in
+// std::map. Both count their comparisons, mymap through
+// mymap_stats and std::map through its Compare. Keys
+// come from the seeded generator, so a run reproduces.
+// Results are CSV on stdout:
+//
+//   compare_bench [--n N] [--lookups L] [--seed S]
+
+// -----------------------------------------------------------------------
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <map>
+#include <chrono>
+#include <cstdlib>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <functional>
+#include "mymap.h"
+#include "myrandom.h"
+using namespace std;
+
+// -----------------------------------------------------------------------
+
+/* countingLess
+ * less<string> that counts its calls, for std::map
+*/
+struct countingLess {
+    static long long calls;
+
+    bool operator()(const string& a, const string& b) const {
+        calls++;
+        return a < b;
+    }
+};
+
+long long countingLess::calls = 0;
+
+static string makeKey(uint64_t id) {
+    return "user:session:" + to_string(id);
+}
+
+// -----------------------------------------------------------------------
+
+/* timeLookups
+ * runs contains(key) for every key and returns the
+ * seconds taken and the number found
+*/
+template<typename Contains>
+static pair<double, long long> timeLookups(const vector<string>& keys,
+    Contains contains) {
+    long long found = 0;
+    auto start = chrono::steady_clock::now();
+    for (const string& k : keys)
+        found += contains(k) ? 1 : 0;
+    double seconds = chrono::duration<double>(
+        chrono::steady_clock::now() - start).count();
+    return make_pair(seconds, found);
+}
+
+// -----------------------------------------------------------------------
+
+int main(int argc, char* argv[]) {
+    int n = 200000;
+    int lookups = 1000000;
+    uint64_t seedValue = uint64_t(seed);
+
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--n" && i + 1 < argc) {
+            n = atoi(argv[++i]);
+        } else if (arg == "--lookups" && i + 1 < argc) {
+            lookups = atoi(argv[++i]);
+        } else if (arg == "--seed" && i + 1 < argc) {
+            seedValue = strtoull(argv[++i], nullptr, 10);
+        } else {
+            cerr << "usage: compare_bench [--n N] [--lookups L] [--seed S]"
+                << endl;
+            return 1;
+        }
+    }
+
+    // even ids are in the maps, odd ids miss
+    xoshiro256 gen(seedValue);
+    vector<string> present;
+    present.reserve(n);
+    for (int i = 0; i < n; i++)
+        present.push_back(makeKey(2 * gen.below(uint64_t(8) * n)));
+    vector<string> probes;
+    probes.reserve(lookups);
+    for (int i = 0; i < lookups; i++) {
+        if (gen.below(2) == 0)
+            probes.push_back(present[gen.below(uint64_t(n))]);
+        else
+            probes.push_back(makeKey(2 * gen.below(uint64_t(8) * n) + 1));
+    }
+
+    cout << "container,n,lookups,found,ns_per_lookup,comparisons_per_lookup"
+        << endl;
+    auto report = [n, lookups](const string& name,
+        const pair<double, long long>& r, double comparisons) {
+        cout << name << "," << n << "," << lookups << "," << r.second << ","
+            << r.first * 1e9 / lookups << "," << comparisons << endl;
+    };
+
+    {
+        typedef mymap<string, int, less<string>,
+            allocator<pair<const string, int>>, mymap_stats> statsMap;
+        statsMap m;
+        for (const string& k : present)
+            m.put(k, 1);
+        m.resetStats();
+        auto r = timeLookups(probes,
+            [&m](const string& k) { return m.contains(k); });
+        report("mymap", r, m.stats().comparisonsPerSearch());
+    }
+    {
+        map<string, int, countingLess> m;
+        for (const string& k : present)
+            m[k] = 1;
+        countingLess::calls = 0;
+        auto r = timeLookups(probes,
+            [&m](const string& k) { return m.find(k) != m.end(); });
+        report("std_map", r, double(countingLess::calls) / lookups);
+    }
+    return 0;
+}
+
+// -----------------------------------------------------------------------
@@ -0,0 +1,170 @@
+// -----------------------------------------------------------------------
+
+// mymap - bench/concurrent_bench.cpp
+//
+// concurrent_bench measures read throughput as reader
+// threads are added, 1 up to every core, while one
+// writer keeps putting and erasing: concurrent_mymap
+// against one mymap behind a mutex. Keys come from
+// the seeded generators, so a run reproduces. Results
+// are CSV on stdout:
+//
+//   concurrent_bench [--readers R] [--n N] [--ms T] [--seed S]
+
+// -----------------------------------------------------------------------
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <cstdlib>
+#include <cstdint>
+#include "mymap.h"
+#include "concurrent_mymap.h"
+#include "myrandom.h"
+using namespace std;
+
+// -----------------------------------------------------------------------
+
+/* mutexMap
+ * the baseline: a mymap with one lock around it
+*/
+struct mutexMap {
+    mutex lock;
+    mymap<int, int> map;
+
+    struct reader {
+        mutexMap* m;
+
+        bool contains(int key) {
+            lock_guard<mutex> guard(m->lock);
+            return m->map.contains(key);
+        }
+    };
+
+    reader getReader() { return reader{this}; }
+
+    void put(int key, int value) {
+        lock_guard<mutex> guard(lock);
+        map.put(key, value);
+    }
+
+    void erase(int key) {
+        lock_guard<mutex> guard(lock);
+        map.erase(key);
+    }
+};
+
+// -----------------------------------------------------------------------
+
+struct result {
+    long long reads;
+    long long writes;
+    double seconds;
+};
+
+/* runMixed
+ * fills m with the n even keys, then runs readers
+ * threads doing contains on random keys and one writer
+ * putting and erasing random odd keys, for ms
+ * milliseconds
+*/
+template<typename Map>
+static result runMixed(Map& m, int readers, int n, int ms,
+    uint64_t seedValue) {
+    for (int key = 0; key < 2 * n; key += 2)
+        m.put(key, key);
+
+    atomic<bool> done(false);
+    atomic<long long> reads(0);
+    long long writes = 0;
+
+    vector<thread> threads;
+    for (int t = 0; t < readers; t++) {
+        threads.push_back(thread([&m, &done, &reads, n, seedValue, t] {
+            auto r = m.getReader();
+            xoshiro256 gen(seedValue + uint64_t(t) + 1);
+            long long count = 0;
+
+            while (!done.load(memory_order_relaxed)) {
+                for (int i = 0; i < 256; i++)
+                    r.contains(int(gen.below(uint64_t(2) * n)));
+                count += 256;
+            }
+            reads.fetch_add(count);
+        }));
+    }
+
+    xoshiro256 gen(seedValue);
+    auto start = chrono::steady_clock::now();
+    auto stop = start + chrono::milliseconds(ms);
+    while (chrono::steady_clock::now() < stop) {
+        for (int i = 0; i < 64; i++) {
+            int key = int(gen.below(uint64_t(2) * n));
+            if (key % 2 == 0)
+                m.erase(key + 1);
+            else
+                m.put(key, key);
+        }
+        writes += 64;
+    }
+    done.store(true);
+    for (thread& t : threads)
+        t.join();
+
+    double seconds = chrono::duration<double>(
+        chrono::steady_clock::now() - start).count();
+    return result{reads.load(), writes, seconds};
+}
+
+// -----------------------------------------------------------------------
+
+int main(int argc, char* argv[]) {
+    int maxReaders = max(1, int(thread::hardware_concurrency()));
+    int n = 1000000;
+    int ms = 1000;
+    uint64_t seedValue = uint64_t(seed);
+
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--readers" && i + 1 < argc) {
+            maxReaders = atoi(argv[++i]);
+        } else if (arg == "--n" && i + 1 < argc) {
+            n = atoi(argv[++i]);
+        } else if (arg == "--ms" && i + 1 < argc) {
+            ms = atoi(argv[++i]);
+        } else if (arg == "--seed" && i + 1 < argc) {
+            seedValue = strtoull(argv[++i], nullptr, 10);
+        } else {
+            cerr << "usage: concurrent_bench [--readers R] [--n N] "
+                << "[--ms T] [--seed S]" << endl;
+            return 1;
+        }
+    }
+
+    cout << "container,readers,n,reads_per_sec,writes_per_sec" << endl;
+    auto report = [n](const string& name, int readers, const result& r) {
+        cout << name << "," << readers << "," << n << ","
+            << r.reads / r.seconds << "," << r.writes / r.seconds << endl;
+    };
+
+    for (int readers = 1; readers <= maxReaders; readers++) {
+        {
+            mutexMap m;
+            report("mutex_mymap", readers,
+                runMixed(m, readers, n, ms, seedValue));
+        }
+        {
+            concurrent_mymap<int, int> m;
+            report("concurrent_mymap", readers,
+                runMixed(m, readers, n, ms, seedValue));
+        }
+    }
+    return 0;
+}
+
+// -----------------------------------------------------------------------
@@ -0,0 +1,116 @@
+// -----------------------------------------------------------------------
+
+// mymap - bench/frozen_bench.cpp
+//
+// frozen_bench measures lookups on a frozen_mymap against
+// the live mymap it was frozen from, for int keys (16 to
+// a block, compared a block at a time) and string keys
+// (one to a block, the Eytzinger layout), and what
+// freeze() itself costs. About one lookup in nine hits.
+// Keys come from the seeded generator, so a run
+// reproduces. Results are CSV on stdout:
+//
+//   frozen_bench [--n N] [--lookups L] [--seed S]
+
+// -----------------------------------------------------------------------
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <cstdlib>
+#include <cstdint>
+#include "mymap.h"
+#include "frozen_mymap.h"
+#include "myrandom.h"
+using namespace std;
+
+// -----------------------------------------------------------------------
+
+/* nanosPer
+ * runs contains(key) for every probe and returns the
+ * ns per lookup; found keeps the calls from being
+ * optimized away
+*/
+template<typename K, typename Contains>
+static double nanosPer(const vector<K>& probes, Contains contains,
+    long long& found) {
+    auto start = chrono::steady_clock::now();
+    for (const K& k : probes)
+        found += contains(k) ? 1 : 0;
+    return chrono::duration<double, nano>(
+        chrono::steady_clock::now() - start).count() / probes.size();
+}
+
+/* runKeys
+ * builds a mymap from n random even ids, freezes it
+ * and times lookups of random ids: the odd ones
+ * always miss, the even ones hit now and then
+*/
+template<typename K, typename KeyOf, typename Report>
+static void runKeys(const string& keyName, int n, int lookups,
+    uint64_t seedValue, KeyOf key, Report report) {
+    xoshiro256 gen(seedValue);
+    mymap<K, int> m;
+    for (int i = 0; i < n; i++)
+        m.put(key(2 * gen.below(uint64_t(4) * n)), i);
+
+    vector<K> probes;
+    probes.reserve(lookups);
+    for (int i = 0; i < lookups; i++)
+        probes.push_back(key(gen.below(uint64_t(8) * n)));
+
+    auto start = chrono::steady_clock::now();
+    frozen_mymap<K, int> f = m.freeze();
+    double freezeMillis = chrono::duration<double, milli>(
+        chrono::steady_clock::now() - start).count();
+
+    long long liveFound = 0;
+    long long frozenFound = 0;
+    double live = nanosPer(probes,
+        [&m](const K& k) { return m.contains(k); }, liveFound);
+    double frozen = nanosPer(probes,
+        [&f](const K& k) { return f.contains(k); }, frozenFound);
+
+    report("mymap", keyName, m.Size(), live, 0.0, liveFound);
+    report("frozen_mymap", keyName, f.Size(), frozen, freezeMillis,
+        frozenFound);
+}
+
+// -----------------------------------------------------------------------
+
+int main(int argc, char* argv[]) {
+    int n = 2000000;
+    int lookups = 4000000;
+    uint64_t seedValue = uint64_t(seed);
+
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--n" && i + 1 < argc) {
+            n = atoi(argv[++i]);
+        } else if (arg == "--lookups" && i + 1 < argc) {
+            lookups = atoi(argv[++i]);
+        } else if (arg == "--seed" && i + 1 < argc) {
+            seedValue = strtoull(argv[++i], nullptr, 10);
+        } else {
+            cerr << "usage: frozen_bench [--n N] [--lookups L] [--seed S]"
+                << endl;
+            return 1;
+        }
+    }
+
+    cout << "container,key,n,ns_per_lookup,freeze_ms,found" << endl;
+    auto report = [](const string& name, const string& keyName, int size,
+        double nanos, double freezeMillis, long long found) {
+        cout << name << "," << keyName << "," << size << "," << nanos << ","
+            << freezeMillis << "," << found << endl;
+    };
+
+    runKeys<int>("int", n, lookups, seedValue,
+        [](uint64_t id) { return int(id); }, report);
+    runKeys<string>("string", n, lookups, seedValue,
+        [](uint64_t id) { return "key:" + to_string(id); }, report);
+    return 0;
+}
+
+// -----------------------------------------------------------------------
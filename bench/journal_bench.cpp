@@ -0,0 +1,155 @@
+// -----------------------------------------------------------------------
+
+// mymap - bench/journal_bench.cpp
+//
+// journal_bench measures journaled_mymap's group commit:
+// for each commit window, buffered puts per second from
+// one thread, and puts per second when T threads each
+// put and sync, sharing fsyncs. Then the time to reopen
+// a log of N records, replayed with one putBatch against
+// one put per record. Files go in --dir, which should
+// be on the disk being measured. Keys come from the
+// seeded generator, so a run reproduces. Results are
+// CSV on stdout:
+//
+//   journal_bench [--dir D] [--threads T] [--ms M] [--records N] [--seed S]
+
+// -----------------------------------------------------------------------
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include "mymap.h"
+#include "mymap_journal.h"
+#include "myrandom.h"
+using namespace std;
+
+// -----------------------------------------------------------------------
+
+/* putsPerSecond
+ * runs threads threads putting random keys into a
+ * fresh journaledMap for ms milliseconds, each
+ * syncing after every put when withSync, and
+ * returns the puts per second
+*/
+static double putsPerSecond(const string& dir, long window, int threads,
+    bool withSync, int ms, uint64_t seedValue) {
+    string snapPath = dir + "/journal_bench.snap";
+    string logPath = dir + "/journal_bench.log";
+    remove(snapPath.c_str());
+    remove(logPath.c_str());
+
+    atomic<long long> puts(0);
+    double seconds;
+    {
+        journaled_mymap<int, int> m(snapPath, logPath, window);
+        atomic<bool> done(false);
+
+        auto start = chrono::steady_clock::now();
+        vector<thread> putters;
+        for (int t = 0; t < threads; t++) {
+            putters.push_back(thread([&, t] {
+                xoshiro256 gen(seedValue + uint64_t(t));
+                long long count = 0;
+                while (!done.load(memory_order_relaxed)) {
+                    m.put(int(gen() >> 33), int(count));
+                    if (withSync)
+                        m.sync();
+                    count++;
+                }
+                puts.fetch_add(count);
+            }));
+        }
+        this_thread::sleep_for(chrono::milliseconds(ms));
+        done.store(true);
+        for (thread& p : putters)
+            p.join();
+        m.sync();
+        seconds = chrono::duration<double>(
+            chrono::steady_clock::now() - start).count();
+    }
+    remove(snapPath.c_str());
+    remove(logPath.c_str());
+    return puts.load() / seconds;
+}
+
+// -----------------------------------------------------------------------
+
+int main(int argc, char* argv[]) {
+    string dir = ".";
+    int threads = 4;
+    int ms = 1000;
+    int records = 1000000;
+    uint64_t seedValue = uint64_t(seed);
+
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--dir" && i + 1 < argc) {
+            dir = argv[++i];
+        } else if (arg == "--threads" && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+        } else if (arg == "--ms" && i + 1 < argc) {
+            ms = atoi(argv[++i]);
+        } else if (arg == "--records" && i + 1 < argc) {
+            records = atoi(argv[++i]);
+        } else if (arg == "--seed" && i + 1 < argc) {
+            seedValue = strtoull(argv[++i], nullptr, 10);
+        } else {
+            cerr << "usage: journal_bench [--dir D] [--threads T] [--ms M] "
+                << "[--records N] [--seed S]" << endl;
+            return 1;
+        }
+    }
+
+    cout << "window_us,threads,sync,puts_per_sec" << endl;
+    for (long window : {0L, 100L, 1000L, 10000L}) {
+        cout << window << ",1,no,"
+            << putsPerSecond(dir, window, 1, false, ms, seedValue) << endl;
+        cout << window << "," << threads << ",yes,"
+            << putsPerSecond(dir, window, threads, true, ms, seedValue)
+            << endl;
+    }
+
+    // a log of records puts, then reopened both ways
+    string snapPath = dir + "/journal_bench.snap";
+    string logPath = dir + "/journal_bench.log";
+    remove(snapPath.c_str());
+    remove(logPath.c_str());
+    {
+        journaled_mymap<int, int> m(snapPath, logPath, 10000);
+        xoshiro256 gen(seedValue);
+        for (int i = 0; i < records; i++)
+            m.put(int(gen() >> 33), i);
+    }
+
+    cout << "replay,records,size,ms" << endl;
+    {
+        auto start = chrono::steady_clock::now();
+        journaled_mymap<int, int> m(snapPath, logPath);
+        double millis = chrono::duration<double, milli>(
+            chrono::steady_clock::now() - start).count();
+        cout << "putBatch," << records << "," << m.Size() << "," << millis
+            << endl;
+    }
+    {
+        auto start = chrono::steady_clock::now();
+        mymap<int, int> m;
+        mymap_journal<int, int> journal(logPath,
+            [&m](const int& key, const int& value) { m.put(key, value); });
+        double millis = chrono::duration<double, milli>(
+            chrono::steady_clock::now() - start).count();
+        cout << "put," << records << "," << m.Size() << "," << millis
+            << endl;
+    }
+    remove(snapPath.c_str());
+    remove(logPath.c_str());
+    return 0;
+}
+
+// -----------------------------------------------------------------------
@@ -0,0 +1,110 @@
+// -----------------------------------------------------------------------
+
+// mymap - bench/many_bench.cpp
+//
+// many_bench measures mymap's batched getMany against one
+// get per key, in ns per key, for batches of 1 to 256
+// keys at n, n/10 and n/100 random int keys. Three
+// lookups in four hit. Keys come from the seeded
+// generator, so a run reproduces. Results are CSV on
+// stdout:
+//
+//   many_bench [--n N] [--lookups L] [--seed S]
+
+// -----------------------------------------------------------------------
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <cstdlib>
+#include <cstdint>
+#include <algorithm>
+#include "mymap.h"
+#include "myrandom.h"
+using namespace std;
+
+// -----------------------------------------------------------------------
+
+/* nanosPerKey
+ * hands lookup the probes batch keys at a time and
+ * returns the ns per key
+*/
+template<typename Lookup>
+static double nanosPerKey(const vector<int>& probes, int batch,
+    Lookup lookup) {
+    auto start = chrono::steady_clock::now();
+    for (size_t i = 0; i < probes.size(); i += size_t(batch)) {
+        size_t end = min(probes.size(), i + size_t(batch));
+        lookup(probes.data() + i, probes.data() + end);
+    }
+    return chrono::duration<double, nano>(
+        chrono::steady_clock::now() - start).count() / probes.size();
+}
+
+// -----------------------------------------------------------------------
+
+int main(int argc, char* argv[]) {
+    int n = 1000000;
+    int lookups = 4000000;
+    uint64_t seedValue = uint64_t(seed);
+
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--n" && i + 1 < argc) {
+            n = atoi(argv[++i]);
+        } else if (arg == "--lookups" && i + 1 < argc) {
+            lookups = atoi(argv[++i]);
+        } else if (arg == "--seed" && i + 1 < argc) {
+            seedValue = strtoull(argv[++i], nullptr, 10);
+        } else {
+            cerr << "usage: many_bench [--n N] [--lookups L] [--seed S]"
+                << endl;
+            return 1;
+        }
+    }
+
+    cout << "n,batch,get_ns,getMany_ns,sum" << endl;
+    for (int size : {n, n / 10, n / 100}) {
+        if (size <= 0)
+            continue;
+
+        // even keys are in the map, odd ones miss
+        xoshiro256 gen(seedValue);
+        vector<int> keys(size);
+        mymap<int, int> m;
+        for (int& k : keys) {
+            k = int(gen() >> 33) & ~1;
+            m.put(k, k);
+        }
+        vector<int> probes(lookups);
+        for (int& p : probes) {
+            p = keys[gen.below(uint64_t(size))];
+            if (gen.below(4) == 0)
+                p |= 1;
+        }
+
+        vector<int> values(256);
+        for (int batch : {1, 2, 4, 8, 16, 32, 64, 128, 256}) {
+            long long sum = 0;
+            double get = nanosPerKey(probes, batch,
+                [&m, &sum](const int* first, const int* last) {
+                    for (const int* k = first; k != last; ++k)
+                        sum += m.get(*k);
+                });
+            double getMany = nanosPerKey(probes, batch,
+                [&m, &sum, &values](const int* first, const int* last) {
+                    m.getMany(first, last, values.begin());
+                    for (ptrdiff_t i = 0; i < last - first; i++)
+                        sum -= values[i];
+                });
+
+            // every value is counted in and back out, so sum is 0
+            cout << size << "," << batch << "," << get << "," << getMany
+                << "," << sum << endl;
+        }
+    }
+    return 0;
+}
+
+// -----------------------------------------------------------------------
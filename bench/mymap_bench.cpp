@@ -0,0 +1,248 @@
+// -----------------------------------------------------------------------
+
+// mymap - bench/mymap_bench.cpp
+//
+// mymap_bench times put, get, contains, operator[],
+// iteration, copy and clear of mymap against
+// std::map for every key distribution of myrandom.h
+// and sizes from 1e3 up to a maximum (1e8 at most).
+// Keys come from the seeded xoshiro256 generators,
+// so a run reproduces on any machine. Results are
+// written to stdout as CSV, or JSON with --json:
+//
+//   mymap_bench [--max N] [--seed S] [--json]
+
+// -----------------------------------------------------------------------
+
+#include <iostream>
+#include <map>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <cstdlib>
+#include <cstdint>
+#include "mymap.h"
+#include "myrandom.h"
+using namespace std;
+
+// -----------------------------------------------------------------------
+
+struct result {
+    string container;
+    string operation;
+    string distribution;
+    long long n;
+    double nsPerOp;
+};
+
+static const char* distNames[] = {
+    "uniform", "ascending", "descending", "zipfian", "clustered"
+};
+
+// keeps the optimizer from dropping work whose result is never used
+static volatile long long sink;
+
+// -----------------------------------------------------------------------
+
+// the calls whose names differ between mymap and std::map
+
+static void mapPut(mymap<int, int>& m, int k, int v) { m.put(k, v); }
+
+static void mapPut(map<int, int>& m, int k, int v) { m[k] = v; }
+
+static int mapGet(mymap<int, int>& m, int k) { return m.get(k); }
+
+static int mapGet(map<int, int>& m, int k) {
+    auto it = m.find(k);
+    return (it != m.end()) ? it->second : 0;
+}
+
+static bool mapHas(mymap<int, int>& m, int k) { return m.contains(k); }
+
+static bool mapHas(map<int, int>& m, int k) { return m.count(k) > 0; }
+
+static long long mapSize(mymap<int, int>& m) { return m.Size(); }
+
+static long long mapSize(map<int, int>& m) { return (long long)m.size(); }
+
+// -----------------------------------------------------------------------
+
+/* timeOps
+ * runs work(), which does ops operations, until
+ * at least minOps operations have been timed and
+ * returns the nanoseconds per operation
+*/
+template<typename Work>
+static double timeOps(long long ops, Work work) {
+    const long long minOps = 1000000;
+    long long done = 0;
+    chrono::nanoseconds total(0);
+
+    do {
+        auto start = chrono::steady_clock::now();
+        work();
+        total += chrono::steady_clock::now() - start;
+        done += ops;
+    } while (done < minOps);
+    return double(total.count()) / double(done);
+}
+
+// -----------------------------------------------------------------------
+
+/* timeClear
+ * clear has to be timed without the copy that
+ * refills the map, so it gets its own loop
+*/
+template<typename Map>
+static double timeClear(const Map& m, long long n) {
+    const long long minOps = 1000000;
+    long long done = 0;
+    chrono::nanoseconds total(0);
+
+    do {
+        Map filled(m);
+        auto start = chrono::steady_clock::now();
+        filled.clear();
+        total += chrono::steady_clock::now() - start;
+        done += n;
+    } while (done < minOps);
+    return double(total.count()) / double(done);
+}
+
+// -----------------------------------------------------------------------
+
+/* benchMap
+ * the operation timings of one container, Map is
+ * mymap<int, int> or std::map<int, int>
+*/
+template<typename Map>
+static void benchMap(const string& name, const string& dist,
+    const vector<int>& keys, const vector<int>& probes,
+    vector<result>& results) {
+    long long n = (long long)keys.size();
+
+    auto add = [&](const string& op, double ns) {
+        results.push_back(result{name, op, dist, n, ns});
+    };
+
+    add("put", timeOps(n, [&] {
+        Map m;
+        for (size_t i = 0; i < keys.size(); i++)
+            mapPut(m, keys[i], int(i));
+        sink = sink + mapSize(m);
+    }));
+
+    Map m;
+    for (size_t i = 0; i < keys.size(); i++)
+        mapPut(m, keys[i], int(i));
+
+    add("get", timeOps(n, [&] {
+        long long sum = 0;
+        for (int k : probes)
+            sum += mapGet(m, k);
+        sink = sink + sum;
+    }));
+
+    add("contains", timeOps(n, [&] {
+        long long found = 0;
+        for (int k : probes)
+            found += mapHas(m, k);
+        sink = sink + found;
+    }));
+
+    add("operator[]", timeOps(n, [&] {
+        long long sum = 0;
+        for (int k : probes)
+            sum += m[k]++;
+        sink = sink + sum;
+    }));
+
+    add("iterate", timeOps(n, [&] {
+        long long sum = 0;
+        for (const auto& kv : m)
+            sum += kv.second;
+        sink = sink + sum;
+    }));
+
+    add("copy", timeOps(n, [&] {
+        Map copy(m);
+        sink = sink + mapSize(copy);
+    }));
+
+    add("clear", timeClear(m, n));
+}
+
+// -----------------------------------------------------------------------
+
+static void printCSV(const vector<result>& results) {
+    cout << "container,operation,distribution,n,ns_per_op" << endl;
+    for (const result& r : results)
+        cout << r.container << "," << r.operation << ","
+            << r.distribution << "," << r.n << "," << r.nsPerOp << endl;
+}
+
+static void printJSON(const vector<result>& results) {
+    cout << "[" << endl;
+    for (size_t i = 0; i < results.size(); i++) {
+        const result& r = results[i];
+        cout << "  {\"container\": \"" << r.container
+            << "\", \"operation\": \"" << r.operation
+            << "\", \"distribution\": \"" << r.distribution
+            << "\", \"n\": " << r.n
+            << ", \"ns_per_op\": " << r.nsPerOp << "}"
+            << (i + 1 < results.size() ? "," : "") << endl;
+    }
+    cout << "]" << endl;
+}
+
+// -----------------------------------------------------------------------
+
+int main(int argc, char* argv[]) {
+    long long maxN = 1000000;
+    uint64_t seedValue = uint64_t(seed);
+    bool json = false;
+
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--max" && i + 1 < argc) {
+            maxN = atoll(argv[++i]);
+        } else if (arg == "--seed" && i + 1 < argc) {
+            seedValue = strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--json") {
+            json = true;
+        } else {
+            cerr << "usage: mymap_bench [--max N] [--seed S] [--json]"
+                << endl;
+            return 1;
+        }
+    }
+    if (maxN > 100000000)
+        maxN = 100000000;
+
+    vector<result> results;
+    for (int d = UNIFORM; d <= CLUSTERED; d++) {
+        keyDistribution dist = keyDistribution(d);
+
+        for (long long n = 1000; n <= maxN; n *= 10) {
+            vector<int> keys = randomKeys(dist, int(n), seedValue);
+            // probes hit the stored keys in random order
+            vector<int> probes(keys);
+            xoshiro256 gen(seedValue + 1);
+            for (size_t i = probes.size(); i > 1; i--)
+                swap(probes[i - 1], probes[gen.below(i)]);
+
+            benchMap<mymap<int, int>>("mymap", distNames[d], keys, probes,
+                results);
+            benchMap<map<int, int>>("std::map", distNames[d], keys, probes,
+                results);
+        }
+    }
+
+    if (json)
+        printJSON(results);
+    else
+        printCSV(results);
+    return 0;
+}
+
+// -----------------------------------------------------------------------
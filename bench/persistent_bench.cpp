@@ -0,0 +1,140 @@
+// -----------------------------------------------------------------------
+
+// mymap - bench/persistent_bench.cpp
+//
+// persistent_bench measures what snapshots cost a
+// persistent_mymap under random int puts: ns per put and
+// heap bytes per entry (the snapshots held included)
+// with no snapshots, and with one taken every interval
+// puts, either only the last kept or all of them, next
+// to a plain mymap. Then what taking a snapshot costs
+// against copying a mymap. Keys come from the seeded
+// generator, so a run reproduces. Results are CSV on
+// stdout:
+//
+//   persistent_bench [--n N] [--seed S]
+
+// -----------------------------------------------------------------------
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <cstdlib>
+#include <cstdint>
+#include "mymap.h"
+#include "persistent_mymap.h"
+#include "myrandom.h"
+#include "bench_heap.h"
+using namespace std;
+
+// -----------------------------------------------------------------------
+
+struct result {
+    double putNanos;  // per put
+    double bytes;  // heap bytes per entry, snapshots included
+};
+
+static persistent_mymap<int, int> snapshotOf(
+    const persistent_mymap<int, int>& m) {
+    return m.snapshot();
+}
+
+// mymap has no snapshots; it is only run with none
+static mymap<int, int> snapshotOf(const mymap<int, int>& m) { return m; }
+
+/* runPuts
+ * puts every key into a fresh Map; every interval
+ * puts (0 = never) takes a snapshot, keeping all of
+ * them or only the last
+*/
+template<typename Map>
+static result runPuts(const vector<int>& keys, int interval, bool keepAll) {
+    long long heapBefore = heapBytes();
+    Map m;
+    vector<Map> kept;
+
+    auto start = chrono::steady_clock::now();
+    for (size_t i = 0; i < keys.size(); i++) {
+        m.put(keys[i], int(i));
+        if (interval > 0 && (i + 1) % size_t(interval) == 0) {
+            if (!keepAll)
+                kept.clear();
+            kept.push_back(snapshotOf(m));
+        }
+    }
+    double nanos = chrono::duration<double, nano>(
+        chrono::steady_clock::now() - start).count() / keys.size();
+
+    return result{nanos, bytesPerEntry(heapBefore, heapBytes(), m.Size())};
+}
+
+// -----------------------------------------------------------------------
+
+int main(int argc, char* argv[]) {
+    int n = 1000000;
+    uint64_t seedValue = uint64_t(seed);
+
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--n" && i + 1 < argc) {
+            n = atoi(argv[++i]);
+        } else if (arg == "--seed" && i + 1 < argc) {
+            seedValue = strtoull(argv[++i], nullptr, 10);
+        } else {
+            cerr << "usage: persistent_bench [--n N] [--seed S]" << endl;
+            return 1;
+        }
+    }
+
+    xoshiro256 gen(seedValue);
+    vector<int> keys(n);
+    for (int& k : keys)
+        k = int(gen() >> 33);
+
+    cout << "container,interval,kept,n,put_ns,bytes_per_entry" << endl;
+    auto report = [n](const string& name, int interval, const string& kept,
+        const result& r) {
+        cout << name << "," << interval << "," << kept << "," << n << ","
+            << r.putNanos << "," << r.bytes << endl;
+    };
+
+    typedef persistent_mymap<int, int> persistentMap;
+    report("mymap", 0, "none", runPuts<mymap<int, int>>(keys, 0, false));
+    report("persistent_mymap", 0, "none",
+        runPuts<persistentMap>(keys, 0, false));
+    for (int interval : {n / 10, n / 100, n / 1000}) {
+        if (interval <= 0)
+            continue;
+        report("persistent_mymap", interval, "last",
+            runPuts<persistentMap>(keys, interval, false));
+        report("persistent_mymap", interval, "all",
+            runPuts<persistentMap>(keys, interval, true));
+    }
+
+    // a snapshot against a copy of the same contents
+    persistentMap versioned;
+    mymap<int, int> plain;
+    for (size_t i = 0; i < keys.size(); i++) {
+        versioned.put(keys[i], int(i));
+        plain.put(keys[i], int(i));
+    }
+
+    auto start = chrono::steady_clock::now();
+    persistentMap snapshot = versioned.snapshot();
+    double snapshotNanos = chrono::duration<double, nano>(
+        chrono::steady_clock::now() - start).count();
+
+    start = chrono::steady_clock::now();
+    mymap<int, int> copy(plain);
+    double copyNanos = chrono::duration<double, nano>(
+        chrono::steady_clock::now() - start).count();
+
+    cout << "operation,n,ns" << endl;
+    cout << "persistent_mymap_snapshot," << snapshot.Size() << ","
+        << snapshotNanos << endl;
+    cout << "mymap_copy," << copy.Size() << "," << copyNanos << endl;
+    return 0;
+}
+
+// -----------------------------------------------------------------------
@@ -0,0 +1,135 @@
+// -----------------------------------------------------------------------
+
+// mymap - bench/pool_bench.cpp
+//
+// pool_bench measures what the node pool buys: put and
+// clear times and heap bytes per entry for std::map,
+// which allocates every node on its own, mymap on its
+// slab pool, mymap after reserve(n) and pmr_mymap on a
+// monotonic buffer. Keys are random or ascending, from
+// the seeded generator, so a run reproduces. Results
+// are CSV on stdout:
+//
+//   pool_bench [--n N] [--seed S]
+
+// -----------------------------------------------------------------------
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <map>
+#include <chrono>
+#include <cstdlib>
+#include <cstdint>
+#include "mymap.h"
+#include "myrandom.h"
+#include "bench_heap.h"
+using namespace std;
+
+// -----------------------------------------------------------------------
+
+struct result {
+    double putNanos;  // per put
+    double bytes;  // heap bytes per entry
+    double clearNanos;  // per entry
+};
+
+static void putOne(map<int, int>& m, int key, int value) { m[key] = value; }
+
+template<typename Map>
+static void putOne(Map& m, int key, int value) { m.put(key, value); }
+
+static void reserveFor(map<int, int>&, int) {}
+
+template<typename Map>
+static void reserveFor(Map& m, int n) { m.reserve(n); }
+
+/* timeMap
+ * puts every key into m, reserving first when asked,
+ * then clears it
+*/
+template<typename Map>
+static result timeMap(Map& m, const vector<int>& keys, bool reserve) {
+    typedef chrono::steady_clock clock;
+    long long heapBefore = heapBytes();
+
+    auto start = clock::now();
+    if (reserve)
+        reserveFor(m, int(keys.size()));
+    for (size_t i = 0; i < keys.size(); i++)
+        putOne(m, keys[i], int(i));
+    auto putDone = clock::now();
+    long long heapAfter = heapBytes();
+
+    m.clear();
+    auto clearDone = clock::now();
+
+    double n = double(keys.size());
+    return result{
+        chrono::duration<double, nano>(putDone - start).count() / n,
+        bytesPerEntry(heapBefore, heapAfter, int(keys.size())),
+        chrono::duration<double, nano>(clearDone - putDone).count() / n};
+}
+
+// -----------------------------------------------------------------------
+
+int main(int argc, char* argv[]) {
+    int n = 1000000;
+    uint64_t seedValue = uint64_t(seed);
+
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--n" && i + 1 < argc) {
+            n = atoi(argv[++i]);
+        } else if (arg == "--seed" && i + 1 < argc) {
+            seedValue = strtoull(argv[++i], nullptr, 10);
+        } else {
+            cerr << "usage: pool_bench [--n N] [--seed S]" << endl;
+            return 1;
+        }
+    }
+
+    xoshiro256 gen(seedValue);
+    vector<int> random(n);
+    vector<int> ascending(n);
+    for (int i = 0; i < n; i++) {
+        random[i] = int(gen() >> 33);
+        ascending[i] = i;
+    }
+
+    cout << "container,keys,n,put_ns,bytes_per_entry,clear_ns" << endl;
+    auto report = [n](const string& name, const string& keys,
+        const result& r) {
+        cout << name << "," << keys << "," << n << "," << r.putNanos << ","
+            << r.bytes << "," << r.clearNanos << endl;
+    };
+
+    for (int order = 0; order < 2; order++) {
+        const vector<int>& keys = (order == 0) ? random : ascending;
+        string name = (order == 0) ? "random" : "ascending";
+        {
+            map<int, int> m;
+            report("std_map", name, timeMap(m, keys, false));
+        }
+        {
+            mymap<int, int> m;
+            report("mymap", name, timeMap(m, keys, false));
+        }
+        {
+            mymap<int, int> m;
+            report("mymap_reserve", name, timeMap(m, keys, true));
+        }
+#ifdef MYMAP_HAS_PMR
+        {
+            std::pmr::monotonic_buffer_resource buffer;
+            pmr_mymap<int, int> m{
+                std::pmr::polymorphic_allocator<pair<const int, int>>(
+                    &buffer)};
+            report("pmr_mymap_monotonic", name, timeMap(m, keys, false));
+        }
+#endif
+    }
+    return 0;
+}
+
+// -----------------------------------------------------------------------
@@ -0,0 +1,139 @@
+// -----------------------------------------------------------------------
+
+// mymap - bench/sharded_bench.cpp
+//
+// sharded_bench measures put throughput as writer
+// threads are added, for one mymap behind a mutex,
+// sharded_mymap put and sharded_mymap putBatch.
+// Every thread writes its own seeded stream of keys,
+// so a run reproduces. Results are CSV on stdout:
+//
+//   sharded_bench [--threads T] [--puts N] [--seed S]
+
+// -----------------------------------------------------------------------
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <chrono>
+#include <cstdlib>
+#include <cstdint>
+#include <utility>
+#include <algorithm>
+#include "mymap.h"
+#include "sharded_mymap.h"
+#include "myrandom.h"
+using namespace std;
+
+// -----------------------------------------------------------------------
+
+/* mutexMap
+ * the baseline: a mymap with one lock around it
+*/
+struct mutexMap {
+    mutex lock;
+    mymap<int, int> map;
+
+    void put(int key, int value) {
+        lock_guard<mutex> guard(lock);
+        map.put(key, value);
+    }
+};
+
+// -----------------------------------------------------------------------
+
+/* timeWriters
+ * runs write(thread index, keys) on threads threads
+ * at once, each with puts keys of its own, and
+ * returns the seconds from start to the last join
+*/
+template<typename Write>
+static double timeWriters(int threads, int puts, uint64_t seedValue,
+    Write write) {
+    vector<vector<int>> keys(threads);
+    for (int t = 0; t < threads; t++) {
+        xoshiro256 gen(seedValue + uint64_t(t));
+        keys[t].reserve(puts);
+        for (int i = 0; i < puts; i++)
+            keys[t].push_back(int(gen() >> 33));
+    }
+
+    auto start = chrono::steady_clock::now();
+    vector<thread> writers;
+    for (int t = 0; t < threads; t++)
+        writers.push_back(thread([&write, &keys, t] { write(t, keys[t]); }));
+    for (thread& w : writers)
+        w.join();
+    return chrono::duration<double>(chrono::steady_clock::now() - start)
+        .count();
+}
+
+// -----------------------------------------------------------------------
+
+int main(int argc, char* argv[]) {
+    int maxThreads = max(4, int(thread::hardware_concurrency()));
+    int puts = 200000;
+    uint64_t seedValue = uint64_t(seed);
+
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--threads" && i + 1 < argc) {
+            maxThreads = atoi(argv[++i]);
+        } else if (arg == "--puts" && i + 1 < argc) {
+            puts = atoi(argv[++i]);
+        } else if (arg == "--seed" && i + 1 < argc) {
+            seedValue = strtoull(argv[++i], nullptr, 10);
+        } else {
+            cerr << "usage: sharded_bench [--threads T] [--puts N] "
+                << "[--seed S]" << endl;
+            return 1;
+        }
+    }
+
+    cout << "container,threads,puts,seconds,puts_per_sec" << endl;
+    auto report = [puts](const string& name, int threads, double seconds) {
+        long long total = (long long)threads * puts;
+        cout << name << "," << threads << "," << total << "," << seconds
+            << "," << total / seconds << endl;
+    };
+
+    for (int threads = 1; threads <= maxThreads; threads *= 2) {
+        mutexMap locked;
+        report("mutex_mymap", threads, timeWriters(threads, puts, seedValue,
+            [&locked](int, const vector<int>& keys) {
+                for (int k : keys)
+                    locked.put(k, k);
+            }));
+
+        sharded_mymap<int, int> sharded(maxThreads);
+        report("sharded_put", threads, timeWriters(threads, puts, seedValue,
+            [&sharded](int, const vector<int>& keys) {
+                for (int k : keys)
+                    sharded.put(k, k);
+            }));
+
+        sharded_mymap<int, int> batched(maxThreads);
+        report("sharded_putBatch", threads, timeWriters(threads, puts,
+            seedValue, [&batched](int, const vector<int>& keys) {
+                const size_t batchSize = 256;
+                vector<pair<int, int>> batch;
+                batch.reserve(batchSize);
+                for (int k : keys) {
+                    batch.push_back(make_pair(k, k));
+                    if (batch.size() == batchSize) {
+                        batched.putBatch(batch.begin(), batch.end());
+                        batch.clear();
+                    }
+                }
+                batched.putBatch(batch.begin(), batch.end());
+            }));
+
+        if (threads < maxThreads && threads * 2 > maxThreads)
+            threads = maxThreads / 2;  // end on maxThreads itself
+    }
+    return 0;
+}
+
+// -----------------------------------------------------------------------
@@ -0,0 +1,1053 @@
+// -----------------------------------------------------------------------
+
+// mymap - bucket_mymap.h
+//
+// bucket_mymap.h implements a map for arithmetic keys
+// that keeps sorted runs of keys in leaf buckets and
+// balances a tree of buckets with mymap's seesaw rule.
+// A bucket is searched with a fixed length branch free
+// scan the compiler turns into SIMD compares, so a
+// lookup walks far fewer levels than a node per key.
+// hybrid_mymap picks it for arithmetic keys, mymap
+// otherwise, behind the API the two have in common.
+
+// -----------------------------------------------------------------------
+
+#pragma once
+#include <iostream>
+#include <new>
+#include <vector>
+#include <string>
+#include <sstream>
+#include <utility>
+#include <iterator>
+#include <limits>
+#include <functional>
+#include <algorithm>
+#include <type_traits>
+#include "mymap.h"
+using namespace std;
+
+// -----------------------------------------------------------------------
+
+template<typename keyType, typename valueType>
+class bucket_mymap {
+ private:
+    static_assert(is_arithmetic<keyType>::value,
+        "bucket_mymap needs arithmetic keys, use mymap otherwise");
+
+    // keys of a bucket span two cache lines, 16 to 64 keys
+    static const int bucketSize = (128 / sizeof(keyType) < 16) ? 16
+        : (128 / sizeof(keyType) > 64) ? 64 : int(128 / sizeof(keyType));
+    static const int maxDepth = 128;  // bound on seesaw tree height
+
+    typedef pair<const keyType, valueType> itemType;
+
+    struct BUCKET {
+        keyType keys[bucketSize];  // sorted, unused slots hold padKey()
+        // the pairs iterators yield, constructed in slots [0, count).
+        // keys repeats their keys so _rank scans a plain array
+        alignas(itemType) unsigned char slots[bucketSize][sizeof(itemType)];
+        int count;  // # of keys in use
+        int nL;  // # of buckets in left subtree
+        int nR;  // # of buckets in right subtree
+        BUCKET* left;
+        BUCKET* right;
+        BUCKET* prev;  // previous bucket in key order, nullptr for the first
+        BUCKET* next;  // next bucket in key order, nullptr for the last
+
+        BUCKET() : count(0), nL(0), nR(0), left(nullptr), right(nullptr),
+            prev(nullptr), next(nullptr) {
+            fill(keys, keys + bucketSize, padKey());
+        }
+
+        // copies the pairs, the caller links the copy
+        BUCKET(const BUCKET& other) : count(0), nL(0), nR(0),
+            left(nullptr), right(nullptr), prev(nullptr), next(nullptr) {
+            copy(other.keys, other.keys + bucketSize, keys);
+            for (; count < other.count; count++)
+                new (slots[count]) itemType(other.item(count));
+        }
+
+        BUCKET& operator=(const BUCKET&) = delete;
+
+        ~BUCKET() {
+            for (int i = 0; i < count; i++)
+                item(i).~itemType();
+        }
+
+        itemType& item(int i) {
+            return *reinterpret_cast<itemType*>(slots[i]);
+        }
+
+        const itemType& item(int i) const {
+            return *reinterpret_cast<const itemType*>(slots[i]);
+        }
+
+        keyType minKey() const { return keys[0]; }
+
+        keyType maxKey() const { return keys[count - 1]; }
+    };
+
+    BUCKET* root;  // root of the bucket tree, nullptr if empty
+    BUCKET* head;  // first bucket in key order, nullptr if empty
+    int size;  // # of key/value pairs in bucket_mymap
+    int nBuckets;
+    vector<BUCKET*> subtree;  // scratch for _rebuild, in order
+
+    // ----------------------
+
+    /* padKey
+     * fills unused bucket slots; no key is less
+     * than it, so padding never counts in _rank
+    */
+    static keyType padKey() {
+        return numeric_limits<keyType>::has_infinity
+            ? numeric_limits<keyType>::infinity()
+            : numeric_limits<keyType>::max();
+    }
+
+    // ----------------------
+
+    /* _rank
+     * # of keys in bucket b less than key. always
+     * scans the whole bucket without branching so it
+     * vectorizes into SIMD compares and adds
+    */
+    static int _rank(const BUCKET* b, keyType key) {
+        int rank = 0;
+        for (int i = 0; i < bucketSize; i++)
+            rank += (b->keys[i] < key);
+        return rank;
+    }
+
+    // ----------------------
+
+    /* _findBucket
+     * returns the bucket whose key range holds key,
+     * nullptr if there is none
+    */
+    BUCKET* _findBucket(keyType key) const {
+        BUCKET* curr = root;
+
+        while (curr != nullptr) {
+            if (key < curr->minKey())
+                curr = curr->left;
+            else if (curr->maxKey() < key)
+                curr = curr->right;
+            else
+                return curr;
+        }
+        return nullptr;
+    }
+
+    // ----------------------
+
+    /* _findValue
+     * returns a pointer to key's value, nullptr
+     * if key is not in bucket_mymap
+    */
+    valueType* _findValue(keyType key) const {
+        BUCKET* b = _findBucket(key);
+        if (b == nullptr)
+            return nullptr;
+
+        int i = _rank(b, key);
+        return (i < b->count && b->keys[i] == key) ? &b->item(i).second
+            : nullptr;
+    }
+
+    // ----------------------
+
+    /* _boundBucket
+     * returns the first bucket holding a key not less
+     * than key (greater than key if strict), nullptr if
+     * there is none
+    */
+    BUCKET* _boundBucket(keyType key, bool strict) const {
+        BUCKET* curr = root;
+        BUCKET* bound = nullptr;
+
+        while (curr != nullptr) {
+            if (curr->maxKey() < key || (strict && curr->maxKey() == key)) {
+                curr = curr->right;
+            } else {
+                bound = curr;
+                curr = curr->left;
+            }
+        }
+        return bound;
+    }
+
+    // ----------------------
+
+    /* _lastBucket
+     * returns the last bucket in key order, the
+     * rightmost of the bucket tree
+    */
+    static BUCKET* _lastBucket(BUCKET* curr) {
+        if (curr == nullptr)
+            return nullptr;
+
+        while (curr->right != nullptr)
+            curr = curr->right;
+        return curr;
+    }
+
+    // ----------------------
+
+    /* checkViolater
+     * checks if bucket b violates
+     * seesaw balancing property
+    */
+    static bool checkViolater(const BUCKET* b) {
+        return max(b->nL, b->nR) > 2 * min(b->nL, b->nR) + 1;
+    }
+
+    // ----------------------
+
+    /* _buildBuckets
+     * recursive helper function for _rebuild
+     * links subtree[start, end) into a balanced
+     * subtree, split as mymap splits its nodes
+    */
+    BUCKET* _buildBuckets(int start, int end) {
+        if (start >= end)
+            return nullptr;
+
+        int middle = start + (end - start - 1) / 2;
+        BUCKET* b = subtree[middle];
+
+        b->left = _buildBuckets(start, middle);
+        b->right = _buildBuckets(middle + 1, end);
+        b->nL = middle - start;
+        b->nR = end - middle - 1;
+        return b;
+    }
+
+    // ----------------------
+
+    /* _rebuild
+     * rebalances violater's subtree and links it
+     * below parent (nullptr for the root)
+    */
+    void _rebuild(BUCKET* violater, BUCKET* parent) {
+        BUCKET* first = violater;
+        while (first->left != nullptr)
+            first = first->left;
+
+        subtree.clear();
+        for (int k = violater->nL + violater->nR + 1; k > 0; k--) {
+            subtree.push_back(first);
+            first = first->next;
+        }
+
+        BUCKET* subRoot = _buildBuckets(0, int(subtree.size()));
+        if (parent == nullptr)
+            root = subRoot;
+        else if (parent->left == violater)
+            parent->left = subRoot;
+        else
+            parent->right = subRoot;
+    }
+
+    // ----------------------
+
+    /* _linkBucket
+     * links new bucket b into the bucket tree by
+     * its smallest key, then rebuilds the topmost
+     * bucket on the path that breaks the seesaw rule
+    */
+    void _linkBucket(BUCKET* b) {
+        BUCKET* path[maxDepth];
+        int depth = 0;
+        BUCKET* curr = root;
+
+        while (true) {
+            path[depth++] = curr;
+            if (b->minKey() < curr->minKey()) {
+                curr->nL++;
+                if (curr->left == nullptr) {
+                    curr->left = b;
+                    break;
+                }
+                curr = curr->left;
+            } else {
+                curr->nR++;
+                if (curr->right == nullptr) {
+                    curr->right = b;
+                    break;
+                }
+                curr = curr->right;
+            }
+        }
+        nBuckets++;
+
+        for (int d = 0; d < depth; d++) {
+            if (checkViolater(path[d])) {
+                _rebuild(path[d], (d > 0) ? path[d - 1] : nullptr);
+                break;
+            }
+        }
+    }
+
+    // ----------------------
+
+    /* _moveItem
+     * moves the pair in slot i of bucket from into the
+     * empty slot j of bucket to
+    */
+    static void _moveItem(BUCKET* to, int j, BUCKET* from, int i) {
+        new (to->slots[j]) itemType(std::move(from->item(i)));
+        from->item(i).~itemType();
+        to->keys[j] = from->keys[i];
+    }
+
+    // ----------------------
+
+    /* _shiftIn
+     * opens slot pos of bucket b, which has room,
+     * and stores key / value there
+    */
+    template<typename V>
+    static void _shiftIn(BUCKET* b, int pos, keyType key, V&& value) {
+        for (int i = b->count; i > pos; i--)
+            _moveItem(b, i, b, i - 1);
+        new (b->slots[pos]) itemType(key, std::forward<V>(value));
+        b->keys[pos] = key;
+        b->count++;
+    }
+
+    // ----------------------
+
+    /* _insert
+     * finds key or adds it with value, splitting a
+     * full bucket first. returns the bucket and slot
+     * of key and whether it is new
+    */
+    template<typename V>
+    pair<pair<BUCKET*, int>, bool> _insert(keyType key, V&& value) {
+        if (root == nullptr) {
+            root = head = new BUCKET();
+            nBuckets = 1;
+        }
+
+        // stop at the bucket whose range holds key, or at the bucket
+        // key would extend when it falls between two buckets
+        BUCKET* b = root;
+        while (true) {
+            if (key < b->minKey() && b->left != nullptr)
+                b = b->left;
+            else if (b->count > 0 && b->maxKey() < key && b->right != nullptr)
+                b = b->right;
+            else
+                break;
+        }
+
+        int pos = _rank(b, key);
+        if (pos < b->count && b->keys[pos] == key)
+            return make_pair(make_pair(b, pos), false);
+
+        size++;
+        if (b->count < bucketSize) {
+            _shiftIn(b, pos, key, std::forward<V>(value));
+            return make_pair(make_pair(b, pos), true);
+        }
+
+        // split a full bucket. keys arriving at either end start a new
+        // bucket so ascending and descending loads leave buckets full
+        int from = (pos == bucketSize) ? bucketSize
+            : (pos == 0) ? 0 : bucketSize / 2;
+        BUCKET* upper = new BUCKET();
+        for (int i = from; i < bucketSize; i++) {
+            _moveItem(upper, i - from, b, i);
+            b->keys[i] = padKey();
+        }
+        upper->count = bucketSize - from;
+        b->count = from;
+        upper->prev = b;
+        upper->next = b->next;
+        if (b->next != nullptr)
+            b->next->prev = upper;
+        b->next = upper;
+
+        if (pos > from || (pos == from && from == bucketSize)) {
+            b = upper;
+            pos -= from;
+        }
+        _shiftIn(b, pos, key, std::forward<V>(value));
+        _linkBucket(upper);
+
+        return make_pair(make_pair(b, pos), true);
+    }
+
+    // ----------------------
+
+    /* _unlinkBucket
+     * takes the empty bucket b, which held key, out of
+     * the bucket tree and the list and frees it, then
+     * rebuilds the topmost bucket on the path that
+     * breaks the seesaw rule. a bucket with two
+     * children is replaced by the next bucket, the
+     * leftmost of its right subtree
+    */
+    void _unlinkBucket(BUCKET* b, keyType key) {
+        BUCKET* path[maxDepth];
+        int depth = 0;
+        BUCKET** link = &root;  // the pointer to b
+
+        while (*link != b) {
+            BUCKET* curr = *link;
+            path[depth++] = curr;
+            if (key < curr->minKey()) {
+                curr->nL--;
+                link = &curr->left;
+            } else {
+                curr->nR--;
+                link = &curr->right;
+            }
+        }
+
+        if (b->left == nullptr) {
+            *link = b->right;
+        } else if (b->right == nullptr) {
+            *link = b->left;
+        } else {
+            BUCKET* next = b->next;
+            path[depth++] = next;
+
+            BUCKET** nextLink = &b->right;
+            while (*nextLink != next) {
+                (*nextLink)->nL--;
+                path[depth++] = *nextLink;
+                nextLink = &(*nextLink)->left;
+            }
+            *nextLink = next->right;
+
+            next->left = b->left;
+            next->right = b->right;
+            next->nL = b->nL;
+            next->nR = b->nR - 1;
+            *link = next;
+        }
+
+        if (b->prev != nullptr)
+            b->prev->next = b->next;
+        else
+            head = b->next;
+        if (b->next != nullptr)
+            b->next->prev = b->prev;
+        delete b;
+        nBuckets--;
+
+        for (int d = 0; d < depth; d++) {
+            if (checkViolater(path[d])) {
+                _rebuild(path[d], (d > 0) ? path[d - 1] : nullptr);
+                break;
+            }
+        }
+    }
+
+    // ----------------------
+
+    /* _eraseAt
+     * removes the pair in slot i of bucket b, freeing
+     * b if that empties it. returns the bucket and
+     * slot of the next pair, nullptr at the end
+    */
+    pair<BUCKET*, int> _eraseAt(BUCKET* b, int i) {
+        keyType key = b->keys[i];
+
+        b->item(i).~itemType();
+        for (int j = i + 1; j < b->count; j++)
+            _moveItem(b, j - 1, b, j);
+        b->count--;
+        b->keys[b->count] = padKey();
+        size--;
+
+        if (i < b->count)
+            return make_pair(b, i);
+
+        BUCKET* next = b->next;
+        if (b->count == 0)
+            _unlinkBucket(b, key);
+        return make_pair(next, 0);
+    }
+
+    // ----------------------
+
+    /* _clearBuckets
+     * frees every bucket, following the list
+    */
+    void _clearBuckets() {
+        while (head != nullptr) {
+            BUCKET* next = head->next;
+            delete head;
+            head = next;
+        }
+        root = nullptr;
+        size = 0;
+        nBuckets = 0;
+    }
+
+    // ----------------------
+
+    /* _BSTPrintBalance
+     * recursive helper function for checkBalance
+    */
+    void _BSTPrintBalance(const BUCKET* b, stringstream& temp) const {
+        if (b == nullptr)
+            return;
+
+        temp << "key: " << b->minKey() << ", "
+            << "nL: " << b->nL << ", "
+            << "nR: " << b->nR << endl;
+
+        _BSTPrintBalance(b->left, temp);
+        _BSTPrintBalance(b->right, temp);
+    }
+
+    // ----------------------
+ public:
+    /* iteratorBase:
+     * Walks the pairs in order, bucket by bucket, in both directions and
+     * yields the stored pair<const keyType, valueType>, as mymap's
+     * iterator does. Unlike mymap's, it is invalidated by a put or erase
+     * that shifts or splits its bucket. iterator and const_iterator are
+     * its two flavours.
+    */
+    template<bool isConst>
+    struct iteratorBase {
+     public:
+        typedef bidirectional_iterator_tag iterator_category;
+        typedef pair<const keyType, valueType> value_type;
+        typedef ptrdiff_t difference_type;
+        typedef typename conditional<isConst,
+            const value_type&, value_type&>::type reference;
+        typedef typename conditional<isConst,
+            const value_type*, value_type*>::type pointer;
+
+     private:
+        BUCKET* b;  // current bucket, nullptr at end
+        int i;  // slot in b
+        const bucket_mymap* map;  // used to step back from end()
+
+        friend class bucket_mymap;
+        friend struct iteratorBase<!isConst>;
+
+     public:
+        iteratorBase() : b(nullptr), i(0), map(nullptr) {}
+
+        iteratorBase(BUCKET* bucket, int slot, const bucket_mymap* m)
+            : b(bucket), i(slot), map(m) {}
+
+        // iterator converts to const_iterator
+        iteratorBase(const iteratorBase<false>& other)
+            : b(other.b), i(other.i), map(other.map) {}
+
+        iteratorBase& operator=(const iteratorBase&) = default;
+
+        reference operator *() const { return b->item(i); }
+
+        pointer operator ->() const { return &b->item(i); }
+
+        friend bool operator ==(const iteratorBase& lhs,
+            const iteratorBase& rhs) {
+            return lhs.b == rhs.b && lhs.i == rhs.i;
+        }
+
+        friend bool operator !=(const iteratorBase& lhs,
+            const iteratorBase& rhs) {
+            return !(lhs == rhs);
+        }
+
+        iteratorBase& operator++() {
+            if (++i == b->count) {
+                b = b->next;
+                i = 0;
+            }
+            return *this;
+        }
+
+        iteratorBase operator++(int) {
+            iteratorBase old = *this;
+            ++*this;
+            return old;
+        }
+
+        // from end() this moves to the last pair
+        iteratorBase& operator--() {
+            if (b == nullptr) {
+                b = _lastBucket(map->root);
+                i = b->count - 1;
+            } else if (i > 0) {
+                i--;
+            } else {
+                b = b->prev;
+                i = b->count - 1;
+            }
+            return *this;
+        }
+
+        iteratorBase operator--(int) {
+            iteratorBase old = *this;
+            --*this;
+            return old;
+        }
+    };
+
+    typedef iteratorBase<false> iterator;
+    typedef iteratorBase<true> const_iterator;
+    typedef std::reverse_iterator<iterator> reverse_iterator;
+    typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
+
+    // ----------------------
+
+    /* default constructor :
+     * Creates an empty bucket_mymap.
+     * Time complexity: O(1)
+    */
+    bucket_mymap()
+        : root(nullptr), head(nullptr), size(0), nBuckets(0) {}
+
+    // ----------------------
+
+    /* copy constructor / operator=:
+     * Copies the buckets in order and builds a balanced bucket tree
+     * over them.
+     * Time complexity: O(n)
+    */
+    bucket_mymap(const bucket_mymap& other)
+        : root(nullptr), head(nullptr), size(other.size),
+          nBuckets(other.nBuckets) {
+        BUCKET* tail = nullptr;
+        for (BUCKET* b = other.head; b != nullptr; b = b->next) {
+            BUCKET* copy = new BUCKET(*b);
+            copy->prev = tail;
+            if (tail == nullptr)
+                head = copy;
+            else
+                tail->next = copy;
+            tail = copy;
+            subtree.push_back(copy);
+        }
+        root = _buildBuckets(0, int(subtree.size()));
+    }
+
+    bucket_mymap& operator=(const bucket_mymap& other) {
+        if (this != &other) {
+            bucket_mymap copy(other);
+            swap(copy);
+        }
+        return *this;
+    }
+
+    // ----------------------
+
+    /* move constructor / operator=:
+     * Takes other's buckets, leaving other empty.
+     * Time complexity: O(1), plus freeing this map's buckets
+    */
+    bucket_mymap(bucket_mymap&& other) noexcept
+        : root(nullptr), head(nullptr), size(0), nBuckets(0) {
+        swap(other);
+    }
+
+    bucket_mymap& operator=(bucket_mymap&& other) noexcept {
+        if (this != &other) {
+            _clearBuckets();
+            swap(other);
+        }
+        return *this;
+    }
+
+    ~bucket_mymap() { _clearBuckets(); }
+
+    // ----------------------
+
+    void swap(bucket_mymap& other) noexcept {
+        std::swap(root, other.root);
+        std::swap(head, other.head);
+        std::swap(size, other.size);
+        std::swap(nBuckets, other.nBuckets);
+    }
+
+    // ----------------------
+
+    /* clear:
+     * Empties bucket_mymap, freeing every bucket.
+     * Time complexity: O(n / bucket size)
+    */
+    void clear() { _clearBuckets(); }
+
+    // ----------------------
+
+    /* put:
+     * Inserts the key/value, or updates the value if key is already in
+     * bucket_mymap. A full bucket is split and the new bucket linked
+     * into the bucket tree, rebalanced by the seesaw rule.
+     * Time complexity: O(logn + b + m), where b is the bucket size and m
+     * the # of buckets in the subtree that needs to be re-balanced
+    */
+    void put(keyType key, const valueType& value) {
+        pair<pair<BUCKET*, int>, bool> r = _insert(key, value);
+        if (!r.second)
+            r.first.first->item(r.first.second).second = value;
+    }
+
+    // ----------------------
+
+    /* erase:
+     * Removes key from bucket_mymap, returns the # of keys removed (0 or
+     * 1). A bucket the removal empties is freed and taken out of the
+     * bucket tree, rebalanced by the seesaw rule.
+     * Time complexity: O(log(n / b) + b + m), where m is the # of buckets
+     * in the subtree that needs to be re-balanced
+    */
+    int erase(keyType key) {
+        BUCKET* b = _findBucket(key);
+        if (b == nullptr)
+            return 0;
+
+        int i = _rank(b, key);
+        if (i == b->count || b->keys[i] != key)
+            return 0;
+
+        _eraseAt(b, i);
+        return 1;
+    }
+
+    // ----------------------
+
+    /* erase:
+     * Removes the key/value pair at pos, which must be a valid
+     * dereferenceable iterator, and returns an iterator to the next one.
+     * Time complexity: same as erase(key)
+    */
+    iterator erase(const_iterator pos) {
+        pair<BUCKET*, int> next = _eraseAt(pos.b, pos.i);
+        return iterator(next.first, next.second, this);
+    }
+
+    // ----------------------
+
+    /* contains:
+     * Returns true if the key is in bucket_mymap, return false if not.
+     * Time complexity: O(log(n / b) + b), b compares done in SIMD
+    */
+    bool contains(keyType key) const {
+        return _findValue(key) != nullptr;
+    }
+
+    // ----------------------
+
+    /* get:
+     * Returns the value for the given key; if the key is not found, the
+     * default value, valueType(), is returned (but not added).
+     * Time complexity: O(log(n / b) + b), b compares done in SIMD
+    */
+    const valueType& get(keyType key) const {
+        static const valueType defaultValue = valueType();
+
+        const valueType* value = _findValue(key);
+        return (value != nullptr) ? *value : defaultValue;
+    }
+
+    // ----------------------
+
+    /* getPtr:
+     * Returns a pointer to the value for the given key, nullptr if the
+     * key is not found. Valid until the next insertion.
+     * Time complexity: O(log(n / b) + b)
+    */
+    valueType* getPtr(keyType key) { return _findValue(key); }
+
+    const valueType* getPtr(keyType key) const { return _findValue(key); }
+
+    // ----------------------
+
+    /* operator[]:
+     * Returns the value for the given key, inserting valueType() first
+     * if the key is not found.
+     * Time complexity: same as put.
+    */
+    valueType& operator[](keyType key) {
+        pair<BUCKET*, int> at = _insert(key, valueType()).first;
+        return at.first->item(at.second).second;
+    }
+
+    // ----------------------
+
+    /* Size:
+     * Returns the # of key/value pairs in bucket_mymap, 0 if empty.
+     * O(1)
+    */
+    int Size() const { return this->size; }
+
+    // ----------------------
+
+    /* begin / end:
+     * iterators over the pairs in order, O(1) per step.
+    */
+    iterator begin() { return iterator(head, 0, this); }
+
+    iterator end() { return iterator(nullptr, 0, this); }
+
+    const_iterator begin() const { return const_iterator(head, 0, this); }
+
+    const_iterator end() const { return const_iterator(nullptr, 0, this); }
+
+    const_iterator cbegin() const { return begin(); }
+
+    const_iterator cend() const { return end(); }
+
+    // ----------------------
+
+    /* rbegin / rend:
+     * reverse iterators, from the last pair back to the first.
+     * Time complexity: O(1) per step, O(log(n / b)) to step back from end
+    */
+    reverse_iterator rbegin() { return reverse_iterator(end()); }
+
+    reverse_iterator rend() { return reverse_iterator(begin()); }
+
+    const_reverse_iterator rbegin() const {
+        return const_reverse_iterator(end());
+    }
+
+    const_reverse_iterator rend() const {
+        return const_reverse_iterator(begin());
+    }
+
+    // ----------------------
+
+    /* find:
+     * returns an iterator to key's pair, end() if not found.
+     * Time complexity: O(log(n / b) + b)
+    */
+    iterator find(keyType key) {
+        BUCKET* b = _findBucket(key);
+        if (b == nullptr)
+            return end();
+
+        int i = _rank(b, key);
+        return (i < b->count && b->keys[i] == key) ? iterator(b, i, this)
+            : end();
+    }
+
+    // ----------------------
+
+    /* lower_bound:
+     * returns an iterator to the first pair whose key is not less than
+     * key, end() if there is none.
+     * Time complexity: O(log(n / b) + b)
+    */
+    iterator lower_bound(keyType key) {
+        BUCKET* b = _boundBucket(key, false);
+        return (b != nullptr) ? iterator(b, _rank(b, key), this) : end();
+    }
+
+    // ----------------------
+
+    /* upper_bound:
+     * returns an iterator to the first pair whose key is greater than
+     * key, end() if there is none.
+     * Time complexity: O(log(n / b) + b)
+    */
+    iterator upper_bound(keyType key) {
+        BUCKET* b = _boundBucket(key, true);
+        if (b == nullptr)
+            return end();
+
+        int i = _rank(b, key);
+        return iterator(b, i + (b->keys[i] == key), this);
+    }
+
+    // ----------------------
+
+    /* equal_range:
+     * returns {lower_bound(key), upper_bound(key)}; the range holds the
+     * key's pair if it is in bucket_mymap and is empty otherwise.
+     * Time complexity: O(log(n / b) + b)
+    */
+    pair<iterator, iterator> equal_range(keyType key) {
+        return make_pair(lower_bound(key), upper_bound(key));
+    }
+
+    // ----------------------
+
+    /* forEach:
+     * Calls fn(key, value) for every key in bucket_mymap, in order. fn
+     * may modify the value but must not modify bucket_mymap.
+     * Time complexity: O(n)
+    */
+    template<typename Func>
+    void forEach(Func fn) {
+        for (BUCKET* b = head; b != nullptr; b = b->next) {
+            for (int i = 0; i < b->count; i++)
+                fn(b->item(i).first, b->item(i).second);
+        }
+    }
+
+    // ----------------------
+
+    /* toString:
+     * Returns a string of the entire map, in order, in the format of
+     * mymap::toString.
+     * Time complexity: O(n)
+    */
+    string toString() const {
+        stringstream ss;
+        for (const BUCKET* b = head; b != nullptr; b = b->next) {
+            for (int i = 0; i < b->count; i++) {
+                ss << "key: " << b->item(i).first << " "
+                    << "value: " << b->item(i).second << endl;
+            }
+        }
+        return ss.str();
+    }
+
+    // ----------------------
+
+    /* toVector:
+     * Returns a vector of the entire map, in order.
+     * Time complexity: O(n)
+    */
+    vector<pair<keyType, valueType>> toVector() const {
+        vector<pair<keyType, valueType>> mapVector;
+        mapVector.reserve(size);
+
+        for (const BUCKET* b = head; b != nullptr; b = b->next) {
+            for (int i = 0; i < b->count; i++)
+                mapVector.push_back(make_pair(b->keys[i],
+                    b->item(i).second));
+        }
+        return mapVector;
+    }
+
+    // ----------------------
+
+    /* checkBalance:
+     * Returns the bucket tree in pre-order, each bucket named by its
+     * smallest key, in mymap::checkBalance's format.
+     * Time complexity: O(n / bucket size)
+    */
+    string checkBalance() const {
+        stringstream ss;
+        _BSTPrintBalance(root, ss);
+        return ss.str();
+    }
+};
+
+// -----------------------------------------------------------------------
+
+/* hybrid_mymap:
+ * bucket_mymap for arithmetic keys under the default order, mymap for
+ * everything else, behind the API the two have in common, so code that
+ * compiles for one key type compiles for all: put, get, getPtr,
+ * contains, operator[], erase, find, lower_bound, upper_bound,
+ * equal_range, Size, clear, swap, the iterators (yielding
+ * pair<const keyType, valueType>&), forEach, toString, toVector and
+ * checkBalance. Anything else (split, join, save, ...) is mymap only.
+ * Iterators to keys in a bucket a put or erase changes are invalidated
+ * for arithmetic keys; write as if that held for every key type.
+*/
+template<typename keyType, typename valueType>
+class hybrid_mymap {
+ private:
+    typedef typename conditional<is_arithmetic<keyType>::value,
+        bucket_mymap<keyType, valueType>,
+        mymap<keyType, valueType>>::type engineType;
+
+    engineType engine;
+
+ public:
+    typedef typename engineType::iterator iterator;
+    typedef typename engineType::const_iterator const_iterator;
+    typedef typename engineType::reverse_iterator reverse_iterator;
+    typedef typename engineType::const_reverse_iterator
+        const_reverse_iterator;
+
+    // ----------------------
+
+    void put(const keyType& key, const valueType& value) {
+        engine.put(key, value);
+    }
+
+    const valueType& get(const keyType& key) const { return engine.get(key); }
+
+    valueType* getPtr(const keyType& key) { return engine.getPtr(key); }
+
+    const valueType* getPtr(const keyType& key) const {
+        return engine.getPtr(key);
+    }
+
+    bool contains(const keyType& key) const { return engine.contains(key); }
+
+    valueType& operator[](const keyType& key) { return engine[key]; }
+
+    int erase(const keyType& key) { return engine.erase(key); }
+
+    iterator erase(const_iterator pos) { return engine.erase(pos); }
+
+    // ----------------------
+
+    iterator find(const keyType& key) { return engine.find(key); }
+
+    iterator lower_bound(const keyType& key) {
+        return engine.lower_bound(key);
+    }
+
+    iterator upper_bound(const keyType& key) {
+        return engine.upper_bound(key);
+    }
+
+    pair<iterator, iterator> equal_range(const keyType& key) {
+        return engine.equal_range(key);
+    }
+
+    // ----------------------
+
+    int Size() const { return engine.Size(); }
+
+    void clear() { engine.clear(); }
+
+    void swap(hybrid_mymap& other) noexcept { engine.swap(other.engine); }
+
+    // ----------------------
+
+    iterator begin() { return engine.begin(); }
+
+    iterator end() { return engine.end(); }
+
+    const_iterator begin() const { return engine.begin(); }
+
+    const_iterator end() const { return engine.end(); }
+
+    const_iterator cbegin() const { return engine.begin(); }
+
+    const_iterator cend() const { return engine.end(); }
+
+    reverse_iterator rbegin() { return engine.rbegin(); }
+
+    reverse_iterator rend() { return engine.rend(); }
+
+    const_reverse_iterator rbegin() const { return engine.rbegin(); }
+
+    const_reverse_iterator rend() const { return engine.rend(); }
+
+    // ----------------------
+
+    template<typename Func>
+    void forEach(Func fn) { engine.forEach(fn); }
+
+    string toString() const { return engine.toString(); }
+
+    vector<pair<keyType, valueType>> toVector() const {
+        return engine.toVector();
+    }
+
+    string checkBalance() const { return engine.checkBalance(); }
+};
+
+// -----------------------------------------------------------------------
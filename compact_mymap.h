@@ -0,0 +1,474 @@
+// -----------------------------------------------------------------------
+
+// mymap - compact_mymap.h
+//
+// compact_mymap.h implements the seesaw balanced threaded
+// BST of mymap with its nodes stored in one vector and
+// linked by 32 bit indices instead of pointers. The thread
+// flag lives in the top bit of the right index and a node
+// keeps one subtree count, so an int -> int entry takes 20
+// bytes instead of mymap's 40.
+
+// -----------------------------------------------------------------------
+
+#pragma once
+#include <iostream>
+#include <vector>
+#include <string>
+#include <sstream>
+#include <utility>
+#include <tuple>
+#include <functional>
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+using namespace std;
+
+// -----------------------------------------------------------------------
+
+template<typename keyType, typename valueType,
+    typename Compare = less<keyType>>
+class compact_mymap {
+ private:
+    static const uint32_t threadBit = 0x80000000u;  // right is a thread
+    static const uint32_t nil = 0x7fffffffu;  // no node
+    static const int maxDepth = 128;  // bound on seesaw tree height
+
+    struct NODE {
+        // key used to build BST and stored data for the map
+        pair<const keyType, valueType> data;
+        uint32_t left;  // index of left child, nil if none
+        uint32_t right;  // index of right child, or thread | threadBit
+        uint32_t count;  // number of nodes in this subtree, itself included
+
+        template<typename K, typename V>
+        NODE(K&& k, V&& v)
+            : data(std::forward<K>(k), std::forward<V>(v)),
+              left(nil), right(nil | threadBit), count(1) {}
+
+        bool isThreaded() const { return (right & threadBit) != 0; }
+
+        uint32_t rightIndex() const { return right & ~threadBit; }
+    };
+
+    vector<NODE> nodes;  // every node, in insertion order
+    uint32_t root;  // index of root node of the BST, nil if empty
+    Compare comp;  // orders the keys
+    vector<uint32_t> subtree;  // scratch for _rebuild, in order
+
+    // ----------------------
+
+    /* _count / _nL / _nR
+     * subtree sizes; nR follows from the node's count
+    */
+    uint32_t _count(uint32_t i) const {
+        return (i == nil) ? 0 : nodes[i].count;
+    }
+
+    uint32_t _nL(uint32_t i) const { return _count(nodes[i].left); }
+
+    uint32_t _nR(uint32_t i) const {
+        return nodes[i].count - _nL(i) - 1;
+    }
+
+    // ----------------------
+
+    /* _firstNode / _nextInorder
+     * leftmost node of i's subtree and the in-order
+     * successor of i, following the thread if any
+    */
+    uint32_t _firstNode(uint32_t i) const {
+        if (i == nil)
+            return nil;
+
+        while (nodes[i].left != nil)
+            i = nodes[i].left;
+        return i;
+    }
+
+    uint32_t _nextInorder(uint32_t i) const {
+        if (nodes[i].isThreaded())
+            return nodes[i].rightIndex();
+
+        return _firstNode(nodes[i].rightIndex());
+    }
+
+    // ----------------------
+
+    /* _findNode
+     * returns the index of the node holding key,
+     * nil if key is not in compact_mymap
+    */
+    uint32_t _findNode(const keyType& key) const {
+        uint32_t curr = root;
+
+        while (curr != nil) {
+            const NODE& n = nodes[curr];
+            if (comp(key, n.data.first))
+                curr = n.left;
+            else if (comp(n.data.first, key))
+                curr = n.isThreaded() ? nil : n.rightIndex();
+            else
+                return curr;
+        }
+        return nil;
+    }
+
+    // ----------------------
+
+    /* checkViolater
+     * checks if node i violates
+     * seesaw balancing property
+    */
+    bool checkViolater(uint32_t i) const {
+        uint32_t nL = _nL(i);
+        uint32_t nR = _nR(i);
+        return max(nL, nR) > 2 * min(nL, nR) + 1;
+    }
+
+    // ----------------------
+
+    /* _buildNodes
+     * recursive helper function for _rebuild
+     * links subtree[start, end) into a balanced
+     * subtree, splitting like mymap does, so both
+     * build the same shape
+    */
+    uint32_t _buildNodes(uint32_t start, uint32_t end, uint32_t successor) {
+        if (start >= end)
+            return nil;
+
+        uint32_t n = end - start;
+        uint32_t middle = start + (n - 1) / 2;
+        uint32_t i = subtree[middle];
+
+        nodes[i].left = _buildNodes(start, middle, i);
+        uint32_t right = _buildNodes(middle + 1, end, successor);
+        nodes[i].right = (right != nil) ? right : (successor | threadBit);
+        nodes[i].count = n;
+        return i;
+    }
+
+    // ----------------------
+
+    /* _rebuild
+     * rebalances violater's subtree and links it
+     * below parent (nil for the root)
+    */
+    void _rebuild(uint32_t violater, uint32_t parent) {
+        subtree.clear();
+        uint32_t curr = _firstNode(violater);
+        for (uint32_t k = 0; k < nodes[violater].count; k++) {
+            subtree.push_back(curr);
+            curr = _nextInorder(curr);
+        }
+
+        // the last node of the subtree threads to its successor
+        uint32_t successor = nodes[subtree.back()].rightIndex();
+        uint32_t subRoot = _buildNodes(0, uint32_t(subtree.size()),
+            successor);
+
+        if (parent == nil)
+            root = subRoot;
+        else if (nodes[parent].left == violater)
+            nodes[parent].left = subRoot;
+        else
+            nodes[parent].right = subRoot;
+    }
+
+    // ----------------------
+
+    /* _insert
+     * finds key or links a new node built from
+     * (key, value) in, then rebuilds the topmost
+     * node on the path that breaks the seesaw rule.
+     * returns the key's index and whether it is new
+    */
+    template<typename K, typename V>
+    pair<uint32_t, bool> _insert(K&& key, V&& value) {
+        uint32_t path[maxDepth];
+        int depth = 0;
+        uint32_t curr = root;
+        bool goLeft = false;
+
+        while (curr != nil) {
+            const NODE& n = nodes[curr];
+            if (comp(key, n.data.first))
+                goLeft = true;
+            else if (comp(n.data.first, key))
+                goLeft = false;
+            else
+                return make_pair(curr, false);
+
+            path[depth++] = curr;
+            curr = goLeft ? n.left : (n.isThreaded() ? nil : n.rightIndex());
+        }
+
+        if (nodes.size() >= nil)
+            throw length_error("compact_mymap: too many keys");
+
+        uint32_t added = uint32_t(nodes.size());
+        nodes.emplace_back(std::forward<K>(key), std::forward<V>(value));
+
+        if (depth == 0) {
+            root = added;
+            return make_pair(added, true);
+        }
+
+        // link below the last node on the path, threads as in mymap
+        NODE& prev = nodes[path[depth - 1]];
+        if (goLeft) {
+            prev.left = added;
+            nodes[added].right = path[depth - 1] | threadBit;
+        } else {
+            nodes[added].right = prev.right;
+            prev.right = added;
+        }
+
+        for (int d = 0; d < depth; d++)
+            nodes[path[d]].count++;
+
+        for (int d = 0; d < depth; d++) {
+            if (checkViolater(path[d])) {
+                _rebuild(path[d], (d > 0) ? path[d - 1] : nil);
+                break;
+            }
+        }
+        return make_pair(added, true);
+    }
+
+    // ----------------------
+
+    /* _BSTPrintBalance
+     * recursive helper function for checkBalance
+    */
+    void _BSTPrintBalance(uint32_t i, stringstream& temp) const {
+        if (i == nil)
+            return;
+
+        temp << "key: " << nodes[i].data.first << ", "
+            << "nL: " << _nL(i) << ", "
+            << "nR: " << _nR(i) << endl;
+
+        _BSTPrintBalance(nodes[i].left, temp);
+        if (!nodes[i].isThreaded())
+            _BSTPrintBalance(nodes[i].rightIndex(), temp);
+    }
+
+    // ----------------------
+ public:
+    /* iterator:
+     * Walks the pairs in order along the threads, like mymap's iterator
+     * (forward only).
+    */
+    template<bool isConst>
+    struct iteratorBase {
+     public:
+        typedef forward_iterator_tag iterator_category;
+        typedef pair<const keyType, valueType> value_type;
+        typedef ptrdiff_t difference_type;
+        typedef typename conditional<isConst,
+            const value_type&, value_type&>::type reference;
+        typedef typename conditional<isConst,
+            const value_type*, value_type*>::type pointer;
+
+     private:
+        typedef typename conditional<isConst,
+            const compact_mymap*, compact_mymap*>::type mapPointer;
+
+        mapPointer map;
+        uint32_t curr;  // index of current in-order node, nil at end
+
+     public:
+        iteratorBase(mapPointer m, uint32_t i) : map(m), curr(i) {}
+
+        reference operator *() const { return map->nodes[curr].data; }
+
+        pointer operator ->() const { return &map->nodes[curr].data; }
+
+        bool operator ==(const iteratorBase& rhs) const {
+            return curr == rhs.curr;
+        }
+
+        bool operator !=(const iteratorBase& rhs) const {
+            return curr != rhs.curr;
+        }
+
+        iteratorBase& operator++() {
+            curr = map->_nextInorder(curr);
+            return *this;
+        }
+
+        iteratorBase operator++(int) {
+            iteratorBase old = *this;
+            ++*this;
+            return old;
+        }
+    };
+
+    typedef iteratorBase<false> iterator;
+    typedef iteratorBase<true> const_iterator;
+
+    // ----------------------
+
+    /* default constructor :
+     * Creates an empty compact_mymap.
+     * Time complexity: O(1)
+    */
+    explicit compact_mymap(const Compare& compare = Compare())
+        : root(nil), comp(compare) {}
+
+    // ----------------------
+
+    /* put:
+     * Inserts the key/value, or updates the value if key is already in
+     * compact_mymap. Balancing follows mymap::put exactly.
+     * Time complexity: O(logn + m), where m is the size of the subtree
+     * that needs to be re-balanced; amortized O(1) extra when the node
+     * vector grows.
+    */
+    void put(const keyType& key, const valueType& value) {
+        pair<uint32_t, bool> r = _insert(key, value);
+        if (!r.second)
+            nodes[r.first].data.second = value;
+    }
+
+    // ----------------------
+
+    /* contains:
+     * Returns true if the key is in compact_mymap, return false if not.
+     * Time complexity: O(logn)
+    */
+    bool contains(const keyType& key) const {
+        return _findNode(key) != nil;
+    }
+
+    // ----------------------
+
+    /* get:
+     * Returns the value for the given key; if the key is not found, the
+     * default value, valueType(), is returned (but not added).
+     * Time complexity: O(logn)
+    */
+    const valueType& get(const keyType& key) const {
+        static const valueType defaultValue = valueType();
+
+        uint32_t i = _findNode(key);
+        return (i != nil) ? nodes[i].data.second : defaultValue;
+    }
+
+    // ----------------------
+
+    /* getPtr:
+     * Returns a pointer to the value for the given key, nullptr if the
+     * key is not found. Valid until the next insertion.
+     * Time complexity: O(logn)
+    */
+    valueType* getPtr(const keyType& key) {
+        uint32_t i = _findNode(key);
+        return (i != nil) ? &nodes[i].data.second : nullptr;
+    }
+
+    // ----------------------
+
+    /* operator[]:
+     * Returns the value for the given key, inserting valueType() first
+     * if the key is not found.
+     * Time complexity: same as put.
+    */
+    valueType& operator[](const keyType& key) {
+        return nodes[_insert(key, valueType()).first].data.second;
+    }
+
+    // ----------------------
+
+    /* Size:
+     * Returns the # of key/value pairs in compact_mymap, 0 if empty.
+     * O(1)
+    */
+    int Size() const { return int(nodes.size()); }
+
+    // ----------------------
+
+    /* reserve:
+     * Sets aside room for n nodes, so building a map of known size
+     * never copies the node vector.
+     * Time complexity: O(n)
+    */
+    void reserve(int n) {
+        if (n > 0)
+            nodes.reserve(size_t(n));
+    }
+
+    // ----------------------
+
+    /* clear:
+     * Empties compact_mymap, keeping the node vector's capacity.
+     * Time complexity: O(n)
+    */
+    void clear() {
+        nodes.clear();
+        root = nil;
+    }
+
+    // ----------------------
+
+    /* begin / end:
+     * iterators over the pairs in order, O(1) amortized per step.
+    */
+    iterator begin() { return iterator(this, _firstNode(root)); }
+
+    iterator end() { return iterator(this, nil); }
+
+    const_iterator begin() const {
+        return const_iterator(this, _firstNode(root));
+    }
+
+    const_iterator end() const { return const_iterator(this, nil); }
+
+    // ----------------------
+
+    /* toString:
+     * Returns a string of the entire map, in order, in the format of
+     * mymap::toString.
+     * Time complexity: O(n)
+    */
+    string toString() const {
+        stringstream ss;
+        for (uint32_t i = _firstNode(root); i != nil; i = _nextInorder(i)) {
+            ss << "key: " << nodes[i].data.first << " "
+                << "value: " << nodes[i].data.second << endl;
+        }
+        return ss.str();
+    }
+
+    // ----------------------
+
+    /* toVector:
+     * Returns a vector of the entire map, in order.
+     * Time complexity: O(n)
+    */
+    vector<pair<keyType, valueType>> toVector() const {
+        vector<pair<keyType, valueType>> mapVector;
+        mapVector.reserve(nodes.size());
+
+        for (uint32_t i = _firstNode(root); i != nil; i = _nextInorder(i))
+            mapVector.push_back(nodes[i].data);
+        return mapVector;
+    }
+
+    // ----------------------
+
+    /* checkBalance:
+     * Returns the tree in pre-order in mymap::checkBalance's format; for
+     * the same puts both maps give the same string.
+     * Time complexity: O(n)
+    */
+    string checkBalance() const {
+        stringstream ss;
+        _BSTPrintBalance(root, ss);
+        return ss.str();
+    }
+};
+
+// -----------------------------------------------------------------------
@@ -0,0 +1,612 @@
+// -----------------------------------------------------------------------
+
+// mymap - concurrent_mymap.h
+//
+// concurrent_mymap.h implements a seesaw balanced BST
+// that any number of threads can read lock free while
+// a writer puts or erases. Writers copy the root-to-leaf
+// path (and any rebuilt subtree) and publish a new root
+// atomically;
+// replaced nodes are freed once no reader can see them
+// (epoch based reclamation).
+
+// -----------------------------------------------------------------------
+
+#pragma once
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <utility>
+#include <cstdint>
+using namespace std;
+
+// -----------------------------------------------------------------------
+
+template<typename keyType, typename valueType>
+class concurrent_mymap {
+ private:
+    // nodes are immutable once published. there are no threads: a thread
+    // would point into the old version of a node after path copying
+    struct NODE {
+        const keyType key;  // used to build BST
+        const valueType value;  // stored data for the map
+        NODE* left;  // links to left child
+        NODE* right;  // links to right child
+        int nL;  // number of nodes in left subtree
+        int nR;  // number of nodes in right subtree
+
+        NODE(const keyType& k, const valueType& v, NODE* l, NODE* r,
+            int numLeft, int numRight)
+            : key(k), value(v), left(l), right(r),
+              nL(numLeft), nR(numRight) {}
+    };
+
+    struct retiredNode {
+        NODE* node;
+        uint64_t epoch;  // epoch in which node was unlinked
+    };
+
+    // one per reading thread, epoch is 0 while the thread is not reading
+    struct readerRecord {
+        atomic<uint64_t> epoch;
+        atomic<bool> inUse;
+        int depth;  // nested reads by the owning thread
+        readerRecord* next;
+
+        readerRecord() : epoch(0), inUse(true), depth(0), next(nullptr) {}
+    };
+
+    static const size_t reclaimBatch = 64;  // retired nodes per reclaim
+    static const int maxDepth = 128;  // bound on seesaw tree height
+
+    atomic<NODE*> root;  // pointer to root node of the published BST
+    atomic<int> size;  // # of key/value pairs in the map
+    atomic<uint64_t> globalEpoch;
+    atomic<readerRecord*> readers;  // every record ever claimed
+    mutex writeLock;  // serializes writers
+
+    // writer only state, guarded by writeLock
+    vector<retiredNode> retired;
+    vector<NODE*> path;
+    vector<NODE*> spine;  // path to the node that replaces an erased one
+    vector<NODE*> subtree;
+
+    // ----------------------
+
+    /* _claimRecord
+     * reuses a free reader record or adds a new one,
+     * lock free
+    */
+    readerRecord* _claimRecord() {
+        for (readerRecord* r = readers.load(); r != nullptr; r = r->next) {
+            bool expected = false;
+            if (!r->inUse.load() &&
+                r->inUse.compare_exchange_strong(expected, true))
+                return r;
+        }
+
+        readerRecord* r = new readerRecord();
+        readerRecord* head = readers.load();
+        do {
+            r->next = head;
+        } while (!readers.compare_exchange_weak(head, r));
+        return r;
+    }
+
+    // ----------------------
+
+    /* _enter / _exit
+     * mark a reader active in the current epoch. the
+     * seq_cst store before loading root pairs with the
+     * writer's publish and reclaim scan
+    */
+    NODE* _enter(readerRecord* r) {
+        if (r->depth++ == 0)
+            r->epoch.store(globalEpoch.load());
+        return root.load();
+    }
+
+    void _exit(readerRecord* r) {
+        if (--r->depth == 0)
+            r->epoch.store(0);
+    }
+
+    // ----------------------
+
+    static NODE* _findNode(NODE* curr, const keyType& key) {
+        while (curr != nullptr) {
+            if (key < curr->key)
+                curr = curr->left;
+            else if (curr->key < key)
+                curr = curr->right;
+            else
+                return curr;
+        }
+        return nullptr;
+    }
+
+    // ----------------------
+
+    /* checkViolater
+     * checks if counts violate the seesaw
+     * balancing property
+    */
+    static bool checkViolater(int nL, int nR) {
+        return max(nL, nR) > 2 * min(nL, nR) + 1;
+    }
+
+    // ----------------------
+
+    void _retire(NODE* node) {
+        retired.push_back(retiredNode{node, globalEpoch.load()});
+    }
+
+    // ----------------------
+
+    /* _reclaim
+     * starts a new epoch after a publish and frees
+     * retired nodes older than every active reader
+    */
+    void _reclaim() {
+        globalEpoch.fetch_add(1);
+        if (retired.size() < reclaimBatch)
+            return;
+
+        uint64_t oldest = UINT64_MAX;
+        for (readerRecord* r = readers.load(); r != nullptr; r = r->next) {
+            uint64_t e = r->epoch.load();
+            if (e != 0 && e < oldest)
+                oldest = e;
+        }
+
+        size_t kept = 0;
+        for (size_t i = 0; i < retired.size(); i++) {
+            if (retired[i].epoch < oldest)
+                delete retired[i].node;
+            else
+                retired[kept++] = retired[i];
+        }
+        retired.resize(kept);
+    }
+
+    // ----------------------
+
+    /* _fillSubtree
+     * collects curr's subtree in order and retires it
+     * helper function for _rebuild, _rebuildWithout and clear
+    */
+    void _fillSubtree(NODE* curr) {
+        NODE* stack[maxDepth];
+        int top = 0;
+
+        while (curr != nullptr || top > 0) {
+            while (curr != nullptr) {
+                stack[top++] = curr;
+                curr = curr->left;
+            }
+            curr = stack[--top];
+            subtree.push_back(curr);
+            _retire(curr);
+            curr = curr->right;
+        }
+    }
+
+    // ----------------------
+
+    /* _buildNodes
+     * recursive helper function for _rebuild
+     * builds fresh balanced nodes for subtree[start, end]
+     * with key/value inserted at position pos
+    */
+    NODE* _buildNodes(int start, int end, int pos,
+        const keyType& key, const valueType& value) {
+        if (start > end)
+            return nullptr;
+
+        int middle = (start + end) / 2;
+        NODE* left = _buildNodes(start, middle - 1, pos, key, value);
+        NODE* right = _buildNodes(middle + 1, end, pos, key, value);
+
+        int nL = middle - start;
+        int nR = end - middle;
+        if (middle == pos)
+            return new NODE(key, value, left, right, nL, nR);
+
+        NODE* old = subtree[middle < pos ? middle : middle - 1];
+        return new NODE(old->key, old->value, left, right, nL, nR);
+    }
+
+    // ----------------------
+
+    /* _rebuild
+     * returns a fresh balanced copy of violater's
+     * subtree with key/value added; the old nodes
+     * are retired
+    */
+    NODE* _rebuild(NODE* violater, const keyType& key,
+        const valueType& value) {
+        subtree.clear();
+        _fillSubtree(violater);
+
+        int pos = 0;
+        while (pos < int(subtree.size()) && subtree[pos]->key < key)
+            pos++;
+
+        return _buildNodes(0, int(subtree.size()), pos, key, value);
+    }
+
+    // ----------------------
+
+    /* _copyNodes
+     * recursive helper function for _rebuildWithout
+     * builds fresh balanced nodes for subtree[start, end]
+    */
+    NODE* _copyNodes(int start, int end) {
+        if (start > end)
+            return nullptr;
+
+        int middle = (start + end) / 2;
+        NODE* left = _copyNodes(start, middle - 1);
+        NODE* right = _copyNodes(middle + 1, end);
+
+        NODE* old = subtree[middle];
+        return new NODE(old->key, old->value, left, right,
+            middle - start, end - middle);
+    }
+
+    // ----------------------
+
+    /* _rebuildWithout
+     * returns a fresh balanced copy of violater's
+     * subtree without key, which must be in it; the
+     * old nodes are retired
+    */
+    NODE* _rebuildWithout(NODE* violater, const keyType& key) {
+        subtree.clear();
+        _fillSubtree(violater);
+
+        int pos = 0;
+        while (subtree[pos]->key < key)
+            pos++;
+        subtree.erase(subtree.begin() + pos);
+
+        return _copyNodes(0, int(subtree.size()) - 1);
+    }
+
+    // ----------------------
+
+    /* _removeAlong
+     * returns a copy of the subtree at way[0] (target
+     * itself if way is empty) without target, where way
+     * is the path from there down to target's parent.
+     * like put, the topmost node the removal puts out of
+     * balance is rebuilt and the path above it copied
+    */
+    NODE* _removeAlong(vector<NODE*>& way, NODE* target) {
+        const keyType& key = target->key;
+
+        size_t top = way.size();  // way[0, top) gets copied
+        for (size_t i = 0; i < way.size(); i++) {
+            bool goLeft = key < way[i]->key;
+            if (checkViolater(way[i]->nL - goLeft, way[i]->nR - !goLeft)) {
+                top = i;
+                break;
+            }
+        }
+
+        NODE* child = (top < way.size()) ? _rebuildWithout(way[top], key)
+            : _unlinkNode(target);
+
+        for (size_t i = top; i-- > 0;) {
+            NODE* p = way[i];
+            bool goLeft = key < p->key;
+            child = new NODE(p->key, p->value,
+                goLeft ? child : p->left, goLeft ? p->right : child,
+                p->nL - goLeft, p->nR - !goLeft);
+            _retire(p);
+        }
+        return child;
+    }
+
+    // ----------------------
+
+    /* _unlinkNode
+     * returns what replaces node once it is removed and
+     * retires it. a node with two children is replaced
+     * by a copy of its neighbour from the larger side,
+     * which keeps the copy in balance
+     * helper function for _removeAlong
+    */
+    NODE* _unlinkNode(NODE* node) {
+        _retire(node);
+        if (node->left == nullptr)
+            return node->right;
+        if (node->right == nullptr)
+            return node->left;
+
+        bool fromRight = node->nR >= node->nL;
+        NODE* moved = fromRight ? node->right : node->left;
+        spine.clear();
+        while ((fromRight ? moved->left : moved->right) != nullptr) {
+            spine.push_back(moved);
+            moved = fromRight ? moved->left : moved->right;
+        }
+
+        // moved has at most one child, so this does not come back here
+        // with spine in use
+        NODE* rest = _removeAlong(spine, moved);
+        if (fromRight)
+            return new NODE(moved->key, moved->value, node->left, rest,
+                node->nL, node->nR - 1);
+        return new NODE(moved->key, moved->value, rest, node->right,
+            node->nL - 1, node->nR);
+    }
+
+    // ----------------------
+
+    static void _deleteNodes(NODE* curr) {
+        if (curr == nullptr)
+            return;
+
+        _deleteNodes(curr->left);
+        _deleteNodes(curr->right);
+        delete curr;
+    }
+
+    // ----------------------
+ public:
+    /* reader:
+     * A reading session owned by one thread. Every call runs lock free
+     * against the version of the map published when it starts, so
+     * forEach() and toVector() see one consistent snapshot even while a
+     * writer keeps putting and erasing. Keep one per thread for the best
+     * throughput.
+    */
+    class reader {
+     private:
+        concurrent_mymap* map;
+        readerRecord* record;
+
+     public:
+        explicit reader(concurrent_mymap& m)
+            : map(&m), record(m._claimRecord()) {}
+
+        reader(const reader&) = delete;
+        reader& operator=(const reader&) = delete;
+
+        reader(reader&& other) noexcept
+            : map(other.map), record(other.record) {
+            other.record = nullptr;
+        }
+
+        ~reader() {
+            if (record != nullptr)
+                record->inUse.store(false);
+        }
+
+        // ----------------------
+
+        bool contains(const keyType& key) {
+            NODE* curr = map->_enter(record);
+            bool found = _findNode(curr, key) != nullptr;
+            map->_exit(record);
+            return found;
+        }
+
+        // ----------------------
+
+        /* get:
+         * returns a copy of the value for key, valueType() if not found;
+         * the node may be freed once the read ends.
+        */
+        valueType get(const keyType& key) {
+            NODE* curr = map->_enter(record);
+            curr = _findNode(curr, key);
+            valueType value = (curr != nullptr) ? curr->value : valueType();
+            map->_exit(record);
+            return value;
+        }
+
+        // ----------------------
+
+        /* forEach:
+         * calls fn(key, value) in order for every pair of one snapshot.
+         * O(n), no allocation
+        */
+        template<typename Func>
+        void forEach(Func fn) {
+            NODE* stack[maxDepth];
+            int top = 0;
+            NODE* curr = map->_enter(record);
+
+            while (curr != nullptr || top > 0) {
+                while (curr != nullptr) {
+                    stack[top++] = curr;
+                    curr = curr->left;
+                }
+                curr = stack[--top];
+                fn(curr->key, curr->value);
+                curr = curr->right;
+            }
+            map->_exit(record);
+        }
+
+        // ----------------------
+
+        vector<pair<keyType, valueType>> toVector() {
+            vector<pair<keyType, valueType>> mapVector;
+            forEach([&mapVector](const keyType& k, const valueType& v) {
+                mapVector.push_back(make_pair(k, v));
+            });
+            return mapVector;
+        }
+    };
+
+    // ----------------------
+
+    /* default constructor :
+     * Creates an empty concurrent_mymap.
+     * Time complexity: O(1)
+    */
+    concurrent_mymap()
+        : root(nullptr), size(0), globalEpoch(1), readers(nullptr) {}
+
+    concurrent_mymap(const concurrent_mymap&) = delete;
+    concurrent_mymap& operator=(const concurrent_mymap&) = delete;
+
+    // ----------------------
+
+    /* destructor:
+     * Frees every node. No reader may still be running.
+    */
+    ~concurrent_mymap() {
+        _deleteNodes(root.load());
+        for (size_t i = 0; i < retired.size(); i++)
+            delete retired[i].node;
+
+        readerRecord* r = readers.load();
+        while (r != nullptr) {
+            readerRecord* next = r->next;
+            delete r;
+            r = next;
+        }
+    }
+
+    // ----------------------
+
+    /* getReader:
+     * Returns a reader session for the calling thread.
+    */
+    reader getReader() { return reader(*this); }
+
+    // ----------------------
+
+    /* put:
+     * Inserts or updates key/value. The nodes on the root-to-leaf path
+     * are copied, and if a node on it breaks the seesaw property its
+     * subtree is rebuilt from fresh nodes, so readers never see a node
+     * change. Writers are serialized, readers are never blocked.
+     * Time complexity: O(logn + m), where m is the size of the subtree
+     * that needs to be re-balanced.
+    */
+    void put(const keyType& key, const valueType& value) {
+        lock_guard<mutex> lock(writeLock);
+
+        path.clear();
+        NODE* curr = root.load();
+        while (curr != nullptr) {
+            path.push_back(curr);
+            if (key < curr->key)
+                curr = curr->left;
+            else if (curr->key < key)
+                curr = curr->right;
+            else
+                break;
+        }
+
+        bool isNew = (curr == nullptr);
+        size_t top = path.size();  // path[0, top) gets copied
+        NODE* child;
+
+        if (!isNew) {
+            top--;
+            child = new NODE(curr->key, value, curr->left, curr->right,
+                curr->nL, curr->nR);
+            _retire(curr);
+        } else {
+            // topmost node the new key puts out of balance
+            for (size_t i = 0; i < path.size(); i++) {
+                bool goLeft = key < path[i]->key;
+                if (checkViolater(path[i]->nL + goLeft,
+                    path[i]->nR + !goLeft)) {
+                    top = i;
+                    break;
+                }
+            }
+
+            if (top < path.size())
+                child = _rebuild(path[top], key, value);
+            else
+                child = new NODE(key, value, nullptr, nullptr, 0, 0);
+            size.fetch_add(1);
+        }
+
+        // copy the path above the change, bottom up
+        for (size_t i = top; i-- > 0;) {
+            NODE* p = path[i];
+            bool goLeft = key < p->key;
+            child = new NODE(p->key, p->value,
+                goLeft ? child : p->left, goLeft ? p->right : child,
+                p->nL + (isNew && goLeft), p->nR + (isNew && !goLeft));
+            _retire(p);
+        }
+
+        root.store(child);
+        _reclaim();
+    }
+
+    // ----------------------
+
+    /* erase:
+     * Removes key from the map, returns the # of keys removed (0 or 1).
+     * Like put, the path to the key is copied and the topmost node the
+     * removal puts out of balance is rebuilt from fresh nodes; the
+     * removed node is freed once no reader can see it.
+     * Time complexity: O(logn + m), where m is the size of the subtree
+     * that needs to be re-balanced.
+    */
+    int erase(const keyType& key) {
+        lock_guard<mutex> lock(writeLock);
+
+        path.clear();
+        NODE* curr = root.load();
+        while (curr != nullptr && (key < curr->key || curr->key < key)) {
+            path.push_back(curr);
+            curr = (key < curr->key) ? curr->left : curr->right;
+        }
+        if (curr == nullptr)
+            return 0;
+
+        root.store(_removeAlong(path, curr));
+        size.fetch_sub(1);
+        _reclaim();
+        return 1;
+    }
+
+    // ----------------------
+
+    /* clear:
+     * Empties the map; readers still in a read keep their snapshot.
+     * Time complexity: O(n)
+    */
+    void clear() {
+        lock_guard<mutex> lock(writeLock);
+
+        subtree.clear();
+        _fillSubtree(root.load());
+        root.store(nullptr);
+        size.store(0);
+        _reclaim();
+    }
+
+    // ----------------------
+
+    /* contains / get:
+     * One-off lock free reads; a reader from getReader() avoids claiming
+     * a reader record on every call.
+     * Time complexity: O(logn)
+    */
+    bool contains(const keyType& key) { return getReader().contains(key); }
+
+    valueType get(const keyType& key) { return getReader().get(key); }
+
+    // ----------------------
+
+    /* Size:
+     * Returns the # of key/value pairs in the map, 0 if empty.
+     * O(1)
+    */
+    int Size() const { return size.load(); }
+};
+
+// -----------------------------------------------------------------------
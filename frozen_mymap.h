@@ -0,0 +1,306 @@
+// -----------------------------------------------------------------------
+
+// mymap - frozen_mymap.h
+//
+// frozen_mymap.h implements an immutable snapshot of
+// a mymap, laid out as an implicit B-tree for fast,
+// cache friendly searches. Built by mymap::freeze().
+
+// -----------------------------------------------------------------------
+
+#pragma once
+#include <vector>
+#include <utility>
+#include <type_traits>
+#include <functional>
+#include <iterator>
+#include <cstddef>
+using namespace std;
+
+// -----------------------------------------------------------------------
+
+template<typename keyType, typename valueType,
+    typename Compare = less<keyType>>
+class frozen_mymap {
+ private:
+    // keys per block: arithmetic keys fill a cache line and are compared
+    // a whole block at a time (the counting loop below vectorizes), other
+    // keys use one key per block, which is the Eytzinger layout
+    static const int B = is_arithmetic<keyType>::value ? 16 : 1;
+
+    vector<keyType> keys;  // keys in block order, padded with the max key
+    vector<pair<const keyType, valueType>> pairs;  // parallel to keys
+    vector<int> order;  // slot of the i-th smallest key, for iteration
+    int nBlocks;  // # of B-key blocks in keys
+    int size;  // # of key/value pairs in the frozen_mymap
+    Compare comp;  // the order the keys were sorted by
+
+    // ----------------------
+
+    /* _fillBlocks
+     * recursive helper function for the constructor
+     * gives the sorted ranks their slots in the blocks
+     * in order, block k's children are k * (B + 1) + j + 1
+    */
+    void _fillBlocks(int k, int& next) {
+        if (k >= nBlocks)
+            return;
+
+        for (int j = 0; j < B; j++) {
+            _fillBlocks(k * (B + 1) + j + 1, next);
+
+            if (next < size)
+                order[next++] = k * B + j;
+        }
+        _fillBlocks(k * (B + 1) + B + 1, next);
+    }
+
+    // ----------------------
+
+    /* _lowerBoundSlot
+     * returns the slot of the first key not less
+     * than key, -1 if there is none. one block per
+     * level, the next block down is prefetched
+    */
+    int _lowerBoundSlot(const keyType& key) const {
+        int k = 0;
+        int slot = -1;
+
+        while (k < nBlocks) {
+            const keyType* block = &keys[size_t(k) * B];
+
+#if defined(__GNUC__)
+            // children are contiguous, start loading the first of them
+            int child = k * (B + 1) + 1;
+            if (child < nBlocks)
+                __builtin_prefetch(&keys[size_t(child) * B]);
+#endif
+
+            // # of keys in the block less than key, branch free
+            int j = 0;
+            for (int b = 0; b < B; b++)
+                j += comp(block[b], key);
+
+            if (j < B)
+                slot = k * B + j;
+            k = k * (B + 1) + j + 1;
+        }
+        return slot;
+    }
+
+    // ----------------------
+
+    /* _findSlot
+     * returns the slot holding key, -1 if not found
+    */
+    int _findSlot(const keyType& key) const {
+        int slot = _lowerBoundSlot(key);
+        if (slot >= 0 && !comp(key, keys[slot]))
+            return slot;
+        return -1;
+    }
+
+    // ----------------------
+ public:
+    /* iterator:
+     * Walks the pairs in order, like mymap's const_iterator.
+    */
+    struct iterator {
+     public:
+        typedef bidirectional_iterator_tag iterator_category;
+        typedef pair<const keyType, valueType> value_type;
+        typedef ptrdiff_t difference_type;
+        typedef const value_type& reference;
+        typedef const value_type* pointer;
+
+     private:
+        const frozen_mymap* map;
+        int i;  // rank of the current pair
+
+     public:
+        iterator() : map(nullptr), i(0) {}
+
+        iterator(const frozen_mymap* m, int rank) : map(m), i(rank) {}
+
+        // ----------------------
+
+        reference operator *() const {
+            return map->pairs[map->order[i]];
+        }
+
+        // ----------------------
+
+        pointer operator ->() const {
+            return &map->pairs[map->order[i]];
+        }
+
+        // ----------------------
+
+        bool operator ==(const iterator& rhs) const { return i == rhs.i; }
+
+        bool operator !=(const iterator& rhs) const { return i != rhs.i; }
+
+        // ----------------------
+
+        iterator& operator++() {
+            i++;
+            return *this;
+        }
+
+        iterator operator++(int) {
+            iterator old = *this;
+            i++;
+            return old;
+        }
+
+        // ----------------------
+
+        iterator& operator--() {
+            i--;
+            return *this;
+        }
+
+        iterator operator--(int) {
+            iterator old = *this;
+            i--;
+            return old;
+        }
+    };
+
+    typedef iterator const_iterator;
+
+    // ----------------------
+
+    /* default constructor :
+     * Creates an empty frozen_mymap.
+     * Time complexity: O(1)
+    */
+    frozen_mymap() : nBlocks(0), size(0), comp() {}
+
+    // ----------------------
+
+    /* sorted constructor :
+     * Builds a frozen_mymap from pairs sorted by strictly increasing key,
+     * e.g. the result of mymap::toVector(). The pairs are moved from.
+     * Time complexity: O(n), where n is the number of pairs.
+    */
+    explicit frozen_mymap(vector<pair<keyType, valueType>>&& sorted,
+        const Compare& compare = Compare()) : comp(compare) {
+        this->size = int(sorted.size());
+        this->nBlocks = (size + B - 1) / B;
+        if (size == 0)
+            return;
+
+        order.resize(size);
+        int next = 0;
+        _fillBlocks(0, next);
+
+        // padding slots repeat the max key so searches never stop on them
+        size_t slots = size_t(nBlocks) * B;
+        keys.assign(slots, sorted.back().first);
+        vector<int> rankOf(slots, -1);
+        for (int rank = 0; rank < size; rank++) {
+            keys[order[rank]] = sorted[rank].first;
+            rankOf[order[rank]] = rank;
+        }
+
+        pairs.reserve(slots);
+        for (size_t slot = 0; slot < slots; slot++) {
+            if (rankOf[slot] < 0) {
+                pairs.emplace_back(keys[slot], valueType());
+            } else {
+                pair<keyType, valueType>& p = sorted[rankOf[slot]];
+                pairs.emplace_back(std::move(p.first), std::move(p.second));
+            }
+        }
+    }
+
+    // ----------------------
+
+    /* copy and move :
+     * The key of a pair is const, so a copy assignment builds the copy
+     * first and then moves it in.
+     * Time complexity: O(n) to copy, O(1) to move
+    */
+    frozen_mymap(const frozen_mymap& other) = default;
+
+    frozen_mymap(frozen_mymap&& other) = default;
+
+    frozen_mymap& operator=(frozen_mymap&& other) = default;
+
+    frozen_mymap& operator=(const frozen_mymap& other) {
+        if (this != &other) {
+            frozen_mymap copy(other);
+            *this = std::move(copy);
+        }
+        return *this;
+    }
+
+    // ----------------------
+
+    /* contains:
+     * Returns true if the key is in frozen_mymap, return false if not.
+     * Time complexity: O(logn), with O(log_B n) cache misses
+    */
+    bool contains(const keyType& key) const { return _findSlot(key) >= 0; }
+
+    // ----------------------
+
+    /* get:
+     * Returns the value for the given key; if the key is not found, the
+     * default value, valueType(), is returned.
+     * Time complexity: O(logn), with O(log_B n) cache misses
+    */
+    const valueType& get(const keyType& key) const {
+        static const valueType defaultValue = valueType();
+
+        int slot = _findSlot(key);
+        return (slot >= 0) ? pairs[slot].second : defaultValue;
+    }
+
+    // ----------------------
+
+    /* getPtr:
+     * Returns a pointer to the value for the given key, nullptr if the
+     * key is not found.
+     * Time complexity: O(logn), with O(log_B n) cache misses
+    */
+    const valueType* getPtr(const keyType& key) const {
+        int slot = _findSlot(key);
+        return (slot >= 0) ? &pairs[slot].second : nullptr;
+    }
+
+    // ----------------------
+
+    /* Size:
+     * Returns the # of key/value pairs in the frozen_mymap, 0 if empty.
+     * O(1)
+    */
+    int Size() const { return this->size; }
+
+    // ----------------------
+
+    /* begin / end:
+     * iterators over the pairs in order, O(1) per step.
+    */
+    iterator begin() const { return iterator(this, 0); }
+
+    iterator end() const { return iterator(this, size); }
+
+    // ----------------------
+
+    /* toVector:
+     * Returns a vector of the entire frozen_mymap, in order.
+     * Time complexity: O(n)
+    */
+    vector<pair<keyType, valueType>> toVector() const {
+        vector<pair<keyType, valueType>> mapVector;
+        mapVector.reserve(size);
+
+        for (int i = 0; i < size; i++)
+            mapVector.push_back(pairs[order[i]]);
+        return mapVector;
+    }
+};
+
+// -----------------------------------------------------------------------
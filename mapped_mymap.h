@@ -0,0 +1,163 @@
+// -----------------------------------------------------------------------
+
+// mymap - mapped_mymap.h
+//
+// mapped_mymap.h implements a read only map served
+// straight off a memory-mapped mymap snapshot (see
+// mymap::save()). Opening it builds nothing, so a
+// restarted process can answer lookups at once.
+
+// -----------------------------------------------------------------------
+
+#pragma once
+#include <string>
+#include <vector>
+#include <cstring>
+#include <functional>
+#include <type_traits>
+#include <utility>
+#include "mymap_snapshot.h"
+using namespace std;
+
+// -----------------------------------------------------------------------
+
+template<typename keyType, typename valueType,
+    typename Compare = less<keyType>>
+class mapped_mymap {
+ private:
+    static_assert(mymap_serializer<keyType>::fixedSize != 0
+        && mymap_serializer<valueType>::fixedSize != 0,
+        "mapped_mymap needs fixed size (trivially copyable) keys and values");
+
+    static const size_t recordSize = sizeof(keyType) + sizeof(valueType);
+
+    mymap_mapped_file file;
+    const char* records;  // first record, right after the header
+    int size;  // # of key/value pairs in the snapshot
+    Compare comp;  // the order save() wrote the keys in
+
+    // ----------------------
+
+    /* _keyAt / _valueAt
+     * copy out the i-th record's key / value,
+     * records are packed so they may be unaligned
+    */
+    keyType _keyAt(int i) const {
+        keyType key;
+        memcpy(&key, records + size_t(i) * recordSize, sizeof(keyType));
+        return key;
+    }
+
+    valueType _valueAt(int i) const {
+        valueType value;
+        memcpy(&value, records + size_t(i) * recordSize + sizeof(keyType),
+            sizeof(valueType));
+        return value;
+    }
+
+    // ----------------------
+
+    /* _findRecord
+     * binary search for key, returns its record
+     * index or -1 if not found
+    */
+    int _findRecord(const keyType& key) const {
+        int lo = 0;
+        int hi = size;
+
+        // first record whose key is not less than key
+        while (lo < hi) {
+            int middle = lo + (hi - lo) / 2;
+            if (comp(_keyAt(middle), key))
+                lo = middle + 1;
+            else
+                hi = middle;
+        }
+
+        if (lo < size && !comp(key, _keyAt(lo)))
+            return lo;
+        return -1;
+    }
+
+    // ----------------------
+ public:
+    /* constructor :
+     * Maps the snapshot at path. With verify the whole file is read
+     * once to check its checksum; without it only the header is checked
+     * and opening is O(1), pages are read in as lookups touch them.
+     * Throws runtime_error if the file is not a valid snapshot of
+     * keyType / valueType records.
+     * Time complexity: O(n) with verify, O(1) otherwise
+    */
+    explicit mapped_mymap(const string& path, bool verify = true,
+        const Compare& compare = Compare())
+        : file(path, false), comp(compare) {
+        mymap_snapshot_header header =
+            mymap_snapshot_check<keyType, valueType>(file, verify);
+
+        this->records = file.data() + sizeof(mymap_snapshot_header);
+        this->size = int(header.count);
+    }
+
+    mapped_mymap(const mapped_mymap&) = delete;
+    mapped_mymap& operator=(const mapped_mymap&) = delete;
+
+    // ----------------------
+
+    /* contains:
+     * Returns true if the key is in the snapshot, return false if not.
+     * Time complexity: O(logn)
+    */
+    bool contains(const keyType& key) const {
+        return _findRecord(key) >= 0;
+    }
+
+    // ----------------------
+
+    /* get:
+     * Returns a copy of the value for the given key; if the key is not
+     * found, the default value, valueType(), is returned.
+     * Time complexity: O(logn)
+    */
+    valueType get(const keyType& key) const {
+        int i = _findRecord(key);
+        return (i >= 0) ? _valueAt(i) : valueType();
+    }
+
+    // ----------------------
+
+    /* Size:
+     * Returns the # of key/value pairs in the snapshot, 0 if empty.
+     * O(1)
+    */
+    int Size() const { return this->size; }
+
+    // ----------------------
+
+    /* forEach:
+     * Calls fn(key, value) for every pair, in order.
+     * Time complexity: O(n)
+    */
+    template<typename Func>
+    void forEach(Func fn) const {
+        for (int i = 0; i < size; i++)
+            fn(_keyAt(i), _valueAt(i));
+    }
+
+    // ----------------------
+
+    /* toVector:
+     * Returns a vector of the entire snapshot, in order.
+     * Time complexity: O(n)
+    */
+    vector<pair<keyType, valueType>> toVector() const {
+        vector<pair<keyType, valueType>> mapVector;
+        mapVector.reserve(size);
+
+        for (int i = 0; i < size; i++)
+            mapVector.push_back(make_pair(_keyAt(i), _valueAt(i)));
+        return mapVector;
+    }
+};
+
+// -----------------------------------------------------------------------
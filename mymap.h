@@ -17,61 +17,690 @@
 #include <algorithm>
 #include <string>
 #include <utility>
+#include <tuple>
+#include <iterator>
 #include <sstream>
+#include <stdexcept>
+#include <memory>
+#include <cstddef>
+#include <type_traits>
+#include <functional>
+#include <cmath>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <exception>
+#if defined(__has_include)
+#if __has_include(<memory_resource>) && __cplusplus >= 201703L
+#include <memory_resource>
+#define MYMAP_HAS_PMR 1
+#endif
+#endif
+#if defined(__has_include)
+#if __has_include(<compare>) && __cplusplus > 201703L
+#include <compare>
+#endif
+#endif
+#if defined(__cpp_lib_three_way_comparison)
+#define MYMAP_HAS_THREE_WAY 1
+#endif
+#include "frozen_mymap.h"
+#include "mymap_snapshot.h"
 using namespace std;
 
 // -----------------------------------------------------------------------
 
-template<typename keyType, typename valueType>
-class mymap {
+/* mymap_no_stats:
+ * Default statistics policy for mymap. Every hook is an empty inline
+ * function and mymap inherits the (empty) policy, so instrumentation
+ * costs nothing, neither time nor space, when it is not asked for.
+*/
+struct mymap_no_stats {
+    static const bool enabled = false;
+
+    void nodeAllocated() const {}
+    void rebalanced(int) const {}
+    void compared() const {}
+    void searched(int) const {}
+};
+
+// -----------------------------------------------------------------------
+
+/* mymap_stats:
+ * Counting statistics policy, e.g. mymap<int, int, less<int>,
+ * allocator<...>, mymap_stats>. Read it with mymap::stats(). Counters
+ * are not atomic, so like mymap itself it must not be used from several
+ * threads at once.
+*/
+struct mymap_stats {
+    static const bool enabled = true;
+    static const int histogramSize = 64;
+
+    mutable long long nodesAllocated;  // NODEs created
+    mutable long long rebalances;  // subtrees rebuilt by violaterExists
+    mutable long long rebuiltNodes;  // NODEs relinked by those rebuilds
+    mutable long long comparisons;  // key comparisons
+    mutable long long searches;  // root-to-leaf descents
+    // [i]: rebuilds of a subtree with 2^i to 2^(i+1) - 1 nodes
+    mutable long long rebuildSizeLog2[histogramSize];
+    // [d]: descents that visited d nodes
+    mutable long long depths[histogramSize];
+
+    mymap_stats()
+        : nodesAllocated(0), rebalances(0), rebuiltNodes(0),
+          comparisons(0), searches(0) {
+        for (int i = 0; i < histogramSize; i++) {
+            rebuildSizeLog2[i] = 0;
+            depths[i] = 0;
+        }
+    }
+
+    // ----------------------
+
+    void nodeAllocated() const { nodesAllocated++; }
+
+    void rebalanced(int count) const {
+        int bucket = 0;
+        while ((count >> (bucket + 1)) > 0 && bucket < histogramSize - 1)
+            bucket++;
+
+        rebalances++;
+        rebuiltNodes += count;
+        rebuildSizeLog2[bucket]++;
+    }
+
+    void compared() const { comparisons++; }
+
+    void searched(int depth) const {
+        searches++;
+        depths[min(depth, histogramSize - 1)]++;
+    }
+
+    // ----------------------
+
+    /* comparisonsPerSearch:
+     * average # of key comparisons per root-to-leaf descent; inserts
+     * also count the comparisons of their count and balance updates.
+    */
+    double comparisonsPerSearch() const {
+        return (searches == 0) ? 0.0 : double(comparisons) / searches;
+    }
+
+    // ----------------------
+
+    /* toJSON:
+     * Returns the counters as one JSON object; histograms are cut after
+     * their last non-zero bucket.
+    */
+    string toJSON() const {
+        stringstream ss;
+        ss << "{\"nodesAllocated\": " << nodesAllocated
+            << ", \"rebalances\": " << rebalances
+            << ", \"rebuiltNodes\": " << rebuiltNodes
+            << ", \"comparisons\": " << comparisons
+            << ", \"searches\": " << searches
+            << ", \"comparisonsPerSearch\": " << comparisonsPerSearch()
+            << ", \"rebuildSizeLog2\": ";
+        _histogramJSON(ss, rebuildSizeLog2);
+        ss << ", \"depths\": ";
+        _histogramJSON(ss, depths);
+        ss << "}";
+        return ss.str();
+    }
+
+ private:
+    static void _histogramJSON(stringstream& ss, const long long* buckets) {
+        int last = histogramSize - 1;
+        while (last >= 0 && buckets[last] == 0)
+            last--;
+
+        ss << "[";
+        for (int i = 0; i <= last; i++)
+            ss << (i > 0 ? ", " : "") << buckets[i];
+        ss << "]";
+    }
+};
+
+// -----------------------------------------------------------------------
+
+/* mymap_seesaw_balance:
+ * Default balance policy for mymap, the last template parameter, e.g.
+ * mymap<int, int, less<int>, allocator<...>, mymap_no_stats,
+ * mymap_alpha_balance<3, 4>>. A node is out of balance when one side
+ * holds more than twice the other side plus one live nodes, and an
+ * insert or erase rebuilds the topmost such node on its path. This is
+ * mymap_alpha_balance<2, 3>, written out.
+ * A balance policy has:
+ * isUnbalanced(nL, nR) - true if a node with nL / nR live nodes below
+ *                        it must be rebuilt
+ * depthTriggered       - true if only an insert landing too deep looks
+ *                        for such a node
+ * isTooDeep(depth, n)  - true if a new node depth nodes down (the root
+ *                        is 1) in a tree of n nodes is too deep
+*/
+struct mymap_seesaw_balance {
+    static const bool depthTriggered = false;
+
+    static bool isUnbalanced(int nL, int nR) {
+        return max(nL, nR) > 2 * min(nL, nR) + 1;
+    }
+
+    static bool isTooDeep(int, int) { return true; }
+};
+
+// -----------------------------------------------------------------------
+
+/* mymap_alpha_balance:
+ * Weight balance with alpha = Num / Den, 2/3 <= alpha < 1: neither
+ * child of a node may weigh more than alpha times the node, a subtree
+ * weighing its live nodes + 1. A larger alpha rebuilds less often and
+ * in smaller pieces but lets the tree grow deeper, e.g. <3, 4> or
+ * <4, 5> for maps that are mostly written. 2/3, the seesaw default, is
+ * the smallest alpha a subtree of two nodes can meet.
+*/
+template<int Num, int Den>
+struct mymap_alpha_balance {
+    static_assert(Num < Den && 3 * Num >= 2 * Den,
+        "mymap_alpha_balance: alpha = Num / Den must be in [2/3, 1)");
+
+    static const bool depthTriggered = false;
+
+    static bool isUnbalanced(int nL, int nR) {
+        long long heavy = max(nL, nR) + 1;
+        long long total = (long long)nL + nR + 2;
+        return heavy * Den > total * Num;
+    }
+
+    static bool isTooDeep(int, int) { return true; }
+};
+
+// -----------------------------------------------------------------------
+
+/* mymap_scapegoat_balance:
+ * Scapegoat tree rule: nothing is rebuilt until an insert lands deeper
+ * than log base Den / Num of the size; then the topmost node on its path
+ * out of alpha = Num / Den weight balance is rebuilt. Erase rebuilds
+ * nothing, the next insert that lands too deep does. Cheapest inserts,
+ * up to ~1.7x the seesaw depth for the default alpha of 2/3.
+*/
+template<int Num = 2, int Den = 3>
+struct mymap_scapegoat_balance : mymap_alpha_balance<Num, Den> {
+    static const bool depthTriggered = true;
+
+    static bool isTooDeep(int depth, int size) {
+        int edges = depth - 1;
+        if (edges < 31 && (size >> edges) > 0)  // edges <= log2(size)
+            return false;
+        return edges > log(double(size)) / log(double(Den) / Num);
+    }
+};
+
+// -----------------------------------------------------------------------
+
+/* mymap_conflict:
+ * Which value mymap::mergeFrom and intersectWith keep for a key found
+ * in both maps:
+ * KEEP_OURS    - the value already in this map
+ * TAKE_THEIRS  - the value from the other map
+*/
+enum mymap_conflict { KEEP_OURS, TAKE_THEIRS };
+
+// -----------------------------------------------------------------------
+
+template<typename keyType, typename valueType,
+    typename Compare = less<keyType>,
+    typename Alloc = allocator<pair<const keyType, valueType>>,
+    typename Stats = mymap_no_stats,
+    typename Balance = mymap_seesaw_balance>
+class mymap : private Stats {
  private:
     struct NODE {
-        keyType key;  // used to build BST
-        valueType value;  // stored data for the map
+        // key used to build BST and stored data for the map
+        pair<const keyType, valueType> data;
         NODE* left;  // links to left child
         NODE* right;  // links to right child
-        int nL;  // number of nodes in left subtree
-        int nR;  // number of nodes in right subtree
+        int nL;  // number of live nodes in left subtree
+        int nR;  // number of live nodes in right subtree
+        int nDead;  // number of erased nodes in this subtree, itself included
         bool isThreaded;
+        bool isLeftThreaded;  // left links to the in-order predecessor
+        bool isDead;  // erased by a lazy erase, waiting to be compacted
+
+        template<typename K, typename... Args>
+        explicit NODE(K&& k, Args&&... args)
+            : data(piecewise_construct, forward_as_tuple(std::forward<K>(k)),
+                forward_as_tuple(std::forward<Args>(args)...)),
+              left(nullptr), right(nullptr), nL(0), nR(0), nDead(0),
+              isThreaded(true), isLeftThreaded(true), isDead(false) {}
+
+        const keyType& key() const { return data.first; }
+
+        valueType& value() { return data.second; }
+
+        const valueType& value() const { return data.second; }
+    };
+
+    typedef typename allocator_traits<Alloc>::template
+        rebind_alloc<NODE> nodeAllocType;
+    typedef allocator_traits<nodeAllocType> nodeTraits;
+
+    // ----------------------
+
+    /* _createNode
+     * constructs a NODE from args in the pool
+    */
+    template<typename... Args>
+    NODE* _createNode(Args&&... args) {
+        this->nodeAllocated();
+        return pool.create(std::forward<Args>(args)...);
+    }
+
+    // ----------------------
+
+    /* _less
+     * every key comparison goes through here
+     * so the Stats policy can count them. either
+     * argument may be a K other than keyType when
+     * Compare is transparent
+    */
+    template<typename K1, typename K2>
+    bool _less(const K1& a, const K2& b) const {
+        this->compared();
+        return comp(a, b);
+    }
+
+#ifdef MYMAP_HAS_THREE_WAY
+    // <=> can stand in for Compare when Compare is plain std::less
+    static constexpr bool isDefaultCompare =
+        is_same<Compare, less<keyType>>::value
+        || is_same<Compare, less<>>::value;
+
+    template<typename K>
+    static constexpr bool isThreeWay = isDefaultCompare
+        && three_way_comparable_with<K, keyType>;
+#endif
+
+    /* _step / _found
+     * one level of a search for key: _step returns
+     * the child of curr to go on to, nullptr at the
+     * bottom, and keeps in cand the last node key
+     * was not less than. _found then settles cand
+     * with one equality check, as std::map::find
+     * does, so a search costs one Compare per level
+     * and one more at the end. with the default
+     * Compare (C++20) one <=> per level stops at
+     * key's node, and cand is only set there
+    */
+    template<typename K>
+    NODE* _step(NODE* curr, const K& key, NODE* &cand) const {
+#ifdef MYMAP_HAS_THREE_WAY
+        if constexpr (isThreeWay<K>) {
+            this->compared();
+            auto order = (key <=> curr->key());
+            if (order == 0) {
+                cand = curr;
+                return nullptr;
+            }
+            if (order < 0)
+                return (curr->isLeftThreaded) ? nullptr : curr->left;
+            return (curr->isThreaded) ? nullptr : curr->right;
+        } else
+#endif
+        {
+            if (_less(key, curr->key()))
+                return (curr->isLeftThreaded) ? nullptr : curr->left;
+            cand = curr;
+            return (curr->isThreaded) ? nullptr : curr->right;
+        }
+    }
+
+    template<typename K>
+    NODE* _found(NODE* cand, const K& key) const {
+#ifdef MYMAP_HAS_THREE_WAY
+        if constexpr (isThreeWay<K>) {
+            return cand;
+        } else
+#endif
+        {
+            if (cand != nullptr && !_less(cand->key(), key))
+                return cand;
+            return nullptr;
+        }
+    }
+
+    // ----------------------
+
+    /* nodePool:
+     * Slab allocator for NODEs. Nodes are carved out of large contiguous
+     * blocks taken from the allocator, so nodes created together sit
+     * next to each other in memory. Freed nodes go on a free list for
+     * reuse and release() hands every block back at once.
+    */
+    struct nodePool {
+     private:
+        struct blockHeader {
+            NODE* next;  // next block in the chain
+            size_t capacity;  // # of NODE slots in this block
+        };
+        static_assert(sizeof(blockHeader) <= sizeof(NODE),
+            "block header must fit in one NODE slot");
+
+        static const size_t minBlock = 64;
+        static const size_t maxBlock = 8192;
+
+        nodeAllocType alloc;
+        NODE* blocks;  // chain of blocks, header kept in the first slot
+        NODE* freeList;  // recycled slots, linked through their storage
+        NODE* cursor;  // next unused slot in the newest block
+        size_t remaining;  // # of unused slots left after cursor
+        size_t nextCapacity;  // # of slots to request for the next block
+
+        static NODE* getLink(NODE* slot) {
+            return *reinterpret_cast<NODE**>(slot);
+        }
+
+        static void setLink(NODE* slot, NODE* next) {
+            ::new (static_cast<void*>(slot)) NODE*(next);
+        }
+
+        static void freeChain(nodeAllocType& a, NODE* chain) {
+            while (chain != nullptr) {
+                NODE* block = chain;
+                blockHeader* header = reinterpret_cast<blockHeader*>(block);
+                chain = header->next;
+                nodeTraits::deallocate(a, block, header->capacity);
+            }
+        }
+
+        // owns a chain of blocks handed over by share(), freed when the
+        // last pool holding it lets go
+        struct blockOwner {
+            nodeAllocType alloc;
+            NODE* blocks;
+
+            blockOwner(const nodeAllocType& a, NODE* chain)
+                : alloc(a), blocks(chain) {}
+
+            blockOwner(const blockOwner&) = delete;
+            blockOwner& operator=(const blockOwner&) = delete;
+
+            ~blockOwner() { freeChain(alloc, blocks); }
+        };
+
+        // blocks shared by split(), sorted, each owner once
+        vector<shared_ptr<blockOwner>> shared;
+
+        // adds the owners of from that are not in shared yet, so a pool
+        // holds one entry per shared chain however often it is split
+        // and joined again
+        void addShared(const vector<shared_ptr<blockOwner>>& from) {
+            vector<shared_ptr<blockOwner>> merged;
+            merged.reserve(shared.size() + from.size());
+            set_union(shared.begin(), shared.end(), from.begin(), from.end(),
+                back_inserter(merged));
+            shared.swap(merged);
+        }
+
+        void grow(size_t capacity) {
+            NODE* block = nodeTraits::allocate(alloc, capacity);
+            ::new (static_cast<void*>(block)) blockHeader{blocks, capacity};
+            blocks = block;
+            cursor = block + 1;
+            remaining = capacity - 1;
+        }
+
+     public:
+        explicit nodePool(const nodeAllocType& a)
+            : alloc(a), blocks(nullptr), freeList(nullptr),
+              cursor(nullptr), remaining(0), nextCapacity(minBlock) {}
+
+        nodePool(const nodePool&) = delete;
+        nodePool& operator=(const nodePool&) = delete;
+
+        nodePool(nodePool&& other) noexcept
+            : alloc(other.alloc), blocks(other.blocks),
+              freeList(other.freeList), cursor(other.cursor),
+              remaining(other.remaining), nextCapacity(other.nextCapacity),
+              shared(std::move(other.shared)) {
+            other.blocks = nullptr;
+            other.freeList = nullptr;
+            other.cursor = nullptr;
+            other.remaining = 0;
+            other.nextCapacity = minBlock;
+        }
+
+        // ----------------------
+
+        void swap(nodePool& other) noexcept {
+            using std::swap;
+            swap(alloc, other.alloc);
+            swap(blocks, other.blocks);
+            swap(freeList, other.freeList);
+            swap(cursor, other.cursor);
+            swap(remaining, other.remaining);
+            swap(nextCapacity, other.nextCapacity);
+            swap(shared, other.shared);
+        }
+
+        ~nodePool() { release(); }
+
+        // ----------------------
+
+        nodeAllocType getAllocator() const { return alloc; }
+
+        // ----------------------
+
+        /* allocate:
+         * returns raw storage for one NODE, reusing freed slots first.
+         * O(1) amortized
+        */
+        NODE* allocate() {
+            if (freeList != nullptr) {
+                NODE* slot = freeList;
+                freeList = getLink(slot);
+                return slot;
+            }
+
+            if (remaining == 0) {
+                grow(nextCapacity);
+                if (nextCapacity < maxBlock)
+                    nextCapacity *= 2;
+            }
+
+            remaining--;
+            return cursor++;
+        }
+
+        // ----------------------
+
+        /* reserve:
+         * makes sure the next n allocations come from one contiguous
+         * block, so nodes built in order are laid out in order.
+        */
+        void reserve(size_t n) {
+            if (n > remaining)
+                grow(n + 1);
+        }
+
+        // ----------------------
+
+        void deallocate(NODE* slot) {
+            setLink(slot, freeList);
+            freeList = slot;
+        }
+
+        // ----------------------
+
+        /* construct:
+         * builds a NODE in storage from allocate(); safe to call from
+         * several threads at once for the default allocator
+        */
+        template<typename... Args>
+        void construct(NODE* slot, Args&&... args) {
+            nodeTraits::construct(alloc, slot, std::forward<Args>(args)...);
+        }
+
+        // ----------------------
+
+        template<typename... Args>
+        NODE* create(Args&&... args) {
+            NODE* slot = allocate();
+            try {
+                nodeTraits::construct(alloc, slot,
+                    std::forward<Args>(args)...);
+            } catch (...) {
+                deallocate(slot);
+                throw;
+            }
+            return slot;
+        }
+
+        // ----------------------
+
+        void destroy(NODE* node) { nodeTraits::destroy(alloc, node); }
+
+        // ----------------------
+
+        /* release:
+         * hands every block back to the allocator, or lets go of the
+         * share of them given by share(). Nodes must already have been
+         * destroyed (or be trivially destructible).
+         * O(number of blocks)
+        */
+        void release() {
+            freeChain(alloc, blocks);
+            blocks = nullptr;
+            shared.clear();
+            freeList = nullptr;
+            cursor = nullptr;
+            remaining = 0;
+            nextCapacity = minBlock;
+        }
+
+        // ----------------------
+
+        /* adopt:
+         * takes over other's blocks, so nodes built by other may be
+         * kept and freed here. Allocators must compare equal; other is
+         * left empty. O(number of blocks + other's unused slots)
+        */
+        void adopt(nodePool& other) {
+            // other's unused and recycled slots become ours to reuse
+            for (; other.remaining > 0; other.remaining--)
+                deallocate(other.cursor++);
+            while (other.freeList != nullptr) {
+                NODE* slot = other.freeList;
+                other.freeList = getLink(slot);
+                deallocate(slot);
+            }
+
+            if (other.blocks != nullptr) {
+                NODE* last = other.blocks;
+                while (reinterpret_cast<blockHeader*>(last)->next != nullptr)
+                    last = reinterpret_cast<blockHeader*>(last)->next;
+                reinterpret_cast<blockHeader*>(last)->next = blocks;
+                blocks = other.blocks;
+            }
+            addShared(other.shared);
+
+            other.shared.clear();
+            other.blocks = nullptr;
+            other.cursor = nullptr;
+            other.nextCapacity = minBlock;
+        }
+
+        // ----------------------
+
+        /* share:
+         * gives other a share of every block here, so nodes built here
+         * may be kept and freed by other (split). The blocks are handed
+         * back once both pools are released. O(1) amortized
+        */
+        void share(nodePool& other) {
+            if (blocks != nullptr) {
+                shared_ptr<blockOwner> owner = allocate_shared<blockOwner>(
+                    alloc, alloc, blocks);
+                shared.insert(std::upper_bound(shared.begin(), shared.end(),
+                    owner), owner);
+                blocks = nullptr;
+            }
+            other.addShared(shared);
+        }
     };
+
     NODE* root;  // pointer to root node of the BST
     int size;  // # of key/value pairs in the mymap
+    Compare comp;  // orders the keys, empty for std::less
+    bool lazyErase;  // erase leaves tombstones, see setLazyErase()
+    nodePool pool;  // owns the storage of every NODE
+    static const int lookupGroup = 32;  // searches getMany runs together
 
     // ----------------------
 
-    /* iterator:
-     * This iterator is used so that mymap will work with a foreach loop.
+    /* iteratorBase:
+     * This iterator is used so that mymap will work with a foreach loop
+     * and std:: algorithms. It is bidirectional and yields the stored
+     * pair<const keyType, valueType>; both directions follow the threads.
+     * iterator and const_iterator are its two flavours.
     */
-    struct iterator {
+    template<bool isConst>
+    struct iteratorBase {
+     public:
+        typedef bidirectional_iterator_tag iterator_category;
+        typedef pair<const keyType, valueType> value_type;
+        typedef ptrdiff_t difference_type;
+        typedef typename conditional<isConst,
+            const value_type&, value_type&>::type reference;
+        typedef typename conditional<isConst,
+            const value_type*, value_type*>::type pointer;
+
      private:
-        NODE* curr;  // points to current in-order node for begin/end
+        NODE* curr;  // points to current in-order node, nullptr at end
+        const mymap* map;  // used to step back from end()
+
+        friend class mymap;
+        friend struct iteratorBase<!isConst>;
 
      public:
-        iterator(NODE* node) {
-            curr = node;
+        iteratorBase() : curr(nullptr), map(nullptr) {}
+
+        iteratorBase(NODE* node, const mymap* m) : curr(node), map(m) {}
+
+        // iterator converts to const_iterator
+        iteratorBase(const iteratorBase<false>& other)
+            : curr(other.curr), map(other.map) {}
+
+        iteratorBase& operator=(const iteratorBase&) = default;
+
+        // ----------------------
+
+        reference operator *() const {
+            return curr->data;
         }
 
         // ----------------------
 
-        keyType operator *() {
-            return curr -> key;
+        pointer operator ->() const {
+            return &curr->data;
         }
 
         // ----------------------
 
-        bool operator ==(const iterator& rhs) {
-            return curr == rhs.curr;
+        friend bool operator ==(const iteratorBase& lhs,
+            const iteratorBase& rhs) {
+            return lhs.curr == rhs.curr;
         }
 
         // ----------------------
 
-        bool operator !=(const iterator& rhs) {
-            return curr != rhs.curr;
+        friend bool operator !=(const iteratorBase& lhs,
+            const iteratorBase& rhs) {
+            return lhs.curr != rhs.curr;
         }
 
         // ----------------------
 
-        bool isDefault() {
+        bool isDefault() const {
             return !curr;
         }
 
@@ -79,47 +708,70 @@ class mymap {
 
         /* operator++:
          * This function should advance curr to the next in-order node.
-         * O(logN)
+         * O(1) amortized
         */
-        iterator operator++() {
-            // if right node is root
-            if (curr->isThreaded == true) {
-                this->curr = this->curr->right;
+        iteratorBase& operator++() {
+            curr = _nextLive(curr);
+            return *this;
+        }
 
-            } else {
-                if (curr->right != nullptr)
-                    this->curr = this->curr->right;
+        iteratorBase operator++(int) {
+            iteratorBase old = *this;
+            curr = _nextLive(curr);
+            return old;
+        }
 
-                if (this->curr->left != nullptr) {
-                    while (this->curr->left != nullptr) {
-                        this->curr = this->curr->left;
-                    }
-                }
+        // ----------------------
+
+        /* operator--:
+         * Moves curr back to the previous in-order node; from end() it
+         * moves to the last node.
+         * O(1) amortized
+        */
+        iteratorBase& operator--() {
+            if (curr != nullptr) {
+                curr = _prevLive(curr);
+            } else {
+                curr = _lastNode(map->root);
+                if (curr != nullptr && curr->isDead)
+                    curr = _prevLive(curr);
             }
-            return iterator(curr);
+            return *this;
+        }
+
+        iteratorBase operator--(int) {
+            iteratorBase old = *this;
+            --*this;
+            return old;
         }
     };
 
+ public:
+    typedef iteratorBase<false> iterator;
+    typedef iteratorBase<true> const_iterator;
+    typedef std::reverse_iterator<iterator> reverse_iterator;
+    typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
+
+ private:
     // ----------------------
 
     /* searchForKeyandMovePtrs
      * Helper function for put()
-     * and operator[]
+     * and operator[]: curr ends at key's node, or
+     * nullptr with prev at the node to link below
     */
     void searchForKeyandMovePtrs(NODE* &prev, NODE* &curr,
-        keyType key) {
-        while (curr != nullptr) {
-            if (key == curr->key)
-                return;
+        const keyType& key) {
+        NODE* cand = nullptr;
+        int depth = 0;
 
-            if (key < curr->key) {  // search left
-                prev = curr;
-                curr = curr->left;
-            } else {
-                prev = curr;
-                curr = (curr->isThreaded) ? nullptr : curr->right;
-            }
+        while (curr != nullptr) {
+            depth++;
+            prev = curr;
+            curr = _step(curr, key, cand);
         }
+        curr = _found(cand, key);
+        this->searched(depth);
     }
 
     // ----------------------
@@ -128,9 +780,9 @@ class mymap {
      * Iteratively updates number of
      * children for each curr node
     */
-    void updateHeight(NODE* prev, NODE* curr, keyType key) {
+    void updateHeight(NODE* prev, NODE* curr, const keyType& key) {
         while (prev != curr) {
-            if (prev->key < key) {
+            if (_less(prev->key(), key)) {
                 prev->nR++;
                 prev = prev->right;
             } else {
@@ -146,8 +798,8 @@ class mymap {
      * inserts the curr node in right position
      * helper function for put()
     */
-    void insertNode(NODE* &prev, NODE* &curr, NODE* &newChild,
-        keyType key, valueType value) {
+    void insertNode(NODE* &prev, NODE* &curr, NODE* &newChild) {
+        const keyType& key = newChild->key();
         curr = newChild;
         if (prev == nullptr) {
             this->root = newChild;
@@ -156,11 +808,15 @@ class mymap {
             this->root->right = nullptr;
             this->root->left = nullptr;
             this->root->isThreaded = true;
+            this->root->isLeftThreaded = true;
 
-        } else if (key < prev->key) {
+        } else if (_less(key, prev->key())) {
             NODE* temp = this->root;
+            curr->left = prev->left;  // prev's predecessor
             prev->left = curr;
+            prev->isLeftThreaded = false;
             curr->right = prev;
+            curr->isLeftThreaded = true;
 
             // update height
             updateHeight(temp, curr, key);
@@ -169,10 +825,12 @@ class mymap {
             curr->nR = 0;
             curr->isThreaded = true;
 
-        } else if (key > prev->key) {
+        } else {  // key is new, so prev < key
             NODE* temp = this->root;
             curr->right = prev->right;
             prev->right = curr;
+            curr->left = prev;
+            curr->isLeftThreaded = true;
 
             updateHeight(temp, curr, key);
 
@@ -187,208 +845,327 @@ class mymap {
 
     /* checkViolater
      * checks if node violates
-     * seesaw balancing property
+     * the Balance policy's balancing property
     */
     bool checkViolater(NODE* curr) {
-        int maxNodes = max(curr->nL, curr->nR);
-        int minNodes = 2 * min(curr->nL, curr->nR) + 1;
+        return Balance::isUnbalanced(curr->nL, curr->nR);
+    }
 
-        if (maxNodes > minNodes)
-            return true;
-        else
-            return false;
+    // ----------------------
+
+    /* checkEraseViolater
+     * checkViolater for a node an erase shrank; a
+     * depth triggered Balance leaves those alone
+    */
+    bool checkEraseViolater(NODE* curr) {
+        return !Balance::depthTriggered && checkViolater(curr);
     }
 
     // ----------------------
 
     /* searchForViolaters
-     * searches for violating node
-     * traversing insertion path
+     * searches for the topmost violating node
+     * traversing insertion path. with a depth
+     * triggered Balance the walk goes on to curr
+     * and the violater only counts if curr landed
+     * too deep
     */
     NODE* searchForViolaters(NODE*& curr, NODE*& violater,
         NODE*& violaterParent) {
         NODE* start = this->root;
+        NODE* parent = nullptr;
+        int depth = 1;
 
         if (start == curr)  // root added, no violations
             return nullptr;
 
-        // check root
-        bool temp = checkViolater(this->root);
-        if (temp == true) {
-            violaterParent = nullptr;
-            violater = start;
-            return violater;
-        }
-
-        // traverse if root is not violater
-        while (start != curr) {
-            if (curr->key < start->key) {
-                // check first left subchild
-                temp = checkViolater(start->left);
-                if (temp == true) {
-                    violater = start->left;
-                    violaterParent = start;
+        while (true) {
+            if (violater == nullptr && checkViolater(start)) {
+                violater = start;
+                violaterParent = parent;
+                if (!Balance::depthTriggered)
                     return violater;
-                }
-                start = start->left;  // move left
+            }
+            if (start == curr)
+                break;
 
-            } else if (curr->key > start->key) {
-                temp = checkViolater(start->right);
-                if (temp == true) {
-                    violater = start->right;
-                    violaterParent = start;
-                    return violater;
-                }
+            parent = start;
+            if (_less(curr->key(), start->key()))
+                start = start->left;  // move left
+            else  // keys differ, so start < curr
                 start = start->right;  // move right
-            }
+            depth++;
         }
+
+        if (violater != nullptr && Balance::depthTriggered
+            && !Balance::isTooDeep(depth, this->size + 1))
+            violater = nullptr;
         return violater;
     }
 
     // ----------------------
 
-    /* _fillVector
-     * recursively fills the vector
-     * with nodes in order
-     * Helper function for violaterExists
+    /* _nextInorder
+     * returns the in-order successor of curr,
+     * following the thread when there is one
     */
-    void _fillVector(NODE* curr, vector<NODE*> &imbalancedNodes) {
-        if (curr == nullptr)
-            return;
-
-        _fillVector(curr->left, imbalancedNodes);
+    static NODE* _nextInorder(NODE* curr) {
+        if (curr->isThreaded)
+            return curr->right;
 
-        imbalancedNodes.push_back(curr);
-        if (curr->isThreaded == false)
-            _fillVector(curr->right, imbalancedNodes);
-        else
-            return;
+        return _firstNode(curr->right);
     }
 
     // ----------------------
 
-    /* threadPtrs
-     * threads the ptrs based of their
-     * parents' key
-     * Helper function for _balanceNodes
+    /* _prevInorder
+     * returns the in-order predecessor of curr,
+     * following the left thread when there is one
     */
-    void threadPtrs(NODE*& prev, NODE*& curr) {
-        if (prev->key < curr->key) {
-            prev->right = curr;
-            prev->isThreaded = true;
-        } else if (prev->key > curr->key) {
-            prev->right = curr->right;
-            prev->isThreaded = true;
-            curr->isThreaded = false;
-        } else if (prev->key == curr->key) {
-            prev->isThreaded = false;
-            return;
-        }
+    static NODE* _prevInorder(NODE* curr) {
+        if (curr->isLeftThreaded)
+            return curr->left;
+
+        return _lastNode(curr->left);
     }
 
     // ----------------------
 
-    /* _balanceNodes
-     * recursive helper function for violaterExists
-     * creates a new subtree with nodes in vector
+    /* _firstNode / _lastNode
+     * leftmost and rightmost node of curr's subtree,
+     * nullptr for an empty subtree
     */
-    NODE* _balanceNodes(vector<NODE*> imbalancedSubTree,
-        int start, int end, NODE* parent) {
-        int middle = (start + end) / 2;
+    static NODE* _firstNode(NODE* curr) {
+        if (curr == nullptr)
+            return nullptr;
+
+        while (!curr->isLeftThreaded)
+            curr = curr->left;
+        return curr;
+    }
 
-        // base case 1
-        if (imbalancedSubTree.size() == 0) {
+    static NODE* _lastNode(NODE* curr) {
+        if (curr == nullptr)
             return nullptr;
-        } else if (imbalancedSubTree.size() == 1) {       // base case 2
-            NODE* subRoot = imbalancedSubTree.at(middle);
-            subRoot->nL = 0;
-            subRoot->nR = 0;
-            subRoot->left = nullptr;
-            subRoot->right = parent->right;
-            subRoot->isThreaded = true;
-            return subRoot;
-        }
 
-        // create subroot with default values
-        NODE* subRoot = imbalancedSubTree.at(middle);
-        subRoot->nL = 0;
-        subRoot->nR = 0;
-        subRoot->left = nullptr;
-        subRoot->right = nullptr;
+        while (!curr->isThreaded)
+            curr = curr->right;
+        return curr;
+    }
 
-        // connect left nodes
-        if (middle - 1 >= start) {
-            subRoot->left = _balanceNodes(imbalancedSubTree,
-                start, middle - 1, subRoot);
-            subRoot->nL = subRoot->left->nL + subRoot->left->nR + 1;
-        }
+    // ----------------------
 
-        threadPtrs(subRoot, parent);
+    /* _nextLive / _prevLive / _skipDead
+     * in-order steps that pass over dead nodes
+     * left behind by lazy erase. _skipDead returns
+     * curr itself when it is live
+    */
+    static NODE* _nextLive(NODE* curr) {
+        do {
+            curr = _nextInorder(curr);
+        } while (curr != nullptr && curr->isDead);
+        return curr;
+    }
 
-        // connect right nodes
-        if (middle + 1 <= end) {
-            subRoot->right = _balanceNodes(imbalancedSubTree,
-                middle + 1, end, subRoot);
-            subRoot->nR = subRoot->right->nL + subRoot->right->nR + 1;
-        }
+    static NODE* _prevLive(NODE* curr) {
+        do {
+            curr = _prevInorder(curr);
+        } while (curr != nullptr && curr->isDead);
+        return curr;
+    }
 
-        return subRoot;
+    static NODE* _skipDead(NODE* curr) {
+        if (curr != nullptr && curr->isDead)
+            return _nextLive(curr);
+        return curr;
     }
 
     // ----------------------
 
-    /* violaterExists
-     * rebalances the subtree by
-     * calling helper functions
+    /* _relinkNodes
+     * recursive helper function for violaterExists
+     * relinks the next n nodes reached from cursor
+     * (in order) into a balanced subtree. cursor is
+     * advanced before a node is touched, so the
+     * original links ahead of it are still intact
     */
-    NODE* violaterExists(NODE* violater, vector<NODE*> imbalancedNodes) {
-        NODE* subTreeRoot;
+    NODE* _relinkNodes(NODE*& cursor, int n, NODE*& lastNode) {
+        if (n <= 0)
+            return nullptr;
 
-        _fillVector(violater, imbalancedNodes);
-        int left = 0;
-        int right = imbalancedNodes.size() - 1;
-        int midIndex = (left + right) / 2;
+        int nLeft = (n - 1) / 2;
+        int nRight = n - 1 - nLeft;
 
-        // insert nodes - create subtree, balance and rethread
-        subTreeRoot = _balanceNodes(imbalancedNodes, left, right
-            , imbalancedNodes.at(midIndex));
+        NODE* left = _relinkNodes(cursor, nLeft, lastNode);
 
-        return subTreeRoot;
+        NODE* subRoot = cursor;
+        cursor = _nextInorder(subRoot);
+
+        // no left subtree: thread left to the in-order predecessor
+        subRoot->left = (left != nullptr) ? left : lastNode;
+        subRoot->isLeftThreaded = (left == nullptr);
+        subRoot->nL = nLeft;
+        subRoot->nR = nRight;
+        subRoot->nDead = 0;
+        subRoot->isThreaded = true;
+
+        // thread the in-order predecessor to this node
+        if (lastNode != nullptr)
+            lastNode->right = subRoot;
+        lastNode = subRoot;
+
+        NODE* right = _relinkNodes(cursor, nRight, lastNode);
+        if (right != nullptr) {
+            subRoot->right = right;
+            subRoot->isThreaded = false;
+        }
+        return subRoot;
     }
 
     // ----------------------
 
-  /* _BSTPrintInorder
-   * recursive helper function for toString()
-  */
-    void _BSTPrintInorder(NODE* node, stringstream& temp) {
-        if (node == nullptr)
-            return;
-
-        _BSTPrintInorder(node->left, temp);
-        temp << "key: " << node->key << " "
-            << "value: " << node->value << endl;
+    /* _forgetDead
+     * takes the dead nodes of n's subtree off the
+     * counts of n's ancestors, before they are freed
+    */
+    void _forgetDead(NODE* n) {
+        NODE* curr = this->root;
 
-        if (node->isThreaded == false)
-            _BSTPrintInorder(node->right, temp);
-        else
-            return;
+        while (curr != n) {
+            curr->nDead -= n->nDead;
+            curr = _less(n->key(), curr->key()) ? curr->left : curr->right;
+        }
     }
 
     // ----------------------
 
-    /* _BSTPrintBalance
-     * recursive helper function for checkBalance
+    /* _unlinkDead
+     * helper function for violaterExists
+     * walks first to last in order, frees the dead
+     * nodes and threads the live ones one after the
+     * other so _relinkNodes can walk them. returns
+     * the first live node, nullptr if there is none
     */
-    void _BSTPrintBalance(NODE* node, stringstream& temp) {
-        if (node == nullptr)
+    NODE* _unlinkDead(NODE* first, NODE* last) {
+        NODE* head = nullptr;
+        NODE* tail = nullptr;
+        NODE* curr = first;
+
+        while (curr != nullptr) {
+            // step past curr before it is freed or rethreaded
+            NODE* next = (curr == last) ? nullptr : _nextInorder(curr);
+
+            if (curr->isDead) {
+                pool.destroy(curr);
+                pool.deallocate(curr);
+            } else {
+                if (tail != nullptr) {
+                    tail->right = curr;
+                    tail->isThreaded = true;
+                } else {
+                    head = curr;
+                }
+                tail = curr;
+            }
+            curr = next;
+        }
+
+        if (tail != nullptr) {
+            tail->right = nullptr;
+            tail->isThreaded = true;
+        }
+        return head;
+    }
+
+    // ----------------------
+
+    /* violaterExists
+     * rebalances the violater's subtree in place
+     * by relinking its nodes along the threads and
+     * links it back below violaterParent (nullptr
+     * for the root). dead nodes in the subtree are
+     * freed on the way, no nodes are allocated
+    */
+    NODE* violaterExists(NODE* violater, NODE* violaterParent) {
+        int count = violater->nL + violater->nR + !violater->isDead;
+        this->rebalanced(count + violater->nDead);
+
+        bool isLeftChild = violaterParent != nullptr
+            && !violaterParent->isLeftThreaded
+            && violaterParent->left == violater;
+
+        // first and last node of the subtree and their outside neighbours
+        NODE* first = _firstNode(violater);
+        NODE* last = _lastNode(violater);
+        NODE* predecessor = first->left;
+        NODE* successor = last->right;
+
+        if (violater->nDead > 0) {
+            _forgetDead(violater);
+            first = _unlinkDead(first, last);
+        }
+
+        // relink nodes - create subtree, balance and rethread
+        NODE* subTreeRoot = nullptr;
+        if (count > 0) {
+            NODE* cursor = first;
+            NODE* lastNode = nullptr;
+            subTreeRoot = _relinkNodes(cursor, count, lastNode);
+            first->left = predecessor;
+            lastNode->right = successor;
+        }
+
+        // updating original parent ptrs, an emptied subtree becomes
+        // a thread again
+        if (violaterParent == nullptr) {
+            this->root = subTreeRoot;
+        } else if (isLeftChild) {
+            violaterParent->left = subTreeRoot ? subTreeRoot : predecessor;
+            violaterParent->isLeftThreaded = (subTreeRoot == nullptr);
+        } else {
+            violaterParent->right = subTreeRoot ? subTreeRoot : successor;
+            violaterParent->isThreaded = (subTreeRoot == nullptr);
+        }
+        return subTreeRoot;
+    }
+
+    // ----------------------
+
+  /* _BSTPrintInorder
+   * recursive helper function for toString()
+  */
+    void _BSTPrintInorder(NODE* node, stringstream& temp) const {
+        if (node == nullptr)
+            return;
+
+        if (node->isLeftThreaded == false)
+            _BSTPrintInorder(node->left, temp);
+        if (!node->isDead) {
+            temp << "key: " << node->key() << " "
+                << "value: " << node->value() << endl;
+        }
+
+        if (node->isThreaded == false)
+            _BSTPrintInorder(node->right, temp);
+        else
+            return;
+    }
+
+    // ----------------------
+
+    /* _BSTPrintBalance
+     * recursive helper function for checkBalance
+    */
+    void _BSTPrintBalance(NODE* node, stringstream& temp) const {
+        if (node == nullptr)
             return;
 
-        temp << "key: " << node->key << ", "
+        temp << "key: " << node->key() << ", "
             << "nL: " << node->nL << ", "
             << "nR: " << node->nR << endl;
 
-        _BSTPrintBalance(node->left, temp);
+        if (node->isLeftThreaded == false)
+            _BSTPrintBalance(node->left, temp);
 
         if (node->isThreaded == false)
             _BSTPrintBalance(node->right, temp);
@@ -403,13 +1180,15 @@ class mymap {
      * references back a vector of nodes
     */
     void _toVectorPrint(NODE* node,
-        vector<pair<keyType, valueType>> &temp) {
+        vector<pair<keyType, valueType>> &temp) const {
         if (node == nullptr)
             return;
 
-        _toVectorPrint(node->left, temp);
+        if (node->isLeftThreaded == false)
+            _toVectorPrint(node->left, temp);
 
-        temp.push_back(make_pair(node->key, node->value));
+        if (!node->isDead)
+            temp.push_back(make_pair(node->key(), node->value()));
 
         if (node->isThreaded == false)
             _toVectorPrint(node->right, temp);
@@ -420,18 +1199,21 @@ class mymap {
     // ----------------------
 
     /* _clearNodes
-     * recursive helper function for clear 
+     * recursive helper function for clear
+     * runs node destructors, storage is
+     * released by the pool afterwards
     */
     void _clearNode(NODE* curr) {
         if (curr == nullptr)
             return;
 
-        _clearNode(curr->left);
+        if (curr->isLeftThreaded == false)
+            _clearNode(curr->left);
         if (curr->isThreaded == false)
             _clearNode(curr->right);
 
         this->size--;
-        delete curr;
+        pool.destroy(curr);
     }
 
     // ----------------------
@@ -439,149 +1221,191 @@ class mymap {
     /* _copyNodes
      * recursive helper function
      * for copy constructor and
-     * operator=
+     * operator=, clones the shape of
+     * other's subtree. predecessor and
+     * successor are the in-order nodes
+     * the subtree's ends thread to
     */
-    void _copyNodes(NODE* other) {
+    NODE* _copyNodes(NODE* other, NODE* predecessor, NODE* successor) {
         if (other == nullptr)
-            return;
+            return nullptr;
 
-        _copyNodes(other->left);
-        if (other->isThreaded == false)
-            _copyNodes(other->right);
-        this->put(other->key, other->value);
-    }
+        NODE* curr = _createNode(other->key(), other->value());
+        curr->nL = other->nL;
+        curr->nR = other->nR;
+        curr->nDead = other->nDead;
+        curr->isDead = other->isDead;
+
+        if (other->isLeftThreaded == false) {
+            curr->left = _copyNodes(other->left, predecessor, curr);
+            curr->isLeftThreaded = false;
+        } else {
+            curr->left = predecessor;
+            curr->isLeftThreaded = true;
+        }
 
-    // ----------------------
- public:
-    /* default constructor :
-     * Creates an empty mymap.
-     * Time complexity: O(1)
-    */
-    mymap() {
-        this->root = nullptr;
-        this->size = 0;
+        if (other->isThreaded == false) {
+            curr->right = _copyNodes(other->right, curr, successor);
+            curr->isThreaded = false;
+        } else {
+            curr->right = successor;
+            curr->isThreaded = true;
+        }
+        return curr;
     }
 
     // ----------------------
 
-    /* copy constructor:
-     * Constructs a new mymap which is a copy of the "other" mymap.
-     * Sets all member variables appropriately.
-     * Time complexity: O(nlogn), where n is total number of nodes in threaded,
-     * self-balancing BST.
+    /* _buildSorted
+     * recursive helper function for assignSorted
+     * builds a balanced subtree of n nodes from it
+     * in order, lastNode is threaded to each new node
     */
-    mymap(const mymap& other) {
-        // copy root
-        this->root = new NODE();
-        this->root->key = other.root->key;
-        this->root->value = other.root->value;
-        this->size = 1;
+    template<typename Iter>
+    NODE* _buildSorted(Iter& it, int n, NODE*& lastNode) {
+        if (n <= 0)
+            return nullptr;
 
-        // copy nodes
-        _copyNodes(other.root);
-    }
+        int nLeft = (n - 1) / 2;
+        int nRight = n - 1 - nLeft;
 
-    // ----------------------
+        NODE* left = _buildSorted(it, nLeft, lastNode);
 
-    /* operator=:
-     * Clears "this" mymap and then makes a copy of the "other" mymap.
-     * Sets all member variables appropriately.
-     * Time complexity: O(nlogn), where n is total number of nodes in threaded,
-     * self-balancing BST.
-    */
-    mymap& operator=(const mymap& other) {
-        // not a self assignment
-        if (this == &other)
-            return *this;
+        NODE* curr = _createNode(it->first, it->second);
+        ++it;
+        curr->left = (left != nullptr) ? left : lastNode;
+        curr->isLeftThreaded = (left == nullptr);
+        curr->nL = nLeft;
+        curr->nR = nRight;
 
-        // deallocate prev memory
-        this->clear();
+        // thread the in-order predecessor to this node
+        if (lastNode != nullptr)
+            lastNode->right = curr;
+        lastNode = curr;
 
-        // copy root first
-        this->root = new NODE();
-        this->root->key = other.root->key;
-        this->root->value = other.root->value;
-        this->size = 1;
+        NODE* right = _buildSorted(it, nRight, lastNode);
+        if (right != nullptr) {
+            curr->right = right;
+            curr->isThreaded = false;
+        }
+        return curr;
+    }
 
-        // copy nodes
-        _copyNodes(other.root);
+    // ----------------------
 
-        return *this;
+    /* _findNode
+     * returns the node holding key, nullptr if key
+     * is not in mymap (or was erased)
+    */
+    template<typename K>
+    NODE* _findNode(const K& key) const {
+        NODE* curr = this->root;
+        NODE* cand = nullptr;
+        int depth = 0;
+
+        while (curr != nullptr) {
+            depth++;
+            curr = _step(curr, key, cand);
+        }
+        this->searched(depth);
+        curr = _found(cand, key);
+        return (curr != nullptr && !curr->isDead) ? curr : nullptr;
     }
 
     // ----------------------
 
-    /* clear:
-     * Frees the memory associated with the mymap; can be used for testing.
-     * Time complexity: O(n), where n is total number of nodes in threaded,
-     * self-balancing BST.
+    /* _prefetch
+     * starts loading curr's cache line, a hint only
     */
-    void clear() {
-        _clearNode(this->root);
-        this->root = nullptr;
+    static void _prefetch(const NODE* curr) {
+#if defined(__GNUC__)
+        __builtin_prefetch(curr);
+#else
+        (void)curr;
+#endif
     }
 
     // ----------------------
 
-    /* destructor:
-     * Frees the memory associated with the mymap.
-     * Time complexity: O(n), where n is total number of nodes in threaded,
-     * self-balancing BST.
+    /* _findMany
+     * _findNode for every key in [first, last), in
+     * groups of lookupGroup searches that go down
+     * one level per round. each search prefetches
+     * its next node, which loads while the rest of
+     * the group compare. emit(node) gets the results
+     * in order, nullptr for a key not found
+     * helper function for getMany and containsMany
     */
-    ~mymap() { this->clear(); }
+    template<typename Iter, typename Emit>
+    void _findMany(Iter first, Iter last, Emit emit) const {
+        typedef typename iterator_traits<Iter>::value_type K;
+        const K* keys[lookupGroup];
+        NODE* curr[lookupGroup];
+        NODE* cand[lookupGroup];  // see _step
+        int depth[lookupGroup];
+        int active[lookupGroup];  // searches still going, [0, left)
+
+        while (first != last) {
+            int n = 0;
+            for (; n < lookupGroup && first != last; ++n, ++first) {
+                keys[n] = &*first;
+                curr[n] = this->root;
+                cand[n] = nullptr;
+                depth[n] = 0;
+                active[n] = n;
+            }
+
+            if (n == 1) {  // nothing to overlap with
+                emit(_findNode(*keys[0]));
+                continue;
+            }
+
+            int left = (this->root != nullptr) ? n : 0;
+            while (left > 0) {
+                for (int a = 0; a < left; ) {
+                    int i = active[a];
+                    depth[i]++;
+                    NODE* next = _step(curr[i], *keys[i], cand[i]);
+
+                    if (next == nullptr) {  // done, leaves the rounds
+                        active[a] = active[--left];
+                    } else {
+                        _prefetch(next);
+                        curr[i] = next;
+                        a++;
+                    }
+                }
+            }
+
+            for (int i = 0; i < n; i++) {
+                this->searched(depth[i]);
+                NODE* found = _found(cand[i], *keys[i]);
+                emit((found != nullptr && !found->isDead) ? found : nullptr);
+            }
+        }
+    }
 
     // ----------------------
 
-    /* put:
-     * Inserts the key/value into the threaded, self-balancing BST based on
-     * the key.
-     * Time complexity: O(logn + mlogm), where n is total number of nodes in the
-     * threaded, self-balancing BST and m is the number of nodes in the
-     * sub-tree that needs to be re-balanced.
-     * Space complexity: O(1)
+    /* _linkNode
+     * links new node n below prev, then rebalances
+     * helper function for put(), emplace() and try_emplace()
     */
-    void put(keyType key, valueType value) {
-        vector<NODE*> imbalancedNodes;
+    void _linkNode(NODE* prev, NODE* n) {
         NODE* violaterParent = this->root;
         NODE* violater = nullptr;
-        NODE* subTreeRoot = nullptr;
-        NODE* prev = nullptr;
-        NODE* curr = this->root;
-
-        // check for key, return if found
-        searchForKeyandMovePtrs(prev, curr, key);
-        if (curr != nullptr && key == curr->key) {
-            curr->value = value;
-            return;
-        }
-
-        // create new node
-        NODE* n = new NODE();
-        n->key = key;
-        n->value = value;
-        n->isThreaded = false;
+        NODE* curr = nullptr;
 
         // insert node in order
-        insertNode(prev, curr, n, key, value);
+        n->isThreaded = false;
+        insertNode(prev, curr, n);
 
-        // check seesaw balanced property along insertion path
+        // check Balance property along insertion path
         violater = searchForViolaters(curr, violater, violaterParent);
 
-        // balance here, pass violater and violaterParenr as arguments
+        // balance here, pass violater and violaterParent as arguments
         if (violater != nullptr)
-            subTreeRoot = violaterExists(violater, imbalancedNodes);
-
-        // updating original parent ptrs
-        if (subTreeRoot != nullptr && violaterParent != nullptr) {
-            if (violaterParent->key < subTreeRoot->key) {
-                violaterParent->right = subTreeRoot;
-            } else if (violaterParent->key > subTreeRoot->key) {
-                violaterParent->left = subTreeRoot;
-            }
-
-        } else if (subTreeRoot != nullptr && violaterParent == nullptr) {
-            this->root = subTreeRoot;
-        }
+            violaterExists(violater, violaterParent);
 
         // increment size
         this->size++;
@@ -589,159 +1413,2273 @@ class mymap {
 
     // ----------------------
 
-    /*contains:
-     * Returns true if the key is in mymap, return false if not.
-     * Time complexity: O(logn), where n is total number of nodes in the
-     * threaded, self-balancing BST
+    /* _reviveNode
+     * puts a dead node found by a put back in use:
+     * its path counts it as live again and is then
+     * rebalanced like an insertion
     */
-    bool contains(keyType key) {
+    void _reviveNode(NODE* n) {
+        NODE* violaterParent = this->root;
+        NODE* violater = nullptr;
         NODE* curr = this->root;
 
-        while (curr != nullptr) {
-            if (key == curr->key)
-                return true;
-            else if (key < curr->key)
+        while (curr != n) {
+            curr->nDead--;
+            if (_less(n->key(), curr->key())) {
+                curr->nL++;
                 curr = curr->left;
-            else if (key > curr->key)
-                curr = (curr->isThreaded) ? nullptr : curr->right;
+            } else {
+                curr->nR++;
+                curr = curr->right;
+            }
         }
-        return false;
+        n->nDead--;
+        n->isDead = false;
+
+        violater = searchForViolaters(n, violater, violaterParent);
+        if (violater != nullptr)
+            violaterExists(violater, violaterParent);
+
+        this->size++;
     }
 
     // ----------------------
 
-    /* get:
-     * Returns the value for the given key; if the key is not found, the
-     * default value, valueType(), is returned (but not added to mymap).
-     * Time complexity: O(logn), where n is total number of nodes in the
-     * threaded, self-balancing BST
+    /* _removeNode
+     * unlinks live node x and frees it; when x has
+     * two children its in-order successor s moves
+     * into x's place. then rebuilds the topmost node
+     * the removal put out of balance
+     * helper function for erase
     */
-    valueType get(keyType key) {
+    void _removeNode(NODE* x) {
+        NODE* parent = nullptr;
+        NODE* violater = nullptr;
+        NODE* violaterParent = nullptr;
         NODE* curr = this->root;
 
-        while (curr != nullptr) {
-            if (key == curr->key)
-                return curr->value;
-            else if (key < curr->key)
-                curr = curr->left;
-            else if (key > curr->key)
-                curr = (curr->isThreaded) ? nullptr : curr->right;
+        // every ancestor of x loses one live node
+        while (curr != x) {
+            bool goLeft = _less(x->key(), curr->key());
+            if (goLeft)
+                curr->nL--;
+            else
+                curr->nR--;
+
+            if (violater == nullptr && checkEraseViolater(curr)) {
+                violater = curr;
+                violaterParent = parent;
+            }
+            parent = curr;
+            curr = goLeft ? curr->left : curr->right;
+        }
+
+        NODE* replacement = nullptr;
+        if (x->isLeftThreaded && x->isThreaded) {  // leaf
+            replacement = nullptr;
+
+        } else if (x->isThreaded) {  // left child only
+            replacement = x->left;
+            _lastNode(x->left)->right = x->right;
+
+        } else if (x->isLeftThreaded) {  // right child only
+            replacement = x->right;
+            _firstNode(x->right)->left = x->left;
+
+        } else {  // two children
+            NODE* s = _firstNode(x->right);
+            int sLive = s->isDead ? 0 : 1;
+            NODE* spineViolater = nullptr;
+            NODE* spineParent = nullptr;
+            NODE* sParent = s;  // node above the spine, s once it moves
+
+            // the left spine from x->right down to s loses s
+            for (NODE* n = x->right; n != s; n = n->left) {
+                n->nL -= sLive;
+                n->nDead -= 1 - sLive;
+                if (spineViolater == nullptr && checkEraseViolater(n)) {
+                    spineViolater = n;
+                    spineParent = sParent;
+                }
+                sParent = n;
+            }
+
+            if (sParent != s) {
+                // s has no left child, its right subtree takes its place
+                if (s->isThreaded) {
+                    sParent->left = s;
+                    sParent->isLeftThreaded = true;
+                } else {
+                    sParent->left = s->right;
+                }
+                s->right = x->right;
+                s->isThreaded = false;
+            }
+
+            s->left = x->left;
+            s->isLeftThreaded = false;
+            _lastNode(x->left)->right = s;
+            s->nL = x->nL;
+            s->nR = x->nR - sLive;
+            s->nDead = x->nDead;
+            replacement = s;
+
+            if (violater == nullptr && checkEraseViolater(s)) {
+                violater = s;
+                violaterParent = parent;
+            } else if (violater == nullptr) {
+                violater = spineViolater;
+                violaterParent = spineParent;
+            }
+        }
+
+        // link the replacement below x's parent, or thread past x
+        if (parent == nullptr) {
+            this->root = replacement;
+        } else if (!parent->isLeftThreaded && parent->left == x) {
+            parent->left = replacement ? replacement : x->left;
+            parent->isLeftThreaded = (replacement == nullptr);
+        } else {
+            parent->right = replacement ? replacement : x->right;
+            parent->isThreaded = (replacement == nullptr);
         }
 
-        return valueType();
+        pool.destroy(x);
+        pool.deallocate(x);
+        this->size--;
+
+        if (violater != nullptr)
+            violaterExists(violater, violaterParent);
     }
 
     // ----------------------
 
-    /* operator[]:
-     * Returns the value for the given key; if the key is not found,
-     * the default value, valueType(), is returned (and the resulting new
-     * key/value pair is inserted into the map).
-     * Time complexity: O(logn + mlogm), where n is total number of nodes in the
-     * threaded, self-balancing BST and m is the number of nodes in the
-     * sub-trees that need to be re-balanced.
-     * Space complexity: O(1)
+    /* _markDead
+     * lazy erase: x stays in the tree as a tombstone
+     * and only the counts on its path change. the
+     * topmost subtree on the path that is now mostly
+     * dead is compacted
+     * helper function for erase
     */
-    valueType operator[](keyType key) {
+    void _markDead(NODE* x) {
+        NODE* parent = nullptr;
+        NODE* target = nullptr;
+        NODE* targetParent = nullptr;
         NODE* curr = this->root;
-        NODE* prev = nullptr;
 
-        searchForKeyandMovePtrs(prev, curr, key);
-        if (curr != nullptr && key == curr->key)  // return value if found
-            return curr->value;
+        x->value() = valueType();  // release what the value holds now
+        x->isDead = true;
+
+        while (true) {
+            bool goLeft = (curr != x) && _less(x->key(), curr->key());
+            if (curr != x && goLeft)
+                curr->nL--;
+            else if (curr != x)
+                curr->nR--;
+            curr->nDead++;
+
+            // more dead than live nodes below curr
+            int live = curr->nL + curr->nR + !curr->isDead;
+            if (target == nullptr && curr->nDead > live) {
+                target = curr;
+                targetParent = parent;
+            }
 
-        // create new node and insert in map
-        this->put(key, valueType());
+            if (curr == x)
+                break;
+            parent = curr;
+            curr = goLeft ? curr->left : curr->right;
+        }
+        this->size--;
 
-        return valueType();
+        if (target != nullptr)
+            violaterExists(target, targetParent);
     }
 
     // ----------------------
 
-    /* Size:
-     * Returns the # of key/value pairs in the mymap, 0 if empty.
-     * O(1)
+    /* _put
+     * forwards key and value into mymap,
+     * helper function for both put() overloads
     */
-    int Size() { return this->size; }
+    template<typename K, typename V>
+    void _put(K&& key, V&& value) {
+        NODE* prev = nullptr;
+        NODE* curr = this->root;
+
+        // check for key, return if found
+        searchForKeyandMovePtrs(prev, curr, key);
+        if (curr != nullptr) {
+            curr->value() = std::forward<V>(value);
+            if (curr->isDead)
+                _reviveNode(curr);
+            return;
+        }
+
+        // create new node
+        NODE* n = _createNode(std::forward<K>(key), std::forward<V>(value));
+        _linkNode(prev, n);
+    }
 
     // ----------------------
 
-    /* begin:
-     * returns an iterator to the first in order NODE.
-     * Time complexity: O(logn), where n is total number of nodes in the
-     * threaded, self-balancing BST
+    /* _tryEmplace
+     * helper function for try_emplace() and operator[],
+     * the value is only constructed when key is new
     */
-    iterator begin() {
+    template<typename K, typename... Args>
+    pair<NODE*, bool> _tryEmplace(K&& key, Args&&... args) {
+        NODE* prev = nullptr;
         NODE* curr = this->root;
-        if (curr == nullptr)
-            return iterator(nullptr);
 
-        while (curr->left != nullptr)
-            curr = curr->left;
+        searchForKeyandMovePtrs(prev, curr, key);
+        if (curr != nullptr && !curr->isDead)
+            return make_pair(curr, false);
 
-        return iterator(curr);
+        if (curr != nullptr) {  // erased key, its node is reused
+            curr->value() = valueType(std::forward<Args>(args)...);
+            _reviveNode(curr);
+            return make_pair(curr, true);
+        }
+
+        NODE* n = _createNode(std::forward<K>(key),
+            std::forward<Args>(args)...);
+        _linkNode(prev, n);
+        return make_pair(n, true);
     }
 
     // ----------------------
 
-    /* end:
-     * returns an iterator to the last in order NODE.
-     * this function is given to you.
-     * Time Complexity: O(1)
+    /* _countLess
+     * counts the keys < key (or <= key when
+     * orEqual), one comparison per level using
+     * the nL subtree counts.
+     * helper function for rank and countRange
     */
-    iterator end() { return iterator(nullptr); }
+    int _countLess(const keyType& key, bool orEqual) const {
+        NODE* curr = this->root;
+        int count = 0;
+
+        while (curr != nullptr) {
+            bool goRight = orEqual ? !_less(key, curr->key())
+                : _less(curr->key(), key);
+            if (goRight) {
+                count += curr->nL + !curr->isDead;
+                curr = (curr->isThreaded) ? nullptr : curr->right;
+            } else {
+                curr = (curr->isLeftThreaded) ? nullptr : curr->left;
+            }
+        }
+        return count;
+    }
 
     // ----------------------
 
-    /* toString:
-     * Returns a string of the entire mymap, in order.
-     * Format for 8/80, 15/150, 20/200:
-     * "key: 8 value: 80\nkey: 15 value: 150\nkey: 20 value: 200\n
-     * Time complexity: O(n), where n is total number of nodes in the
-     * threaded, self-balancing BST
+    /* _lowerBoundNode
+     * returns the first node whose key is not
+     * less than key, nullptr if there is none
     */
-    string toString() {
+    template<typename K>
+    NODE* _lowerBoundNode(const K& key) const {
         NODE* curr = this->root;
-        stringstream ss;
-        _BSTPrintInorder(curr, ss);
+        NODE* bound = nullptr;
+        int depth = 0;
 
-        return ss.str();
+        while (curr != nullptr) {
+            depth++;
+            if (_less(curr->key(), key)) {
+                curr = (curr->isThreaded) ? nullptr : curr->right;
+            } else {
+                bound = curr;
+                curr = (curr->isLeftThreaded) ? nullptr : curr->left;
+            }
+        }
+        this->searched(depth);
+        return _skipDead(bound);
     }
 
     // ----------------------
 
-    /* toVector:
-     * Returns a vector of the entire map, in order.  For 8/80, 15/150, 20/200:
-     * {{8, 80}, {15, 150}, {20, 200}}
-     * Time complexity: O(n), where n is total number of nodes in the
-     * threaded, self-balancing BST
+    /* _upperBoundNode
+     * returns the first node whose key is
+     * greater than key, nullptr if there is none
     */
-    vector<pair<keyType, valueType>> toVector() {
-        vector<pair<keyType, valueType>> mapVector;
+    template<typename K>
+    NODE* _upperBoundNode(const K& key) const {
         NODE* curr = this->root;
+        NODE* bound = nullptr;
+        int depth = 0;
 
-        _toVectorPrint(curr, mapVector);
-
-        return mapVector;
+        while (curr != nullptr) {
+            depth++;
+            if (_less(key, curr->key())) {
+                bound = curr;
+                curr = (curr->isLeftThreaded) ? nullptr : curr->left;
+            } else {
+                curr = (curr->isThreaded) ? nullptr : curr->right;
+            }
+        }
+        this->searched(depth);
+        return _skipDead(bound);
     }
 
     // ----------------------
 
-    /* checkBalance:
-     * Returns a string of mymap that verifies that the tree is properly
-     * balanced.  For example, if keys: 1, 2, 3 are inserted in that order,
-     * function should return a string in this format (in pre-order):
-     * "key: 2, nL: 1, nR: 1\nkey: 1, nL: 0, nR: 0\nkey: 3, nL: 0, nR: 0\n";
-     * Time complexity: O(n), where n is total number of nodes in the
+    /* _selectNode
+     * returns the node with k keys before it,
+     * nullptr if k is out of range.
+     * helper function for select and percentile
+    */
+    NODE* _selectNode(int k) const {
+        NODE* curr = this->root;
+
+        if (k < 0 || k >= this->size)
+            return nullptr;
+
+        while (curr != nullptr) {
+            int here = curr->isDead ? 0 : 1;
+            if (k < curr->nL) {
+                curr = curr->left;
+            } else if (k < curr->nL + here) {
+                return curr;
+            } else {
+                k -= curr->nL + here;
+                curr = curr->right;
+            }
+        }
+        return nullptr;
+    }
+
+    // ----------------------
+
+    /* _dropNode
+     * destroys n and hands its slot back to the pool
+    */
+    void _dropNode(NODE* n) {
+        pool.destroy(n);
+        pool.deallocate(n);
+    }
+
+    // ----------------------
+
+    /* _dropCreated
+     * frees the nodes a merge created before something
+     * threw; a nullptr slot was never filled
+    */
+    void _dropCreated(const vector<NODE*>& created) {
+        for (NODE* n : created) {
+            if (n != nullptr)
+                _dropNode(n);
+        }
+    }
+
+    // ----------------------
+
+    /* _appendVine
+     * appends n to the in-order list (vine) built by
+     * _relinkMerged, every node threads to the next one
+    */
+    void _appendVine(NODE* n, NODE*& head, NODE*& tail, int& count) {
+        n->left = nullptr;
+        n->right = nullptr;
+        n->isThreaded = true;
+        n->isLeftThreaded = true;
+
+        if (tail != nullptr)
+            tail->right = n;
+        else
+            head = n;
+        tail = n;
+        count++;
+    }
+
+    // ----------------------
+
+    /* _relinkMerged
+     * second half of a merge, which cannot throw: the
+     * nodes of merged (in order) marked kept are
+     * threaded into one vine and relinked into a
+     * balanced tree once, the others are freed
+     * helper function for _mergeBatch and _combine
+    */
+    void _relinkMerged(const vector<pair<NODE*, bool>>& merged) {
+        NODE* head = nullptr;
+        NODE* tail = nullptr;
+        int count = 0;
+
+        for (const pair<NODE*, bool>& step : merged) {
+            if (step.second) {
+                step.first->isDead = false;
+                _appendVine(step.first, head, tail, count);
+            } else {
+                _dropNode(step.first);
+            }
+        }
+
+        NODE* lastNode = nullptr;
+        this->root = _relinkNodes(head, count, lastNode);
+        if (lastNode != nullptr)
+            lastNode->right = nullptr;
+        this->size = count;
+    }
+
+    // ----------------------
+
+    /* _mergeBatch
+     * merges a sorted, duplicate free batch with the
+     * nodes already in mymap, then relinks them into a
+     * balanced tree once. existing nodes are reused,
+     * only new keys get nodes. every node is created
+     * and every value set before a link changes, so if
+     * one throws the tree is left as it was, bar the
+     * values already set
+     * helper function for putBatch and insert
+    */
+    void _mergeBatch(vector<pair<keyType, valueType>>& batch,
+        bool overwrite) {
+        NODE* old = _firstNode(this->root);
+        vector<pair<NODE*, bool>> merged;  // every node in order, kept?
+        vector<NODE*> created;
+        size_t i = 0;
+
+        pool.reserve(batch.size());
+        try {
+            while (old != nullptr || i < batch.size()) {
+                bool takeOld = (i == batch.size()) || (old != nullptr
+                    && !_less(batch[i].first, old->key()));
+
+                if (takeOld) {
+                    NODE* curr = old;
+                    old = _nextInorder(old);
+
+                    // unused tombstones are dropped by the rebuild
+                    bool kept = !curr->isDead;
+                    if (i < batch.size()
+                        && !_less(curr->key(), batch[i].first)) {
+                        if (overwrite || curr->isDead)
+                            curr->value() = std::move(batch[i].second);
+                        kept = true;
+                        i++;
+                    }
+                    merged.push_back(make_pair(curr, kept));
+                } else {
+                    created.push_back(nullptr);
+                    created.back() = _createNode(std::move(batch[i].first),
+                        std::move(batch[i].second));
+                    i++;
+                    merged.push_back(make_pair(created.back(), true));
+                }
+            }
+        } catch (...) {
+            _dropCreated(created);
+            throw;
+        }
+        _relinkMerged(merged);
+    }
+
+    // ----------------------
+
+    /* _putBatch
+     * helper function for putBatch and insert,
+     * picks incremental puts for small batches and
+     * one merge and rebuild for large ones
+    */
+    template<typename Iter>
+    void _putBatch(Iter first, Iter last, bool sorted, bool overwrite) {
+        double b = double(distance(first, last));
+        if (b == 0)
+            return;
+
+        // each put costs ~log(n + b), a merge touches all n + b nodes
+        if (b * log2(this->size + b + 1) < this->size + b) {
+            for (; first != last; ++first) {
+                if (overwrite)
+                    this->put(first->first, first->second);
+                else
+                    this->try_emplace(first->first, first->second);
+            }
+            return;
+        }
+
+        vector<pair<keyType, valueType>> batch(first, last);
+        if (!sorted) {
+            stable_sort(batch.begin(), batch.end(),
+                [this](const pair<keyType, valueType>& a,
+                    const pair<keyType, valueType>& b) {
+                    return _less(a.first, b.first);
+                });
+        }
+
+        // drop duplicate keys, the last one wins like repeated put()
+        // and the first one wins like repeated try_emplace()
+        size_t kept = 0;
+        for (size_t i = 0; i < batch.size(); i++) {
+            if (kept > 0 && !_less(batch[kept - 1].first, batch[i].first)) {
+                if (overwrite)
+                    batch[kept - 1].second = std::move(batch[i].second);
+                continue;
+            }
+            if (kept != i)
+                batch[kept] = std::move(batch[i]);
+            kept++;
+        }
+        batch.erase(batch.begin() + kept, batch.end());
+
+        _mergeBatch(batch, overwrite);
+    }
+
+    // ----------------------
+
+    /* _conflictResolver
+     * resolves a key found in both maps by
+     * mymap_conflict for _combine
+    */
+    struct _conflictResolver {
+        mymap_conflict policy;
+
+        void operator()(const keyType&, valueType& ours,
+            const valueType& theirs) const {
+            if (policy == TAKE_THEIRS)
+                ours = theirs;
+        }
+
+        void operator()(const keyType&, valueType& ours,
+            valueType&& theirs) const {
+            if (policy == TAKE_THEIRS)
+                ours = std::move(theirs);
+        }
+    };
+
+    // ----------------------
+
+    /* _combine
+     * walks mymap's nodes and other's (from theirs)
+     * in order together and relinks the nodes kept
+     * into one balanced tree. keys only in mymap stay
+     * if keepOurs, keys only in other are added if
+     * keepTheirs and keys in both stay if keepBoth,
+     * their values settled by resolve(key, ours,
+     * theirs). with steal other's nodes are relinked
+     * instead of copied and the rest are freed, its
+     * pool must have been adopted first. every copy
+     * is made and every conflict resolved before a
+     * link changes: if one throws the tree is left as
+     * it was, bar the values already resolved, and
+     * the stolen nodes are freed
+     * helper function for mergeFrom, intersectWith
+     * and differenceWith
+    */
+    template<typename Resolve>
+    void _combine(NODE* theirs, bool steal, bool keepOurs, bool keepTheirs,
+        bool keepBoth, Resolve resolve) {
+        NODE* ours = _firstNode(this->root);
+        NODE* firstTheirs = theirs;
+        vector<pair<NODE*, bool>> merged;  // every node in order, kept?
+        vector<NODE*> created;
+
+        try {
+            while (ours != nullptr || theirs != nullptr) {
+                // tombstones are dropped by the rebuild, other's if stolen
+                if (ours != nullptr && ours->isDead) {
+                    merged.push_back(make_pair(ours, false));
+                    ours = _nextInorder(ours);
+                    continue;
+                }
+                if (theirs != nullptr && theirs->isDead) {
+                    if (steal)
+                        merged.push_back(make_pair(theirs, false));
+                    theirs = _nextInorder(theirs);
+                    continue;
+                }
+
+                bool onlyOurs = (theirs == nullptr) || (ours != nullptr
+                    && _less(ours->key(), theirs->key()));
+                bool onlyTheirs = !onlyOurs && (ours == nullptr
+                    || _less(theirs->key(), ours->key()));
+
+                NODE* a = onlyTheirs ? nullptr : ours;
+                NODE* b = onlyOurs ? nullptr : theirs;
+                if (a != nullptr)
+                    ours = _nextInorder(ours);
+                if (b != nullptr)
+                    theirs = _nextInorder(theirs);
+
+                if (a != nullptr && b != nullptr && keepBoth) {
+                    if (steal)
+                        resolve(a->key(), a->value(), std::move(b->value()));
+                    else
+                        resolve(a->key(), a->value(),
+                            static_cast<const valueType&>(b->value()));
+                }
+
+                if (a != nullptr) {
+                    merged.push_back(make_pair(a,
+                        (b != nullptr) ? keepBoth : keepOurs));
+                }
+                if (b != nullptr && steal) {
+                    merged.push_back(make_pair(b, a == nullptr && keepTheirs));
+                } else if (b != nullptr && a == nullptr && keepTheirs) {
+                    created.push_back(nullptr);
+                    created.back() = _createNode(b->key(), b->value());
+                    merged.push_back(make_pair(created.back(), true));
+                }
+            }
+        } catch (...) {
+            _dropCreated(created);
+            while (steal && firstTheirs != nullptr) {
+                NODE* curr = firstTheirs;
+                firstTheirs = _nextInorder(firstTheirs);
+                _dropNode(curr);
+            }
+            throw;
+        }
+        _relinkMerged(merged);
+    }
+
+    // ----------------------
+
+    /* _stealFrom
+     * takes other's pool and tree for _combine, returns
+     * other's first node; false (nothing taken) when
+     * the allocators differ and nodes must be copied
+    */
+    bool _stealFrom(mymap& other, NODE*& theirs) {
+        if (pool.getAllocator() != other.pool.getAllocator())
+            return false;
+
+        pool.adopt(other.pool);
+        theirs = _firstNode(other.root);
+        other.root = nullptr;
+        other.size = 0;
+        return true;
+    }
+
+    // ----------------------
+
+    /* _liveCount / _deadCount
+     * # of live / dead nodes in t's subtree
+    */
+    static int _liveCount(NODE* t) {
+        return (t == nullptr) ? 0 : t->nL + t->nR + !t->isDead;
+    }
+
+    static int _deadCount(NODE* t) {
+        return (t == nullptr) ? 0 : t->nDead;
+    }
+
+    // ----------------------
+
+    /* _joinTrees
+     * links subtree a, node m and subtree b (keys in
+     * that order) into one tree and returns its root.
+     * m takes the place on the heavier tree's inner
+     * spine where the lighter tree balances it, the
+     * spine counts grow and the topmost node pushed
+     * out of balance is rebuilt. the outer end
+     * threads of a and b are left as they were
+     * helper function for split and join
+    */
+    NODE* _joinTrees(NODE* a, NODE* m, NODE* b) {
+        NODE* aLast = _lastNode(a);
+        NODE* bFirst = _firstNode(b);
+        bool aHeavier = _liveCount(a) >= _liveCount(b);
+        NODE* light = aHeavier ? b : a;
+        int addLive = _liveCount(light) + !m->isDead;
+        int addDead = _deadCount(light) + m->isDead;
+
+        // walk down the heavier tree's inner spine until the subtree
+        // there balances the lighter tree, counting m and light in
+        NODE* parent = nullptr;
+        NODE* violater = nullptr;
+        NODE* violaterParent = nullptr;
+        NODE* v = aHeavier ? a : b;
+
+        while (v != nullptr && _liveCount(v) > _liveCount(light)
+            && Balance::isUnbalanced(_liveCount(v), _liveCount(light))) {
+            if (aHeavier)
+                v->nR += addLive;
+            else
+                v->nL += addLive;
+            v->nDead += addDead;
+
+            if (violater == nullptr && checkViolater(v)) {
+                violater = v;
+                violaterParent = parent;
+            }
+            parent = v;
+            if (aHeavier)
+                v = v->isThreaded ? nullptr : v->right;
+            else
+                v = v->isLeftThreaded ? nullptr : v->left;
+        }
+
+        NODE* left = aHeavier ? v : a;
+        NODE* right = aHeavier ? b : v;
+
+        // m sits between the last node of a and the first of b
+        if (aLast != nullptr) {
+            aLast->right = m;
+            aLast->isThreaded = true;
+        }
+        if (bFirst != nullptr) {
+            bFirst->left = m;
+            bFirst->isLeftThreaded = true;
+        }
+
+        m->left = (left != nullptr) ? left : aLast;
+        m->isLeftThreaded = (left == nullptr);
+        m->right = (right != nullptr) ? right : bFirst;
+        m->isThreaded = (right == nullptr);
+        m->nL = _liveCount(left);
+        m->nR = _liveCount(right);
+        m->nDead = _deadCount(left) + _deadCount(right) + m->isDead;
+
+        NODE* subRoot = m;
+        if (parent != nullptr && aHeavier) {
+            parent->right = m;
+            parent->isThreaded = false;
+            subRoot = a;
+        } else if (parent != nullptr) {
+            parent->left = m;
+            parent->isLeftThreaded = false;
+            subRoot = b;
+        }
+
+        if (violater == nullptr && checkViolater(m)) {
+            violater = m;
+            violaterParent = parent;
+        }
+
+        // violaterExists works on the tree at this->root
+        if (violater != nullptr) {
+            NODE* saved = this->root;
+            this->root = subRoot;
+            violaterExists(violater, violaterParent);
+            subRoot = this->root;
+            this->root = saved;
+        }
+        return subRoot;
+    }
+
+    // ----------------------
+
+    /* _splitTree
+     * splits t's subtree into the keys < key (lo) and
+     * the keys >= key (hi): the subtrees hanging off
+     * the search path are joined back together bottom
+     * up, with the path nodes in between
+     * helper function for split
+    */
+    void _splitTree(NODE* t, const keyType& key, NODE*& lo, NODE*& hi) {
+        if (t == nullptr) {
+            lo = nullptr;
+            hi = nullptr;
+            return;
+        }
+
+        NODE* left = t->isLeftThreaded ? nullptr : t->left;
+        NODE* right = t->isThreaded ? nullptr : t->right;
+
+        if (_less(t->key(), key)) {
+            _splitTree(right, key, lo, hi);
+            lo = _joinTrees(left, t, lo);
+        } else {
+            _splitTree(left, key, lo, hi);
+            hi = _joinTrees(hi, t, right);
+        }
+    }
+
+    // ----------------------
+
+    /* _endThreads
+     * threads the first and last node of t's tree
+     * to nullptr, the ends of a whole tree
+    */
+    static void _endThreads(NODE* t) {
+        if (t != nullptr) {
+            _firstNode(t)->left = nullptr;
+            _lastNode(t)->right = nullptr;
+        }
+    }
+
+    // ----------------------
+
+    /* _takeFirst
+     * unlinks mymap's first node, live or dead, and
+     * returns it, rebalancing like erase
+     * helper function for join
+    */
+    NODE* _takeFirst() {
+        NODE* x = _firstNode(this->root);
+        NODE* parent = nullptr;
+        NODE* violater = nullptr;
+        NODE* violaterParent = nullptr;
+
+        for (NODE* curr = this->root; curr != x; curr = curr->left) {
+            if (x->isDead)
+                curr->nDead--;
+            else
+                curr->nL--;
+
+            if (violater == nullptr && checkEraseViolater(curr)) {
+                violater = curr;
+                violaterParent = parent;
+            }
+            parent = curr;
+        }
+
+        // x has no left child, its right subtree takes its place
+        NODE* replacement = x->isThreaded ? nullptr : x->right;
+        if (replacement != nullptr)
+            _firstNode(replacement)->left = nullptr;
+
+        if (parent == nullptr) {
+            this->root = replacement;
+        } else {
+            parent->left = replacement;
+            parent->isLeftThreaded = (replacement == nullptr);
+        }
+
+        if (!x->isDead)
+            this->size--;
+        if (violater != nullptr)
+            violaterExists(violater, violaterParent);
+        return x;
+    }
+
+    // ----------------------
+
+    /* _checkJoinable
+     * throws invalid_argument unless every key of
+     * right is greater than every key of left, and
+     * changes neither map's contents. tombstones are
+     * in the trees too, they are compacted away when
+     * they are what overlaps
+     * helper function for join
+    */
+    static void _checkJoinable(mymap& left, mymap& right) {
+        if (&left == &right || left.root == nullptr || right.root == nullptr
+            || left._less(_lastNode(left.root)->key(),
+                _firstNode(right.root)->key()))
+            return;
+
+        left.compact();
+        right.compact();
+        if (left.root != nullptr && right.root != nullptr
+            && !left._less(_lastNode(left.root)->key(),
+                _firstNode(right.root)->key()))
+            throw invalid_argument("mymap::join: key ranges overlap");
+    }
+
+    // ----------------------
+
+    /* _joinWith
+     * appends right's nodes to mymap, right's keys
+     * must all be greater, see join
+    */
+    void _joinWith(mymap& right) {
+        if (&right == this || right.root == nullptr)
+            return;
+
+        _checkJoinable(*this, right);
+
+        if (pool.getAllocator() != right.pool.getAllocator()) {
+            this->mergeFrom(std::move(right));
+            return;
+        }
+
+        NODE* m = right._takeFirst();
+        pool.adopt(right.pool);
+
+        NODE* b = right.root;
+        this->size += right.size + !m->isDead;
+        right.root = nullptr;
+        right.size = 0;
+
+        this->root = _joinTrees(this->root, m, b);
+    }
+
+    // ----------------------
+
+    // a run of consecutive in-order nodes, the unit of parallel work
+    struct walkTask {
+        NODE* first;  // first node of the run
+        int count;  // # of nodes in the run, dead ones included
+        int index;  // # of nodes before first, dead ones included
+        int liveIndex;  // # of live nodes before first
+    };
+
+    // runs shorter than this are not split any further
+    static const int minGrain = 2048;
+
+    // ----------------------
+
+    /* _treeSize
+     * # of nodes in curr's subtree, dead ones included
+    */
+    static int _treeSize(NODE* curr) {
+        return curr->nL + curr->nR + !curr->isDead + curr->nDead;
+    }
+
+    // ----------------------
+
+    /* _threadCount
+     * # of threads to use for a parallel operation
+     * on n nodes, 0 threads asks for one per core
+    */
+    static int _threadCount(int threads, int n) {
+        if (threads <= 0)
+            threads = int(thread::hardware_concurrency());
+        if (n < 2 * minGrain)
+            threads = 1;
+        return max(threads, 1);
+    }
+
+    // ----------------------
+
+    /* _splitTasks
+     * recursive helper function for the parallel
+     * operations. cuts curr's subtree into runs of
+     * at most grain nodes; the subtree counts give
+     * every run's position without walking it. nodes
+     * above the cut become one node runs
+    */
+    void _splitTasks(NODE* curr, int index, int liveIndex, int grain,
+        vector<walkTask>& tasks) const {
+        int count = _treeSize(curr);
+        if (count <= grain) {
+            tasks.push_back(walkTask{_firstNode(curr), count, index,
+                liveIndex});
+            return;
+        }
+
+        int leftCount = curr->isLeftThreaded ? 0 : _treeSize(curr->left);
+        if (!curr->isLeftThreaded)
+            _splitTasks(curr->left, index, liveIndex, grain, tasks);
+
+        tasks.push_back(walkTask{curr, 1, index + leftCount,
+            liveIndex + curr->nL});
+
+        if (!curr->isThreaded) {
+            _splitTasks(curr->right, index + leftCount + 1,
+                liveIndex + curr->nL + !curr->isDead, grain, tasks);
+        }
+    }
+
+    // ----------------------
+
+    /* _runTasks
+     * calls work(task, i) for every tasks[i] on up to
+     * nThreads threads. each thread claims the next
+     * unclaimed task, so threads that finish early take
+     * on more of the work. the first exception thrown
+     * by work stops the run and is rethrown here
+    */
+    template<typename Work>
+    static void _runTasks(const vector<walkTask>& tasks, int nThreads,
+        Work work) {
+        atomic<size_t> next(0);
+        exception_ptr error;
+        mutex errorLock;
+
+        auto worker = [&]() {
+            try {
+                for (size_t i = next++; i < tasks.size(); i = next++)
+                    work(tasks[i], i);
+            } catch (...) {
+                lock_guard<mutex> lock(errorLock);
+                if (!error)
+                    error = current_exception();
+                next = tasks.size();
+            }
+        };
+
+        vector<thread> workers;
+        for (int t = 1; t < nThreads; t++) {
+            try {
+                workers.push_back(thread(worker));
+            } catch (...) {
+                break;  // carry on with the threads we have
+            }
+        }
+        worker();
+        for (size_t t = 0; t < workers.size(); t++)
+            workers[t].join();
+
+        if (error)
+            rethrow_exception(error);
+    }
+
+    // ----------------------
+
+    /* _walkParallel
+     * cuts mymap into runs and calls visit(node, index,
+     * liveIndex) for every node, dead ones included, on
+     * nThreads threads. a run is walked along the threads
+     * and never reads a node of another run, and the next
+     * node is found before visit, so visit may destroy it
+    */
+    template<typename Visit>
+    void _walkParallel(int nThreads, Visit visit) const {
+        if (this->root == nullptr)
+            return;
+
+        int grain = max(int(minGrain), _treeSize(this->root) / (nThreads * 8));
+        vector<walkTask> tasks;
+        _splitTasks(this->root, 0, 0, grain, tasks);
+
+        _runTasks(tasks, nThreads, [&visit](const walkTask& task, size_t) {
+            NODE* curr = task.first;
+            int liveIndex = task.liveIndex;
+
+            for (int i = 0; i < task.count; i++) {
+                NODE* next = (i + 1 < task.count) ? _nextInorder(curr)
+                    : nullptr;
+                bool isDead = curr->isDead;
+
+                visit(curr, task.index + i, liveIndex);
+                liveIndex += !isDead;
+                curr = next;
+            }
+        });
+    }
+
+    // ----------------------
+
+    /* _copyNodesParallel
+     * helper function for parallelCopy
+     * builds a copy of other's tree in slots, where
+     * slots[i] holds the copy of other's i-th node (in
+     * order, dead ones included). the copy of a node
+     * finds its children and threads by index, so
+     * every node can be copied independently
+    */
+    void _copyNodesParallel(const mymap& other, vector<NODE*>& slots,
+        int nThreads) {
+        int total = int(slots.size());
+        vector<walkTask> tasks;
+        int grain = max(int(minGrain), total / (nThreads * 8));
+        other._splitTasks(other.root, 0, 0, grain, tasks);
+        vector<int> done(tasks.size(), 0);
+
+        try {
+            _runTasks(tasks, nThreads,
+                [this, &slots, &done, total](const walkTask& task, size_t t) {
+                NODE* src = task.first;
+
+                for (int i = task.index; i < task.index + task.count; i++) {
+                    NODE* curr = slots[i];
+                    pool.construct(curr, src->key(), src->value());
+                    done[t]++;
+
+                    curr->nL = src->nL;
+                    curr->nR = src->nR;
+                    curr->nDead = src->nDead;
+                    curr->isDead = src->isDead;
+                    curr->isLeftThreaded = src->isLeftThreaded;
+                    curr->isThreaded = src->isThreaded;
+
+                    // left child ends just before i, right child starts
+                    // just after it
+                    if (src->isLeftThreaded) {
+                        curr->left = (i > 0) ? slots[i - 1] : nullptr;
+                    } else {
+                        NODE* l = src->left;
+                        int skip = l->isThreaded ? 0 : _treeSize(l->right);
+                        curr->left = slots[i - 1 - skip];
+                    }
+
+                    if (src->isThreaded) {
+                        curr->right = (i + 1 < total) ? slots[i + 1] : nullptr;
+                    } else {
+                        NODE* r = src->right;
+                        int skip = r->isLeftThreaded ? 0 : _treeSize(r->left);
+                        curr->right = slots[i + 1 + skip];
+                    }
+
+                    if (i + 1 < task.index + task.count)
+                        src = _nextInorder(src);
+                }
+            });
+        } catch (...) {
+            for (size_t t = 0; t < tasks.size(); t++) {
+                for (int i = 0; i < done[t]; i++)
+                    pool.destroy(slots[tasks[t].index + i]);
+            }
+            throw;
+        }
+    }
+
+    // ----------------------
+
+    /* _parallelSafe
+     * nodes may only be built and destroyed from several
+     * threads when the allocator is the (thread safe)
+     * default one
+    */
+    static bool _parallelSafe() {
+        return is_same<Alloc, allocator<pair<const keyType, valueType>>>
+            ::value;
+    }
+
+    // ----------------------
+ public:
+    /* default constructor :
+     * Creates an empty mymap.
+     * Time complexity: O(1)
+    */
+    mymap() : comp(), lazyErase(false), pool(nodeAllocType()) {
+        this->root = nullptr;
+        this->size = 0;
+    }
+
+    // ----------------------
+
+    /* comparator constructor :
+     * Creates an empty mymap ordered by compare, with node blocks from
+     * alloc.
+     * Time complexity: O(1)
+    */
+    explicit mymap(const Compare& compare, const Alloc& alloc = Alloc())
+        : comp(compare), lazyErase(false), pool(nodeAllocType(alloc)) {
+        this->root = nullptr;
+        this->size = 0;
+    }
+
+    // ----------------------
+
+    /* allocator constructor :
+     * Creates an empty mymap whose node blocks come from alloc
+     * (e.g. a std::pmr::polymorphic_allocator over a memory resource).
+     * Time complexity: O(1)
+    */
+    explicit mymap(const Alloc& alloc)
+        : comp(), lazyErase(false), pool(nodeAllocType(alloc)) {
+        this->root = nullptr;
+        this->size = 0;
+    }
+
+    // ----------------------
+
+    /* copy constructor:
+     * Constructs a new mymap which is a copy of the "other" mymap.
+     * Sets all member variables appropriately. The shape of the tree,
+     * subtree counts and threads are cloned directly, no rebalancing.
+     * Time complexity: O(n), where n is total number of nodes in threaded,
+     * self-balancing BST.
+    */
+    mymap(const mymap& other)
+        : comp(other.comp), lazyErase(other.lazyErase),
+          pool(nodeTraits::select_on_container_copy_construction(
+            other.pool.getAllocator())) {
+        this->root = nullptr;
+        this->size = 0;
+
+        // copy nodes
+        pool.reserve(size_t(other.size));
+        this->root = _copyNodes(other.root, nullptr, nullptr);
+        this->size = other.size;
+    }
+
+    // ----------------------
+
+    /* operator=:
+     * Clears "this" mymap and then makes a copy of the "other" mymap.
+     * Sets all member variables appropriately.
+     * Time complexity: O(n), where n is total number of nodes in threaded,
+     * self-balancing BST.
+    */
+    mymap& operator=(const mymap& other) {
+        // not a self assignment
+        if (this == &other)
+            return *this;
+
+        // deallocate prev memory
+        this->clear();
+        this->comp = other.comp;
+        this->lazyErase = other.lazyErase;
+
+        // copy nodes
+        pool.reserve(size_t(other.size));
+        this->root = _copyNodes(other.root, nullptr, nullptr);
+        this->size = other.size;
+
+        return *this;
+    }
+
+    // ----------------------
+
+    /* parallelCopy:
+     * Replaces the contents of mymap with a copy of the "other" mymap,
+     * like operator=, built by several threads (0 = one per core). The
+     * storage for every node is taken first; then each thread copies a
+     * run of consecutive nodes and links them by in-order position, so
+     * the threads never wait on each other. Uses one thread when the
+     * allocator is not the default one. If a copy throws, mymap is left
+     * unchanged.
+     * Time complexity: O(n / threads + threads), where n is total number
+     * of nodes in threaded, self-balancing BST.
+    */
+    void parallelCopy(const mymap& other, int threads = 0) {
+        if (this == &other)
+            return;
+
+        mymap copy(other.comp, this->get_allocator());
+        copy.lazyErase = other.lazyErase;
+
+        if (other.root != nullptr) {
+            int total = _treeSize(other.root);
+            int nThreads = _parallelSafe() ? _threadCount(threads, total) : 1;
+
+            vector<NODE*> slots(size_t(total), nullptr);
+            copy.pool.reserve(size_t(total));
+            for (int i = 0; i < total; i++) {
+                copy.nodeAllocated();
+                slots[i] = copy.pool.allocate();
+            }
+
+            copy._copyNodesParallel(other, slots, nThreads);
+            NODE* r = other.root;
+            copy.root = slots[r->isLeftThreaded ? 0 : _treeSize(r->left)];
+            copy.size = other.size;
+        }
+        this->swap(copy);
+    }
+
+    // ----------------------
+
+    /* move constructor:
+     * Takes over the nodes of the "other" mymap, leaving it empty.
+     * Time complexity: O(1)
+    */
+    mymap(mymap&& other) noexcept
+        : comp(other.comp), lazyErase(other.lazyErase),
+          pool(std::move(other.pool)) {
+        this->root = other.root;
+        this->size = other.size;
+        other.root = nullptr;
+        other.size = 0;
+    }
+
+    // ----------------------
+
+    /* move operator=:
+     * Clears "this" mymap and takes over the nodes of the "other" mymap.
+     * If the two allocators differ the nodes are copied instead.
+     * Time complexity: O(1), or O(n) when the allocators differ.
+    */
+    mymap& operator=(mymap&& other) {
+        if (this == &other)
+            return *this;
+
+        if (!(pool.getAllocator() == other.pool.getAllocator()))
+            return *this = static_cast<const mymap&>(other);
+
+        this->clear();
+        this->swap(other);
+        return *this;
+    }
+
+    // ----------------------
+
+    /* swap:
+     * Exchanges the contents of two mymaps.
+     * Time complexity: O(1)
+    */
+    void swap(mymap& other) noexcept {
+        pool.swap(other.pool);
+        std::swap(this->comp, other.comp);
+        std::swap(this->lazyErase, other.lazyErase);
+        std::swap(this->root, other.root);
+        std::swap(this->size, other.size);
+    }
+
+    // ----------------------
+
+    /* assignSorted:
+     * Replaces the contents of mymap with the key/value pairs in
+     * [first, last), which must already be sorted by strictly increasing
+     * key. Builds a perfectly balanced threaded BST directly, no
+     * rebalancing is done. Elements need .first/.second (e.g. the
+     * pairs returned by toVector()).
+     * Time complexity: O(n), where n is the number of pairs in the range.
+    */
+    template<typename Iter>
+    void assignSorted(Iter first, Iter last) {
+        this->clear();
+
+        int n = int(distance(first, last));
+        NODE* lastNode = nullptr;
+
+        pool.reserve(size_t(n));
+        this->root = _buildSorted(first, n, lastNode);
+        this->size = n;
+    }
+
+    // ----------------------
+
+    /* clear:
+     * Frees the memory associated with the mymap; can be used for testing.
+     * Node blocks are handed back to the allocator all at once; the tree is
+     * only walked when keys or values need their destructors run.
+     * Time complexity: O(n), where n is total number of nodes in threaded,
+     * self-balancing BST, or O(number of blocks) for trivially
+     * destructible keys and values.
+    */
+    void clear() {
+        if (!is_trivially_destructible<NODE>::value)
+            _clearNode(this->root);
+
+        pool.release();
+        this->root = nullptr;
+        this->size = 0;
+    }
+
+    // ----------------------
+
+    /* destructor:
+     * Frees the memory associated with the mymap.
+     * Time complexity: O(n), where n is total number of nodes in threaded,
+     * self-balancing BST.
+    */
+    ~mymap() { this->clear(); }
+
+    // ----------------------
+
+    /* parallelClear:
+     * clear() with the node destructors run by several threads (0 = one
+     * per core), each on its own run of nodes. Uses one thread when the
+     * allocator is not the default one.
+     * Time complexity: O(n / threads + threads), where n is total number
+     * of nodes in threaded, self-balancing BST
+    */
+    void parallelClear(int threads = 0) {
+        if (!is_trivially_destructible<NODE>::value && this->root != nullptr) {
+            int total = _treeSize(this->root);
+            int nThreads = _parallelSafe() ? _threadCount(threads, total) : 1;
+
+            _walkParallel(nThreads, [this](NODE* curr, int, int) {
+                pool.destroy(curr);
+            });
+        }
+
+        pool.release();
+        this->root = nullptr;
+        this->size = 0;
+    }
+
+    // ----------------------
+
+    /* put:
+     * Inserts the key/value into the threaded, self-balancing BST based on
+     * the key.
+     * Time complexity: O(logn + m), where n is total number of nodes in the
+     * threaded, self-balancing BST and m is the number of nodes in the
+     * sub-tree that needs to be re-balanced.
+     * Space complexity: O(1)
+    */
+    void put(const keyType& key, const valueType& value) {
+        _put(key, value);
+    }
+
+    // ----------------------
+
+    /* put (move):
+     * Same as put, but moves key and value into mymap instead of copying.
+     * Time complexity: same as put.
+    */
+    void put(keyType&& key, valueType&& value) {
+        _put(std::move(key), std::move(value));
+    }
+
+    // ----------------------
+
+    /* putBatch:
+     * Puts every key/value pair in [first, last) into mymap, as if put()
+     * was called on each in order (later duplicates win). Pass sorted =
+     * true when the range is already in increasing key order to skip the
+     * sort. Small batches are put one at a time; larger ones are merged
+     * with the existing in-order nodes and the tree is rebuilt once.
+     * Elements need .first/.second. If a copy throws, mymap keeps its
+     * keys, some values may already be set.
+     * Time complexity: O(min(b logn, n + b logb)), where n is total number
+     * of nodes in the threaded, self-balancing BST and b is the batch size.
+    */
+    template<typename Iter>
+    void putBatch(Iter first, Iter last, bool sorted = false) {
+        _putBatch(first, last, sorted, true);
+    }
+
+    // ----------------------
+
+    /* insert:
+     * Like putBatch, but keys already in mymap keep their value and the
+     * first of several equal keys in the batch wins (std::map::insert).
+     * Time complexity: same as putBatch.
+    */
+    template<typename Iter>
+    void insert(Iter first, Iter last, bool sorted = false) {
+        _putBatch(first, last, sorted, false);
+    }
+
+    // ----------------------
+
+    /* try_emplace:
+     * Inserts key with a value constructed in place from args, only if
+     * key is not in mymap yet; an existing value is left untouched.
+     * Returns an iterator to the key's node and whether it was inserted.
+     * Time complexity: same as put.
+    */
+    template<typename... Args>
+    pair<iterator, bool> try_emplace(const keyType& key, Args&&... args) {
+        pair<NODE*, bool> result =
+            _tryEmplace(key, std::forward<Args>(args)...);
+        return make_pair(iterator(result.first, this), result.second);
+    }
+
+    template<typename... Args>
+    pair<iterator, bool> try_emplace(keyType&& key, Args&&... args) {
+        pair<NODE*, bool> result =
+            _tryEmplace(std::move(key), std::forward<Args>(args)...);
+        return make_pair(iterator(result.first, this), result.second);
+    }
+
+    // ----------------------
+
+    /* emplace:
+     * Builds a key/value pair in place from (key, value constructor
+     * arguments...) and inserts it if the key is not in mymap yet.
+     * Returns an iterator to the key's node and whether it was inserted.
+     * Time complexity: same as put.
+    */
+    template<typename... Args>
+    pair<iterator, bool> emplace(Args&&... args) {
+        NODE* n = _createNode(std::forward<Args>(args)...);
+        NODE* prev = nullptr;
+        NODE* curr = this->root;
+
+        searchForKeyandMovePtrs(prev, curr, n->key());
+        if (curr != nullptr) {  // key taken, drop the new node
+            bool isDead = curr->isDead;
+            if (isDead)
+                curr->value() = std::move(n->value());
+
+            pool.destroy(n);
+            pool.deallocate(n);
+            if (isDead)
+                _reviveNode(curr);
+            return make_pair(iterator(curr, this), isDead);
+        }
+
+        _linkNode(prev, n);
+        return make_pair(iterator(n, this), true);
+    }
+
+    // ----------------------
+
+    /* erase:
+     * Removes key from mymap, returns the # of keys removed (0 or 1).
+     * The node is unlinked and freed, and the topmost node the removal
+     * puts out of balance (see Balance) is rebuilt; with setLazyErase(true) it
+     * is left in the tree as a tombstone instead (see setLazyErase).
+     * Iterators to other keys stay valid.
+     * Time complexity: O(logn) amortized, where n is total number of
+     * nodes in the threaded, self-balancing BST
+    */
+    int erase(const keyType& key) {
+        NODE* curr = _findNode(key);
+        if (curr == nullptr)
+            return 0;
+
+        if (this->lazyErase)
+            _markDead(curr);
+        else
+            _removeNode(curr);
+        return 1;
+    }
+
+    // ----------------------
+
+    /* erase:
+     * Removes the key/value pair at pos, which must be a valid
+     * dereferenceable iterator, and returns an iterator to the next one.
+     * Time complexity: O(logn) amortized, see erase(key)
+    */
+    iterator erase(const_iterator pos) {
+        NODE* curr = pos.curr;
+        NODE* next = _nextLive(curr);
+
+        if (this->lazyErase)
+            _markDead(curr);
+        else
+            _removeNode(curr);
+        return iterator(next, this);
+    }
+
+    // ----------------------
+
+    /* setLazyErase:
+     * With lazy erase on, erase only marks the key's node dead (its
+     * value is reset to valueType()) and updates the counts on its path;
+     * nothing is relinked or rebalanced. A subtree is compacted - its
+     * dead nodes freed and the rest rebuilt balanced - once more than
+     * half of its nodes are dead, and every rebuild drops the dead nodes
+     * it meets. Putting an erased key back reuses its node. Suits
+     * delete-heavy churn; off by default.
+     * O(1)
+    */
+    void setLazyErase(bool lazy) { this->lazyErase = lazy; }
+
+    // ----------------------
+
+    /* compact:
+     * Frees every dead node left by lazy erase and rebuilds mymap
+     * balanced; does nothing if there are none.
+     * Time complexity: O(n), where n is total number of nodes in the
+     * threaded, self-balancing BST
+    */
+    void compact() {
+        if (this->root != nullptr && this->root->nDead > 0)
+            violaterExists(this->root, nullptr);
+    }
+
+    // ----------------------
+
+    /* mergeFrom:
+     * Adds every key of other to mymap (union). For a key in both maps
+     * policy picks the value kept, or resolve(key, ours, theirs) sets
+     * ours. Both maps are walked in order together and the result is
+     * relinked balanced once, instead of one put per key. Nodes already
+     * in mymap are reused; other is left unchanged. When other is small
+     * enough that m puts cost less, its keys are put one by one. If a
+     * copy or resolve throws, mymap keeps its keys (some values may be
+     * resolved already) and the relinking has not begun.
+     * Time complexity: O(min(n + m, m logn)), where n and m are the
+     * sizes of the maps
+    */
+    void mergeFrom(const mymap& other, mymap_conflict policy = KEEP_OURS) {
+        mergeFrom(other, _conflictResolver{policy});
+    }
+
+    template<typename Resolve>
+    void mergeFrom(const mymap& other, Resolve resolve) {
+        if (&other == this)
+            return;
+
+        // a few keys: puts are cheaper than touching all n + m nodes,
+        // the same trade-off as putBatch
+        double m = other.size;
+        if (m * log2(this->size + m + 1) < this->size + m) {
+            for (NODE* curr = _skipDead(_firstNode(other.root));
+                curr != nullptr; curr = _nextLive(curr)) {
+                pair<NODE*, bool> r = _tryEmplace(curr->key(), curr->value());
+                if (!r.second)
+                    resolve(curr->key(), r.first->value(),
+                        static_cast<const valueType&>(curr->value()));
+            }
+            return;
+        }
+
+        pool.reserve(size_t(other.size));
+        _combine(_firstNode(other.root), false,
+            true, true, true, resolve);
+    }
+
+    // ----------------------
+
+    /* mergeFrom (move):
+     * As above, but other's nodes are moved into mymap instead of
+     * copied: no node is allocated and other is left empty, also when
+     * resolve throws. Falls back to copying when the allocators differ.
+     * Time complexity: O(n + m), where n and m are the sizes of the maps
+    */
+    void mergeFrom(mymap&& other, mymap_conflict policy = KEEP_OURS) {
+        mergeFrom(std::move(other), _conflictResolver{policy});
+    }
+
+    template<typename Resolve>
+    void mergeFrom(mymap&& other, Resolve resolve) {
+        if (&other == this)
+            return;
+
+        NODE* theirs = nullptr;
+        if (_stealFrom(other, theirs)) {
+            _combine(theirs, true, true, true, true, resolve);
+        } else {
+            mergeFrom(static_cast<const mymap&>(other), resolve);
+            other.clear();
+        }
+    }
+
+    // ----------------------
+
+    /* intersectWith:
+     * Keeps only the keys that are also in other; policy picks the value
+     * kept. Dropped nodes are freed and the rest relinked balanced once.
+     * If a copy throws, mymap is left with the keys it had.
+     * Time complexity: O(n + m), where n and m are the sizes of the maps
+    */
+    void intersectWith(const mymap& other,
+        mymap_conflict policy = KEEP_OURS) {
+        if (&other == this)
+            return;
+
+        _combine(_firstNode(other.root), false,
+            false, false, true, _conflictResolver{policy});
+    }
+
+    // ----------------------
+
+    /* differenceWith:
+     * Removes every key that is in other. Dropped nodes are freed and the
+     * rest relinked balanced once.
+     * Time complexity: O(n + m), where n and m are the sizes of the maps
+    */
+    void differenceWith(const mymap& other) {
+        if (&other == this) {
+            this->clear();
+            return;
+        }
+
+        _combine(_firstNode(other.root), false,
+            true, false, false, _conflictResolver{KEEP_OURS});
+    }
+
+    // ----------------------
+
+    /* split:
+     * Moves the keys >= key into the returned mymap and keeps the keys
+     * < key. No node is copied: the tree is cut along the search path
+     * and the subtrees hanging off it are joined back, relinking nodes
+     * and fixing counts and threads, so both halves stay balanced. The
+     * halves share node storage, handed back once both are cleared.
+     * Time complexity: O((logn)^2 + m), where m is the size of the
+     * subtrees that need to be re-balanced
+    */
+    mymap split(const keyType& key) {
+        mymap upper(this->comp, this->get_allocator());
+        upper.lazyErase = this->lazyErase;
+
+        NODE* lo = nullptr;
+        NODE* hi = nullptr;
+        _splitTree(this->root, key, lo, hi);
+        _endThreads(lo);
+        _endThreads(hi);
+
+        this->root = lo;
+        this->size = _liveCount(lo);
+        upper.root = hi;
+        upper.size = _liveCount(hi);
+
+        if (lo == nullptr)
+            upper.pool.adopt(pool);
+        else if (hi != nullptr)
+            pool.share(upper.pool);
+        return upper;
+    }
+
+    // ----------------------
+
+    /* join:
+     * Returns one mymap holding the keys of left and right; every key
+     * of right must be greater than every key of left, else it throws
+     * invalid_argument. The smaller tree is linked in on the larger
+     * one's inner spine and the counts and threads along it fixed, no
+     * node is copied (unless the allocators differ). left and right
+     * are left empty; if join throws, both still hold their keys.
+     * Time complexity: O(logn + m), where m is the size of the subtree
+     * that needs to be re-balanced
+    */
+    static mymap join(mymap&& left, mymap&& right) {
+        _checkJoinable(left, right);
+
+        mymap joined(std::move(left));
+        joined._joinWith(right);
+        return joined;
+    }
+
+    // ----------------------
+
+    /*contains:
+     * Returns true if the key is in mymap, return false if not.
+     * Time complexity: O(logn), where n is total number of nodes in the
+     * threaded, self-balancing BST
+    */
+    bool contains(const keyType& key) const {
+        return _findNode(key) != nullptr;
+    }
+
+    // heterogeneous lookup, e.g. a string_view probe of a mymap<string,
+    // V, less<>>; only offered when Compare is transparent
+    template<typename K, typename C = Compare,
+        typename = typename C::is_transparent>
+    bool contains(const K& key) const {
+        return _findNode(key) != nullptr;
+    }
+
+    // ----------------------
+
+    /* get:
+     * Returns the value for the given key; if the key is not found, the
+     * default value, valueType(), is returned (but not added to mymap).
+     * The value is returned by reference, no copy is made.
+     * Time complexity: O(logn), where n is total number of nodes in the
+     * threaded, self-balancing BST
+    */
+    const valueType& get(const keyType& key) const {
+        static const valueType defaultValue = valueType();
+
+        NODE* curr = _findNode(key);
+        return (curr != nullptr) ? curr->value() : defaultValue;
+    }
+
+    template<typename K, typename C = Compare,
+        typename = typename C::is_transparent>
+    const valueType& get(const K& key) const {
+        static const valueType defaultValue = valueType();
+
+        NODE* curr = _findNode(key);
+        return (curr != nullptr) ? curr->value() : defaultValue;
+    }
+
+    // ----------------------
+
+    /* getPtr:
+     * Returns a pointer to the value for the given key, nullptr if the
+     * key is not found. The value can be modified in place.
+     * Time complexity: O(logn), where n is total number of nodes in the
+     * threaded, self-balancing BST
+    */
+    valueType* getPtr(const keyType& key) {
+        NODE* curr = _findNode(key);
+        return (curr != nullptr) ? &curr->value() : nullptr;
+    }
+
+    const valueType* getPtr(const keyType& key) const {
+        NODE* curr = _findNode(key);
+        return (curr != nullptr) ? &curr->value() : nullptr;
+    }
+
+    template<typename K, typename C = Compare,
+        typename = typename C::is_transparent>
+    valueType* getPtr(const K& key) {
+        NODE* curr = _findNode(key);
+        return (curr != nullptr) ? &curr->value() : nullptr;
+    }
+
+    // ----------------------
+
+    /* getMany:
+     * Writes the value of each key in [first, last), or in keys, to out
+     * in order and returns out past the last one; a key not found gives
+     * valueType(), as get does. The lookups go down the tree 32 at a
+     * time, one level per round, prefetching each next node so their
+     * cache misses overlap instead of stalling one after another; worth
+     * it once the tree no longer fits in cache. Iter is a forward
+     * iterator.
+     * Time complexity: O(k logn) for k keys, where n is total number of
+     * nodes in the threaded, self-balancing BST
+    */
+    template<typename Iter, typename Out>
+    Out getMany(Iter first, Iter last, Out out) const {
+        static const valueType defaultValue = valueType();
+
+        _findMany(first, last, [&out](NODE* curr) {
+            *out = (curr != nullptr) ? curr->value() : defaultValue;
+            ++out;
+        });
+        return out;
+    }
+
+    template<typename Keys, typename Out>
+    Out getMany(const Keys& keys, Out out) const {
+        return getMany(std::begin(keys), std::end(keys), out);
+    }
+
+    // ----------------------
+
+    /* containsMany:
+     * Writes contains(key) for each key in [first, last), or in keys, to
+     * out in order and returns out past the last one. Lookups are
+     * interleaved as in getMany.
+     * Time complexity: O(k logn) for k keys
+    */
+    template<typename Iter, typename Out>
+    Out containsMany(Iter first, Iter last, Out out) const {
+        _findMany(first, last, [&out](NODE* curr) {
+            *out = (curr != nullptr);
+            ++out;
+        });
+        return out;
+    }
+
+    template<typename Keys, typename Out>
+    Out containsMany(const Keys& keys, Out out) const {
+        return containsMany(std::begin(keys), std::end(keys), out);
+    }
+
+    // ----------------------
+
+    /* operator[]:
+     * Returns the value for the given key; if the key is not found,
+     * the default value, valueType(), is returned (and the resulting new
+     * key/value pair is inserted into the map). The value is returned by
+     * reference so it can be assigned to in place.
+     * Time complexity: O(logn + m), where n is total number of nodes in the
+     * threaded, self-balancing BST and m is the number of nodes in the
+     * sub-trees that need to be re-balanced.
+     * Space complexity: O(1)
+    */
+    valueType& operator[](const keyType& key) {
+        return _tryEmplace(key).first->value();
+    }
+
+    valueType& operator[](keyType&& key) {
+        return _tryEmplace(std::move(key)).first->value();
+    }
+
+    // ----------------------
+
+    /* Size:
+     * Returns the # of key/value pairs in the mymap, 0 if empty.
+     * O(1)
+    */
+    int Size() const { return this->size; }
+
+    // ----------------------
+
+    /* select:
+     * Returns the key/value pair with k smaller keys in mymap (k = 0 is
+     * the smallest key). Throws out_of_range if k is not in [0, Size()).
+     * Time complexity: O(logn), where n is total number of nodes in the
+     * threaded, self-balancing BST
+    */
+    pair<keyType, valueType> select(int k) const {
+        NODE* curr = _selectNode(k);
+        if (curr == nullptr)
+            throw out_of_range("mymap::select: k out of range");
+
+        return make_pair(curr->key(), curr->value());
+    }
+
+    // ----------------------
+
+    /* rank:
+     * Returns the # of keys in mymap that are less than key; key itself
+     * does not need to be in mymap.
+     * Time complexity: O(logn), where n is total number of nodes in the
+     * threaded, self-balancing BST
+    */
+    int rank(const keyType& key) const { return _countLess(key, false); }
+
+    // ----------------------
+
+    /* countRange:
+     * Returns the # of keys k in mymap with lo <= k <= hi, 0 if hi < lo.
+     * Time complexity: O(logn), where n is total number of nodes in the
+     * threaded, self-balancing BST
+    */
+    int countRange(const keyType& lo, const keyType& hi) const {
+        if (_less(hi, lo))
+            return 0;
+
+        return _countLess(hi, true) - _countLess(lo, false);
+    }
+
+    // ----------------------
+
+    /* percentile:
+     * Returns the key/value pair at percentile p (0.0 - 1.0, clamped) using
+     * the nearest-rank method, so 0.5 is the median and 1.0 the largest
+     * key. Throws out_of_range if mymap is empty.
+     * Time complexity: O(logn), where n is total number of nodes in the
+     * threaded, self-balancing BST
+    */
+    pair<keyType, valueType> percentile(double p) const {
+        if (this->size == 0)
+            throw out_of_range("mymap::percentile: mymap is empty");
+
+        p = min(max(p, 0.0), 1.0);
+        int k = int(ceil(p * this->size)) - 1;
+        return select(max(k, 0));
+    }
+
+    // ----------------------
+
+    /* begin:
+     * returns an iterator to the first in order NODE.
+     * Time complexity: O(logn), where n is total number of nodes in the
+     * threaded, self-balancing BST
+    */
+    iterator begin() {
+        return iterator(_skipDead(_firstNode(this->root)), this);
+    }
+
+    const_iterator begin() const {
+        return const_iterator(_skipDead(_firstNode(this->root)), this);
+    }
+
+    const_iterator cbegin() const { return begin(); }
+
+    // ----------------------
+
+    /* end:
+     * returns an iterator to the last in order NODE.
+     * this function is given to you.
+     * Time Complexity: O(1)
+    */
+    iterator end() { return iterator(nullptr, this); }
+
+    const_iterator end() const { return const_iterator(nullptr, this); }
+
+    const_iterator cend() const { return end(); }
+
+    // ----------------------
+
+    /* rbegin / rend:
+     * reverse iterators, from the last in order NODE back to the first.
+     * Stepping back follows the left threads.
+     * Time complexity: O(1) amortized per step
+    */
+    reverse_iterator rbegin() { return reverse_iterator(end()); }
+
+    reverse_iterator rend() { return reverse_iterator(begin()); }
+
+    const_reverse_iterator rbegin() const {
+        return const_reverse_iterator(end());
+    }
+
+    const_reverse_iterator rend() const {
+        return const_reverse_iterator(begin());
+    }
+
+    // ----------------------
+
+    /* find:
+     * returns an iterator to the NODE holding key, end() if not found.
+     * Time complexity: O(logn), where n is total number of nodes in the
+     * threaded, self-balancing BST
+    */
+    iterator find(const keyType& key) {
+        return iterator(_findNode(key), this);
+    }
+
+    template<typename K, typename C = Compare,
+        typename = typename C::is_transparent>
+    iterator find(const K& key) {
+        return iterator(_findNode(key), this);
+    }
+
+    // ----------------------
+
+    /* lower_bound:
+     * returns an iterator to the first NODE whose key is not less than
+     * key, end() if there is none.
+     * Time complexity: O(logn), where n is total number of nodes in the
+     * threaded, self-balancing BST
+    */
+    iterator lower_bound(const keyType& key) {
+        return iterator(_lowerBoundNode(key), this);
+    }
+
+    template<typename K, typename C = Compare,
+        typename = typename C::is_transparent>
+    iterator lower_bound(const K& key) {
+        return iterator(_lowerBoundNode(key), this);
+    }
+
+    // ----------------------
+
+    /* upper_bound:
+     * returns an iterator to the first NODE whose key is greater than
+     * key, end() if there is none.
+     * Time complexity: O(logn), where n is total number of nodes in the
+     * threaded, self-balancing BST
+    */
+    iterator upper_bound(const keyType& key) {
+        return iterator(_upperBoundNode(key), this);
+    }
+
+    template<typename K, typename C = Compare,
+        typename = typename C::is_transparent>
+    iterator upper_bound(const K& key) {
+        return iterator(_upperBoundNode(key), this);
+    }
+
+    // ----------------------
+
+    /* equal_range:
+     * returns {lower_bound(key), upper_bound(key)}; the range holds the
+     * key's NODE if it is in mymap and is empty otherwise.
+     * Time complexity: O(logn), where n is total number of nodes in the
+     * threaded, self-balancing BST
+    */
+    pair<iterator, iterator> equal_range(const keyType& key) {
+        return make_pair(lower_bound(key), upper_bound(key));
+    }
+
+    // ----------------------
+
+    /* scan:
+     * Calls fn(key, value) for every key in [lo, hi], in order. The walk
+     * follows the threads from lower_bound(lo), with no recursion and no
+     * allocation. fn may modify the value but must not modify mymap.
+     * Time complexity: O(logn + k), where n is total number of nodes in
+     * the threaded, self-balancing BST and k is the # of keys in range.
+    */
+    template<typename Func>
+    void scan(const keyType& lo, const keyType& hi, Func fn) {
+        if (_less(hi, lo))
+            return;
+
+        NODE* curr = _lowerBoundNode(lo);
+        while (curr != nullptr && !_less(hi, curr->key())) {
+            fn(curr->key(), curr->value());
+            curr = _nextLive(curr);
+        }
+    }
+
+    // ----------------------
+
+    /* forEach:
+     * Calls fn(key, value) for every key in mymap, in order, following
+     * the threads. fn may modify the value but must not modify mymap.
+     * Time complexity: O(n), where n is total number of nodes in the
+     * threaded, self-balancing BST
+    */
+    template<typename Func>
+    void forEach(Func fn) {
+        NODE* curr = _skipDead(_firstNode(this->root));
+
+        while (curr != nullptr) {
+            fn(curr->key(), curr->value());
+            curr = _nextLive(curr);
+        }
+    }
+
+    // ----------------------
+
+    /* parallelForEach:
+     * Calls fn(key, value) for every key in mymap from several threads
+     * (0 = one per core). Each thread walks its own run of consecutive
+     * keys along the threads; runs are cut from the subtree counts and
+     * handed to whichever thread is free. Calls happen concurrently and
+     * in no particular order, so fn must be safe to run in parallel; it
+     * may modify the value but must not modify mymap.
+     * Time complexity: O(n / threads + threads), where n is total number
+     * of nodes in the threaded, self-balancing BST
+    */
+    template<typename Func>
+    void parallelForEach(Func fn, int threads = 0) {
+        int nThreads = _threadCount(threads, this->size);
+
+        _walkParallel(nThreads, [&fn](NODE* curr, int, int) {
+            if (!curr->isDead)
+                fn(curr->key(), curr->value());
+        });
+    }
+
+    // ----------------------
+
+    /* toString:
+     * Returns a string of the entire mymap, in order.
+     * Format for 8/80, 15/150, 20/200:
+     * "key: 8 value: 80\nkey: 15 value: 150\nkey: 20 value: 200\n
+     * Time complexity: O(n), where n is total number of nodes in the
+     * threaded, self-balancing BST
+    */
+    string toString() const {
+        NODE* curr = this->root;
+        stringstream ss;
+        _BSTPrintInorder(curr, ss);
+
+        return ss.str();
+    }
+
+    // ----------------------
+
+    /* toVector:
+     * Returns a vector of the entire map, in order.  For 8/80, 15/150, 20/200:
+     * {{8, 80}, {15, 150}, {20, 200}}
+     * Time complexity: O(n), where n is total number of nodes in the
+     * threaded, self-balancing BST
+    */
+    vector<pair<keyType, valueType>> toVector() const {
+        vector<pair<keyType, valueType>> mapVector;
+        NODE* curr = this->root;
+
+        _toVectorPrint(curr, mapVector);
+
+        return mapVector;
+    }
+
+    // ----------------------
+
+    /* parallelToVector:
+     * toVector() filled by several threads (0 = one per core). The
+     * vector is sized up front and every key's slot is its rank, known
+     * from the subtree counts, so each thread writes its own run of
+     * slots with no locking.
+     * Time complexity: O(n / threads + threads), where n is total number
+     * of nodes in the threaded, self-balancing BST
+    */
+    vector<pair<keyType, valueType>> parallelToVector(int threads = 0) const {
+        vector<pair<keyType, valueType>> mapVector(size_t(this->size));
+        int nThreads = _threadCount(threads, this->size);
+
+        _walkParallel(nThreads,
+            [&mapVector](NODE* curr, int, int liveIndex) {
+            if (!curr->isDead) {
+                mapVector[liveIndex].first = curr->key();
+                mapVector[liveIndex].second = curr->value();
+            }
+        });
+        return mapVector;
+    }
+
+    // ----------------------
+
+    /* freeze:
+     * Returns an immutable frozen_mymap holding a copy of mymap, laid out
+     * as an implicit B-tree for read-mostly phases. Later changes to
+     * mymap are not seen by the frozen copy.
+     * Time complexity: O(n), where n is total number of nodes in the
+     * threaded, self-balancing BST
+    */
+    frozen_mymap<keyType, valueType, Compare> freeze() {
+        return frozen_mymap<keyType, valueType, Compare>(this->toVector(),
+            this->comp);
+    }
+
+    // ----------------------
+
+    /* save:
+     * Writes mymap to path as a versioned, checksummed binary snapshot
+     * (see mymap_snapshot.h), records in key order. Keys and values
+     * need a mymap_serializer: trivially copyable types and strings have
+     * one. The file is replaced atomically. Throws runtime_error if it
+     * cannot be written.
+     * Time complexity: O(n), where n is total number of nodes in the
+     * threaded, self-balancing BST
+    */
+    void save(const string& path) const {
+        mymap_snapshot_writer out(path, uint64_t(this->size),
+            mymap_serializer<keyType>::fixedSize,
+            mymap_serializer<valueType>::fixedSize);
+
+        NODE* curr = _skipDead(_firstNode(this->root));
+        while (curr != nullptr) {
+            mymap_serializer<keyType>::write(out, curr->key());
+            mymap_serializer<valueType>::write(out, curr->value());
+            curr = _nextLive(curr);
+        }
+        out.finish();
+    }
+
+    // ----------------------
+
+    /* load:
+     * Replaces the contents of mymap with the snapshot at path, written
+     * by save() of a mymap with the same types and Compare. The file is
+     * memory-mapped and its records are decoded straight into a
+     * perfectly balanced tree, with no searching or rebalancing. Throws
+     * runtime_error if the file is missing, truncated, of other types,
+     * fails its checksum or holds other than count records; mymap is
+     * then left unchanged.
+     * Time complexity: O(n), where n is the number of records
+    */
+    void load(const string& path) {
+        mymap_mapped_file file(path, true);
+        mymap_snapshot_header header =
+            mymap_snapshot_check<keyType, valueType>(file, true);
+
+        mymap loaded(this->comp, this->get_allocator());
+        loaded.lazyErase = this->lazyErase;
+
+        int n = int(header.count);
+        mymap_snapshot_reader<keyType, valueType> it(file, header.count);
+        NODE* lastNode = nullptr;
+
+        loaded.pool.reserve(size_t(n));
+        loaded.root = loaded._buildSorted(it, n, lastNode);
+        loaded.size = n;
+        this->swap(loaded);
+    }
+
+    // ----------------------
+
+    /* checkBalance:
+     * Returns a string of mymap that verifies that the tree is properly
+     * balanced.  For example, if keys: 1, 2, 3 are inserted in that order,
+     * function should return a string in this format (in pre-order):
+     * "key: 2, nL: 1, nR: 1\nkey: 1, nL: 0, nR: 0\nkey: 3, nL: 0, nR: 0\n";
+     * Time complexity: O(n), where n is total number of nodes in the
      * threaded, self-balancing BST
     */
-    string checkBalance() {
+    string checkBalance() const {
         NODE* curr = this->root;
         stringstream ss;
 
         _BSTPrintBalance(curr, ss);
         return ss.str();
     }
+
+    // ----------------------
+
+    /* stats:
+     * Returns the statistics gathered by the Stats policy (see
+     * mymap_stats); empty for the default mymap_no_stats.
+     * O(1)
+    */
+    const Stats& stats() const { return *this; }
+
+    // ----------------------
+
+    /* resetStats:
+     * Sets every statistic back to zero.
+     * O(1)
+    */
+    void resetStats() { static_cast<Stats&>(*this) = Stats(); }
+
+    // ----------------------
+
+    /* get_allocator:
+     * Returns a copy of the allocator the node blocks come from.
+     * O(1)
+    */
+    Alloc get_allocator() const { return Alloc(pool.getAllocator()); }
+
+    // ----------------------
+
+    /* key_comp:
+     * Returns a copy of the comparator that orders the keys.
+     * O(1)
+    */
+    Compare key_comp() const { return this->comp; }
+
+    // ----------------------
+
+    /* reserve:
+     * Sets aside one contiguous block for the next n inserted nodes.
+     * O(1)
+    */
+    void reserve(int n) {
+        if (n > 0)
+            pool.reserve(size_t(n));
+    }
 };
 
 // -----------------------------------------------------------------------
+
+#ifdef MYMAP_HAS_PMR
+/* pmr_mymap:
+ * mymap whose node blocks come from a std::pmr::memory_resource,
+ * e.g. a monotonic_buffer_resource for build-once maps.
+*/
+template<typename keyType, typename valueType,
+    typename Compare = less<keyType>>
+using pmr_mymap = mymap<keyType, valueType, Compare,
+    std::pmr::polymorphic_allocator<pair<const keyType, valueType>>>;
+#endif
+
+// -----------------------------------------------------------------------
@@ -0,0 +1,548 @@
+// -----------------------------------------------------------------------
+
+// mymap - mymap_journal.h
+//
+// mymap_journal.h implements a write-ahead log of put
+// records and journaled_mymap, a mymap that logs every
+// put before making it. Records are fsynced in groups:
+// a batch goes to disk at most once per commit window,
+// so many puts share one fsync. On startup the last
+// snapshot is loaded and the log replayed on top of it
+// with one putBatch.
+
+// -----------------------------------------------------------------------
+
+#pragma once
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <stdexcept>
+#include <utility>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <exception>
+#include "mymap.h"
+#include "mymap_snapshot.h"
+using namespace std;
+
+// -----------------------------------------------------------------------
+
+/* mymap_journal_header:
+ * First 24 bytes of a journal file, checked like a snapshot header.
+ * Each record after it is a 32 bit payload length, the low 32 bits of
+ * the payload's mymap_checksum and the payload: key then value, stored
+ * by mymap_serializer.
+*/
+struct mymap_journal_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;  // 0x01020304 as written, catches endian mismatch
+    uint32_t keySize;
+    uint32_t valueSize;
+
+    static const uint32_t currentVersion = 1;
+};
+
+static_assert(sizeof(mymap_journal_header) == 24,
+    "mymap_journal_header must have no padding");
+
+static const char mymap_journal_magic[8] =
+    {'M', 'Y', 'M', 'A', 'P', 'L', 'O', 'G'};
+
+// -----------------------------------------------------------------------
+
+/* mymap_journal:
+ * Append-only log of put records. With a commit window of 0 every
+ * append is written and fsynced before it returns. Otherwise appends
+ * are buffered and a background thread writes and fsyncs them as one
+ * batch a window after the first of them (or once maxBatchBytes are
+ * waiting, or sync() asks), and sleeps while nothing is appended.
+ * sync() waits for the batch holding every earlier append. A crash
+ * loses at most the appends of the last window that were not synced.
+ * Throws runtime_error if the log cannot be read or written; a failed
+ * background write is rethrown by the next append() or sync().
+*/
+template<typename keyType, typename valueType>
+class mymap_journal {
+ private:
+    static const size_t recordHeaderSize = 8;
+
+    // lets mymap_serializer write straight into a batch
+    struct batchWriter {
+        vector<char>& bytes;
+
+        void write(const void* data, size_t n) {
+            const char* p = static_cast<const char*>(data);
+            bytes.insert(bytes.end(), p, p + n);
+        }
+    };
+
+    string path;
+    FILE* file;
+    long windowMicros;  // longest a record waits for its batch's fsync
+    size_t maxBatchBytes;  // flush early once this much is waiting
+
+    mutex lock;
+    condition_variable wake;  // flusher: stop, sync wanted, first append
+                              // of a batch or batch full
+    condition_variable durable;  // a batch reached the disk
+    vector<char> pending;  // appended records not yet written
+    vector<char> writing;  // batch the flusher is writing
+    uint64_t appended;  // # of records appended
+    uint64_t flushed;  // # of records written and fsynced
+    bool syncWanted;
+    bool inFlight;  // the flusher is writing a batch, lock not held
+    bool stopping;
+    exception_ptr error;  // first failed background write
+    thread flusher;
+
+    // ----------------------
+
+    static mymap_journal_header _newHeader() {
+        mymap_journal_header header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, mymap_journal_magic, 8);
+        header.version = mymap_journal_header::currentVersion;
+        header.byteOrder = mymap_snapshot_header::nativeOrder;
+        header.keySize = mymap_serializer<keyType>::fixedSize;
+        header.valueSize = mymap_serializer<valueType>::fixedSize;
+        return header;
+    }
+
+    // ----------------------
+
+    /* _writeBatch
+     * appends bytes to the log and fsyncs it
+    */
+    void _writeBatch(const char* bytes, size_t n) {
+        if (fwrite(bytes, 1, n, file) != n || fflush(file) != 0)
+            throw runtime_error("mymap: cannot write " + path);
+#ifdef MYMAP_HAS_FSYNC
+        if (fsync(fileno(file)) != 0)
+            throw runtime_error("mymap: cannot fsync " + path);
+#endif
+    }
+
+    // ----------------------
+
+    /* _rewrite
+     * replaces the log with header and the first
+     * length bytes of records, through a renamed
+     * temporary fsynced before the rename and its
+     * directory after, so a crash keeps one or the
+     * other
+    */
+    void _rewrite(const char* records, size_t length) {
+        string tmpPath = path + ".tmp";
+        FILE* out = fopen(tmpPath.c_str(), "wb");
+        if (out == nullptr)
+            throw runtime_error("mymap: cannot create " + tmpPath);
+
+        mymap_journal_header header = _newHeader();
+        bool ok = fwrite(&header, sizeof(header), 1, out) == 1
+            && (length == 0 || fwrite(records, 1, length, out) == length)
+            && fflush(out) == 0;
+#ifdef MYMAP_HAS_FSYNC
+        ok = ok && fsync(fileno(out)) == 0;
+#endif
+        ok = (fclose(out) == 0) && ok;
+        if (!ok || rename(tmpPath.c_str(), path.c_str()) != 0) {
+            remove(tmpPath.c_str());
+            throw runtime_error("mymap: cannot write " + tmpPath);
+        }
+        mymap_sync_directory(path);
+    }
+
+    // ----------------------
+
+    /* _replay
+     * calls fn(key, value) for every intact record in
+     * order. a torn or corrupt tail, left by a crash
+     * mid-write, is cut off so appends follow the last
+     * good record
+    */
+    template<typename Func>
+    void _replay(Func fn) {
+        FILE* probe = fopen(path.c_str(), "rb");
+        if (probe == nullptr) {
+            _rewrite(nullptr, 0);
+            return;
+        }
+        fclose(probe);
+
+        size_t validEnd;
+        vector<char> kept;
+        {
+            mymap_mapped_file log(path, true);
+            mymap_journal_header header;
+            if (log.size() < sizeof(header)) {  // torn while created
+                _rewrite(nullptr, 0);
+                return;
+            }
+            memcpy(&header, log.data(), sizeof(header));
+
+            mymap_journal_header expected = _newHeader();
+            if (memcmp(header.magic, expected.magic, 8) != 0)
+                throw runtime_error("mymap: not a mymap journal " + path);
+            if (header.version != expected.version
+                || header.byteOrder != expected.byteOrder
+                || header.keySize != expected.keySize
+                || header.valueSize != expected.valueSize)
+                throw runtime_error("mymap: journal types differ " + path);
+
+            const char* begin = log.data() + sizeof(header);
+            const char* end = log.data() + log.size();
+            const char* in = begin;
+
+            while (size_t(end - in) >= recordHeaderSize) {
+                uint32_t length;
+                uint32_t check;
+                memcpy(&length, in, 4);
+                memcpy(&check, in + 4, 4);
+                const char* payload = in + recordHeaderSize;
+                if (size_t(end - payload) < length)
+                    break;
+
+                mymap_checksum sum;
+                sum.update(payload, length);
+                if (uint32_t(sum.value()) != check)
+                    break;
+
+                keyType key;
+                valueType value;
+                const char* p = mymap_serializer<keyType>::read(payload,
+                    payload + length, key);
+                if (p != nullptr)
+                    p = mymap_serializer<valueType>::read(p,
+                        payload + length, value);
+                if (p != payload + length)
+                    break;
+
+                fn(key, value);
+                in = payload + length;
+            }
+
+            validEnd = size_t(in - begin);
+            if (in != end)
+                kept.assign(begin, in);
+            else
+                return;
+        }
+        _rewrite(kept.data(), validEnd);
+    }
+
+    // ----------------------
+
+    /* _flushLoop
+     * the flusher thread: sleeps until a record is
+     * appended, gives the batch a window to fill (less
+     * when asked), then writes it and fsyncs it once
+    */
+    void _flushLoop() {
+        unique_lock<mutex> guard(lock);
+
+        while (true) {
+            wake.wait(guard, [this] {
+                return stopping || syncWanted || !pending.empty();
+            });
+            wake.wait_for(guard, chrono::microseconds(windowMicros),
+                [this] {
+                    return stopping || syncWanted
+                        || pending.size() >= maxBatchBytes;
+                });
+            syncWanted = false;
+
+            if (!pending.empty()) {
+                writing.swap(pending);
+                uint64_t batchEnd = appended;
+                inFlight = true;
+                guard.unlock();
+
+                exception_ptr failed;
+                try {
+                    _writeBatch(writing.data(), writing.size());
+                } catch (...) {
+                    failed = current_exception();
+                }
+                writing.clear();
+
+                guard.lock();
+                inFlight = false;
+                if (failed) {
+                    error = failed;
+                    durable.notify_all();
+                    return;
+                }
+                flushed = batchEnd;
+                durable.notify_all();
+            }
+
+            // appends made while the last batch was written go out too
+            if (stopping && pending.empty())
+                return;
+        }
+    }
+
+    // ----------------------
+
+    void _throwIfFailed() {
+        if (error)
+            rethrow_exception(error);
+    }
+
+    // ----------------------
+ public:
+    /* constructor :
+     * Opens the log at path, creating it if missing. Records already in
+     * it are passed to replay(key, value) in order first; a torn record
+     * at the end is dropped. windowMicros is the group commit window (0
+     * = fsync every append); maxBatchBytes flushes a batch early.
+     * Time complexity: O(records in the log)
+    */
+    template<typename Func>
+    mymap_journal(const string& logPath, Func replay,
+        long window = 1000, size_t maxBatch = 1 << 20)
+        : path(logPath), file(nullptr), windowMicros(window),
+          maxBatchBytes(maxBatch), appended(0), flushed(0),
+          syncWanted(false), inFlight(false), stopping(false) {
+        _replay(replay);
+
+        file = fopen(path.c_str(), "ab");
+        if (file == nullptr)
+            throw runtime_error("mymap: cannot open " + path);
+
+        if (windowMicros > 0)
+            flusher = thread(&mymap_journal::_flushLoop, this);
+    }
+
+    mymap_journal(const mymap_journal&) = delete;
+    mymap_journal& operator=(const mymap_journal&) = delete;
+
+    // ----------------------
+
+    /* destructor:
+     * Writes and fsyncs whatever is still buffered, then closes the log.
+    */
+    ~mymap_journal() {
+        if (flusher.joinable()) {
+            {
+                lock_guard<mutex> guard(lock);
+                stopping = true;
+            }
+            wake.notify_one();
+            flusher.join();
+        }
+        if (file != nullptr)
+            fclose(file);
+    }
+
+    // ----------------------
+
+    /* append:
+     * Adds a put record. Durable on return with a window of 0, else
+     * once its batch is fsynced (see sync()).
+     * Time complexity: O(size of key and value), plus one fsync with a
+     * window of 0
+    */
+    void append(const keyType& key, const valueType& value) {
+        lock_guard<mutex> guard(lock);
+        _throwIfFailed();
+
+        // header first, filled in once the payload size is known
+        size_t start = pending.size();
+        pending.resize(start + recordHeaderSize);
+        batchWriter out{pending};
+        mymap_serializer<keyType>::write(out, key);
+        mymap_serializer<valueType>::write(out, value);
+
+        uint32_t length = uint32_t(pending.size() - start - recordHeaderSize);
+        mymap_checksum sum;
+        sum.update(pending.data() + start + recordHeaderSize, length);
+        uint32_t check = uint32_t(sum.value());
+        memcpy(pending.data() + start, &length, 4);
+        memcpy(pending.data() + start + 4, &check, 4);
+        appended++;
+
+        if (windowMicros == 0) {
+            try {
+                _writeBatch(pending.data(), pending.size());
+            } catch (...) {
+                error = current_exception();
+                throw;
+            }
+            pending.clear();
+            flushed = appended;
+        } else if (start == 0 || pending.size() >= maxBatchBytes) {
+            wake.notify_one();  // a batch to start, or a full one
+        }
+    }
+
+    // ----------------------
+
+    /* sync:
+     * Waits until every record appended so far is on disk; the records
+     * of concurrent appends share the same fsync.
+     * Time complexity: at most one commit window and one fsync
+    */
+    void sync() {
+        unique_lock<mutex> guard(lock);
+        _throwIfFailed();
+        if (windowMicros == 0)
+            return;
+
+        uint64_t target = appended;
+        syncWanted = true;
+        wake.notify_one();
+        durable.wait(guard, [this, target] {
+            return flushed >= target || error;
+        });
+        _throwIfFailed();
+    }
+
+    // ----------------------
+
+    /* truncate:
+     * Drops every record, written or buffered, and starts an empty log;
+     * used once a snapshot holds all of them.
+     * Time complexity: O(1) plus one fsync
+    */
+    void truncate() {
+        unique_lock<mutex> guard(lock);
+        durable.wait(guard, [this] { return !inFlight; });
+        _throwIfFailed();
+
+        pending.clear();
+        flushed = appended;
+        fclose(file);
+        file = nullptr;
+
+        _rewrite(nullptr, 0);
+        file = fopen(path.c_str(), "ab");
+        if (file == nullptr)
+            throw runtime_error("mymap: cannot open " + path);
+    }
+};
+
+// -----------------------------------------------------------------------
+
+/* journaled_mymap:
+ * A mymap whose puts are logged to a mymap_journal before they are
+ * made. Opening it loads the snapshot at snapshotPath (if any) and
+ * bulk inserts the log's records on top with putBatch; checkpoint()
+ * saves a new snapshot and empties the log. put, sync, checkpoint and
+ * the lookups may be called from any number of threads: one lock
+ * keeps the log in the order the puts are made, and puts that sync
+ * from several threads share fsyncs.
+*/
+template<typename keyType, typename valueType>
+class journaled_mymap {
+ private:
+    string snapshotPath;
+    mutable mutex lock;  // held across a put's append and insert
+    mymap<keyType, valueType> map;
+    vector<pair<keyType, valueType>> replayed;  // log records at startup
+    mymap_journal<keyType, valueType> journal;
+
+    // ----------------------
+
+    static bool _exists(const string& path) {
+        FILE* probe = fopen(path.c_str(), "rb");
+        if (probe != nullptr)
+            fclose(probe);
+        return probe != nullptr;
+    }
+
+    // ----------------------
+ public:
+    /* constructor :
+     * Loads the snapshot, replays the log on top of it in one putBatch
+     * (the last record for a key wins) and opens the log for appends.
+     * windowMicros / maxBatchBytes set the group commit, see
+     * mymap_journal.
+     * Time complexity: O(n + r logr), where n is the size of the
+     * snapshot and r the # of records in the log
+    */
+    journaled_mymap(const string& snapshot, const string& logPath,
+        long windowMicros = 1000, size_t maxBatchBytes = 1 << 20)
+        : snapshotPath(snapshot),
+          journal(logPath,
+              [this](const keyType& key, const valueType& value) {
+                  replayed.push_back(make_pair(key, value));
+              },
+              windowMicros, maxBatchBytes) {
+        if (_exists(snapshotPath))
+            map.load(snapshotPath);
+
+        map.putBatch(replayed.begin(), replayed.end());
+        vector<pair<keyType, valueType>>().swap(replayed);
+    }
+
+    // ----------------------
+
+    /* put:
+     * Logs the put, then makes it. See mymap_journal::append for when
+     * it is durable.
+     * Time complexity: same as mymap::put, plus the append
+    */
+    void put(const keyType& key, const valueType& value) {
+        lock_guard<mutex> guard(lock);
+        journal.append(key, value);
+        map.put(key, value);
+    }
+
+    // ----------------------
+
+    /* sync:
+     * Waits until every put so far is on disk. It does not hold the
+     * lock, so other threads go on putting meanwhile.
+    */
+    void sync() { journal.sync(); }
+
+    // ----------------------
+
+    /* checkpoint:
+     * Saves a snapshot of the map and empties the log, with puts held
+     * off so none lands in between. save() fsyncs the snapshot and its
+     * directory before the log is emptied, so a crash at any point
+     * leaves the old snapshot with the whole log, or the new snapshot
+     * with the log (whose puts it already holds) or with none.
+     * Time complexity: O(n)
+    */
+    void checkpoint() {
+        lock_guard<mutex> guard(lock);
+        map.save(snapshotPath);
+        journal.truncate();
+    }
+
+    // ----------------------
+
+    bool contains(const keyType& key) const {
+        lock_guard<mutex> guard(lock);
+        return map.contains(key);
+    }
+
+    // a copy, the value may change once the lock is let go
+    valueType get(const keyType& key) const {
+        lock_guard<mutex> guard(lock);
+        return map.get(key);
+    }
+
+    int Size() {
+        lock_guard<mutex> guard(lock);
+        return map.Size();
+    }
+
+    // ----------------------
+
+    /* getMap:
+     * Read only access to the map, e.g. to iterate it; not locked, so
+     * only while no other thread puts.
+    */
+    const mymap<keyType, valueType>& getMap() const { return map; }
+};
+
+// -----------------------------------------------------------------------
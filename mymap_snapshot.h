@@ -0,0 +1,497 @@
+// -----------------------------------------------------------------------
+
+// mymap - mymap_snapshot.h
+//
+// mymap_snapshot.h implements the binary snapshot format
+// written by mymap::save() and read by mymap::load() and
+// mapped_mymap: a header followed by the key/value records
+// in key order. Files are memory-mapped for reading.
+
+// -----------------------------------------------------------------------
+
+#pragma once
+#include <string>
+#include <vector>
+#include <fstream>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <iterator>
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#define MYMAP_HAS_MMAP 1
+#define MYMAP_HAS_FSYNC 1
+#endif
+using namespace std;
+
+// -----------------------------------------------------------------------
+
+/* mymap_snapshot_header:
+ * First 48 bytes of a snapshot file. keySize / valueSize are the bytes
+ * per key / value, 0 when they are length-prefixed. The checksum covers
+ * the payload, the records that follow the header, and every header
+ * field before it (see mymap_snapshot_checksum); version 1 files
+ * checksum the payload only.
+*/
+struct mymap_snapshot_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;  // 0x01020304 as written, catches endian mismatch
+    uint64_t count;  // # of records
+    uint32_t keySize;
+    uint32_t valueSize;
+    uint64_t payloadSize;  // # of bytes of records
+    uint64_t checksum;
+
+    static const uint32_t currentVersion = 2;
+    static const uint32_t nativeOrder = 0x01020304;
+};
+
+static_assert(sizeof(mymap_snapshot_header) == 48,
+    "mymap_snapshot_header must have no padding");
+
+static const char mymap_snapshot_magic[8] =
+    {'M', 'Y', 'M', 'A', 'P', 'S', 'N', 'P'};
+
+// -----------------------------------------------------------------------
+
+/* mymap_checksum:
+ * 64 bit FNV-1a style hash taken a word at a time so checking a large
+ * snapshot is not the slow part of loading it. Bytes may be added in any
+ * pieces; the result only depends on the byte sequence.
+*/
+class mymap_checksum {
+ private:
+    static const uint64_t prime = 0x100000001b3ULL;
+
+    uint64_t hash;
+    uint64_t pending;  // bytes of a partial word, low byte first
+    int nPending;
+
+    void _mixWord(uint64_t word) {
+        hash = (hash ^ word) * prime;
+        hash ^= hash >> 29;
+    }
+
+ public:
+    mymap_checksum()
+        : hash(0xcbf29ce484222325ULL), pending(0), nPending(0) {}
+
+    void update(const char* bytes, size_t n) {
+        // finish a partial word first
+        while (n > 0 && nPending > 0) {
+            pending |= uint64_t(uint8_t(*bytes++)) << (8 * nPending);
+            n--;
+            if (++nPending == 8) {
+                _mixWord(pending);
+                pending = 0;
+                nPending = 0;
+            }
+        }
+
+        for (; n >= 8; n -= 8, bytes += 8) {
+            uint64_t word;
+            memcpy(&word, bytes, 8);
+            _mixWord(word);
+        }
+
+        for (; n > 0 && nPending < 8; n--) {  // n < 8 is left here
+            pending |= uint64_t(uint8_t(*bytes++)) << (8 * nPending);
+            nPending++;
+        }
+    }
+
+    uint64_t value() const {
+        uint64_t h = hash;
+        if (nPending > 0)
+            h = (h ^ pending ^ (uint64_t(nPending) << 56)) * prime;
+        return h ^ (h >> 32);
+    }
+};
+
+// -----------------------------------------------------------------------
+
+/* mymap_snapshot_checksum:
+ * The checksum stored in header: the header hashed with its checksum
+ * field holding payloadSum, the payload's mymap_checksum. A changed
+ * count, size or type field fails it as a changed record does.
+*/
+inline uint64_t mymap_snapshot_checksum(const mymap_snapshot_header& header,
+    uint64_t payloadSum) {
+    if (header.version < 2)
+        return payloadSum;
+
+    mymap_snapshot_header folded = header;
+    folded.checksum = payloadSum;
+
+    mymap_checksum checksum;
+    checksum.update(reinterpret_cast<const char*>(&folded), sizeof(folded));
+    return checksum.value();
+}
+
+// -----------------------------------------------------------------------
+
+/* mymap_sync_directory:
+ * fsyncs the directory holding path, so that a file just created or
+ * renamed there is still there after a crash. Throws runtime_error if
+ * it cannot.
+*/
+inline void mymap_sync_directory(const string& path) {
+#ifdef MYMAP_HAS_FSYNC
+    size_t slash = path.find_last_of('/');
+    string dir = (slash == string::npos) ? string(".")
+        : (slash == 0) ? string("/") : path.substr(0, slash);
+
+    int fd = open(dir.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw runtime_error("mymap: cannot open " + dir);
+    bool ok = fsync(fd) == 0;
+    close(fd);
+    if (!ok)
+        throw runtime_error("mymap: cannot fsync " + dir);
+#else
+    (void)path;
+#endif
+}
+
+// -----------------------------------------------------------------------
+
+/* mymap_snapshot_writer:
+ * Buffers records, checksums them and writes them after the header.
+ * The file is written under path + ".tmp", fsynced, renamed over path
+ * and its directory fsynced by finish(), so after a crash path holds
+ * either the old snapshot or the whole new one. Throws runtime_error
+ * if the file cannot be written; the ".tmp" file is removed when
+ * writing fails or the writer is destroyed unfinished.
+*/
+class mymap_snapshot_writer {
+ private:
+    static const size_t bufferSize = 1 << 20;
+
+    string path;
+    string tmpPath;
+    FILE* out;  // the ".tmp" file, nullptr once finished
+    vector<char> buffer;
+    mymap_checksum checksum;
+    mymap_snapshot_header header;
+
+    /* _abandon
+     * closes and removes the ".tmp" file
+    */
+    void _abandon() {
+        if (out != nullptr) {
+            fclose(out);
+            out = nullptr;
+            remove(tmpPath.c_str());
+        }
+    }
+
+    void _write(const char* bytes, size_t n) {
+        if (n > 0 && fwrite(bytes, 1, n, out) != n) {
+            _abandon();
+            throw runtime_error("mymap: cannot write " + tmpPath);
+        }
+    }
+
+    void _flush() {
+        _write(buffer.data(), buffer.size());
+        buffer.clear();
+    }
+
+ public:
+    mymap_snapshot_writer(const string& filePath, uint64_t count,
+        uint32_t keySize, uint32_t valueSize)
+        : path(filePath), tmpPath(filePath + ".tmp"), out(nullptr) {
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, mymap_snapshot_magic, 8);
+        header.version = mymap_snapshot_header::currentVersion;
+        header.byteOrder = mymap_snapshot_header::nativeOrder;
+        header.count = count;
+        header.keySize = keySize;
+        header.valueSize = valueSize;
+
+        out = fopen(tmpPath.c_str(), "wb");
+        if (out == nullptr)
+            throw runtime_error("mymap: cannot create " + tmpPath);
+
+        // placeholder, rewritten by finish() once the checksum is known
+        _write(reinterpret_cast<const char*>(&header), sizeof(header));
+        buffer.reserve(bufferSize);
+    }
+
+    mymap_snapshot_writer(const mymap_snapshot_writer&) = delete;
+    mymap_snapshot_writer& operator=(const mymap_snapshot_writer&) = delete;
+
+    ~mymap_snapshot_writer() { _abandon(); }
+
+    // ----------------------
+
+    void write(const void* bytes, size_t n) {
+        const char* p = static_cast<const char*>(bytes);
+        checksum.update(p, n);
+        header.payloadSize += n;
+
+        if (buffer.size() + n > bufferSize)
+            _flush();
+        if (n > bufferSize)
+            _write(p, n);
+        else
+            buffer.insert(buffer.end(), p, p + n);
+    }
+
+    // ----------------------
+
+    void finish() {
+        _flush();
+        header.checksum = mymap_snapshot_checksum(header, checksum.value());
+
+        bool ok = fseek(out, 0, SEEK_SET) == 0
+            && fwrite(&header, sizeof(header), 1, out) == 1
+            && fflush(out) == 0;
+#ifdef MYMAP_HAS_FSYNC
+        ok = ok && fsync(fileno(out)) == 0;
+#endif
+        ok = (fclose(out) == 0) && ok;
+        out = nullptr;
+        if (!ok || rename(tmpPath.c_str(), path.c_str()) != 0) {
+            remove(tmpPath.c_str());
+            throw runtime_error("mymap: cannot write " + tmpPath);
+        }
+        mymap_sync_directory(path);
+    }
+};
+
+// -----------------------------------------------------------------------
+
+/* mymap_mapped_file:
+ * Read only view of a whole file: memory-mapped where mmap exists,
+ * read into memory otherwise. Throws runtime_error if the file cannot
+ * be opened.
+*/
+class mymap_mapped_file {
+ private:
+    const char* bytes;
+    size_t length;
+    vector<char> buffer;  // file contents when not mapped
+
+ public:
+    /* sequential says the file will be read front to back once (load),
+     * otherwise access is random (lookups off the mapping)
+    */
+    mymap_mapped_file(const string& path, bool sequential)
+        : bytes(nullptr), length(0) {
+#ifdef MYMAP_HAS_MMAP
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            throw runtime_error("mymap: cannot open " + path);
+
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            close(fd);
+            throw runtime_error("mymap: cannot stat " + path);
+        }
+
+        length = size_t(st.st_size);
+        if (length > 0) {
+            void* p = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p == MAP_FAILED) {
+                close(fd);
+                throw runtime_error("mymap: cannot map " + path);
+            }
+            madvise(p, length, sequential ? MADV_SEQUENTIAL : MADV_RANDOM);
+            bytes = static_cast<const char*>(p);
+        }
+        close(fd);
+#else
+        (void)sequential;
+        ifstream in(path.c_str(), ios::binary);
+        if (!in)
+            throw runtime_error("mymap: cannot open " + path);
+
+        buffer.assign(istreambuf_iterator<char>(in),
+            istreambuf_iterator<char>());
+        bytes = buffer.data();
+        length = buffer.size();
+#endif
+    }
+
+    mymap_mapped_file(const mymap_mapped_file&) = delete;
+    mymap_mapped_file& operator=(const mymap_mapped_file&) = delete;
+
+    ~mymap_mapped_file() {
+#ifdef MYMAP_HAS_MMAP
+        if (bytes != nullptr)
+            munmap(const_cast<char*>(bytes), length);
+#endif
+    }
+
+    const char* data() const { return bytes; }
+
+    size_t size() const { return length; }
+};
+
+// -----------------------------------------------------------------------
+
+/* mymap_serializer:
+ * How one key or value is stored in a snapshot or journal. Trivially
+ * copyable types are stored raw (fixedSize bytes) and strings as a 64
+ * bit length followed by the characters; specialize it for other types.
+ * write() takes any out with write(bytes, n). read() returns the
+ * position after the value, nullptr if it runs past end.
+*/
+template<typename T, typename Enable = void>
+struct mymap_serializer;
+
+template<typename T>
+struct mymap_serializer<T,
+    typename enable_if<is_trivially_copyable<T>::value>::type> {
+    static const uint32_t fixedSize = sizeof(T);
+
+    template<typename Out>
+    static void write(Out& out, const T& value) {
+        out.write(&value, sizeof(T));
+    }
+
+    static const char* read(const char* in, const char* end, T& value) {
+        if (size_t(end - in) < sizeof(T))
+            return nullptr;
+
+        memcpy(&value, in, sizeof(T));
+        return in + sizeof(T);
+    }
+};
+
+template<>
+struct mymap_serializer<string> {
+    static const uint32_t fixedSize = 0;
+
+    template<typename Out>
+    static void write(Out& out, const string& value) {
+        uint64_t length = value.size();
+        out.write(&length, sizeof(length));
+        out.write(value.data(), value.size());
+    }
+
+    static const char* read(const char* in, const char* end, string& value) {
+        uint64_t length;
+        if (size_t(end - in) < sizeof(length))
+            return nullptr;
+
+        memcpy(&length, in, sizeof(length));
+        in += sizeof(length);
+        if (uint64_t(end - in) < length)
+            return nullptr;
+
+        value.assign(in, size_t(length));
+        return in + length;
+    }
+};
+
+// -----------------------------------------------------------------------
+
+/* mymap_snapshot_check:
+ * Checks that file holds a complete, uncorrupted snapshot of keyType /
+ * valueType records and returns its header. The checksum pass reads
+ * the whole payload and may be skipped. Throws runtime_error if not.
+*/
+template<typename keyType, typename valueType>
+mymap_snapshot_header mymap_snapshot_check(const mymap_mapped_file& file,
+    bool verifyChecksum) {
+    mymap_snapshot_header header;
+    if (file.size() < sizeof(header))
+        throw runtime_error("mymap: snapshot is truncated");
+    memcpy(&header, file.data(), sizeof(header));
+
+    if (memcmp(header.magic, mymap_snapshot_magic, 8) != 0)
+        throw runtime_error("mymap: not a mymap snapshot");
+    if (header.version < 1
+        || header.version > mymap_snapshot_header::currentVersion)
+        throw runtime_error("mymap: unsupported snapshot version");
+    if (header.byteOrder != mymap_snapshot_header::nativeOrder)
+        throw runtime_error("mymap: snapshot has the wrong byte order");
+    if (header.keySize != mymap_serializer<keyType>::fixedSize
+        || header.valueSize != mymap_serializer<valueType>::fixedSize)
+        throw runtime_error("mymap: snapshot key/value types differ");
+    if (header.payloadSize != file.size() - sizeof(header)
+        || header.count > uint64_t(INT32_MAX))
+        throw runtime_error("mymap: snapshot is truncated");
+
+    uint64_t recordSize = uint64_t(header.keySize) + header.valueSize;
+    if (header.keySize != 0 && header.valueSize != 0
+        && header.payloadSize != header.count * recordSize)
+        throw runtime_error("mymap: snapshot is truncated");
+
+    // every record takes at least a byte per length-prefixed field, so
+    // a count the payload cannot hold is caught before anything is
+    // sized by it; version 1 checksums do not cover count
+    uint64_t minRecordSize = uint64_t(max<uint32_t>(header.keySize, 1))
+        + max<uint32_t>(header.valueSize, 1);
+    if (header.count > header.payloadSize / minRecordSize)
+        throw runtime_error("mymap: snapshot is truncated");
+
+    if (verifyChecksum) {
+        mymap_checksum checksum;
+        checksum.update(file.data() + sizeof(header),
+            size_t(header.payloadSize));
+        if (mymap_snapshot_checksum(header, checksum.value())
+            != header.checksum)
+            throw runtime_error("mymap: snapshot checksum mismatch");
+    }
+    return header;
+}
+
+// -----------------------------------------------------------------------
+
+/* mymap_snapshot_reader:
+ * Input iterator over the count records of a checked snapshot, decoded
+ * straight from the mapping; it->first / it->second are the current
+ * key and value. Throws runtime_error on a malformed record, and when
+ * the payload does not hold exactly count records: it runs out early,
+ * or bytes are left once the iterator moves past the last record.
+*/
+template<typename keyType, typename valueType>
+class mymap_snapshot_reader {
+ private:
+    const char* in;
+    const char* end;
+    uint64_t remaining;  // # of records not decoded yet
+    pair<keyType, valueType> current;
+
+ public:
+    mymap_snapshot_reader(const mymap_mapped_file& file, uint64_t count)
+        : in(file.data() + sizeof(mymap_snapshot_header)),
+          end(file.data() + file.size()), remaining(count) {
+        ++*this;
+    }
+
+    const pair<keyType, valueType>* operator ->() const { return &current; }
+
+    const pair<keyType, valueType>& operator *() const { return current; }
+
+    mymap_snapshot_reader& operator++() {
+        if (remaining == 0) {  // past the last record
+            if (in != end)
+                throw runtime_error("mymap: malformed snapshot");
+            return *this;
+        }
+        if (in == end)
+            throw runtime_error("mymap: malformed snapshot");
+        remaining--;
+
+        in = mymap_serializer<keyType>::read(in, end, current.first);
+        if (in != nullptr)
+            in = mymap_serializer<valueType>::read(in, end, current.second);
+        if (in == nullptr)
+            throw runtime_error("mymap: malformed snapshot record");
+        return *this;
+    }
+};
+
+// -----------------------------------------------------------------------
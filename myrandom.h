@@ -12,12 +12,121 @@
 #include <cstdlib>
 #include <cmath>
 #include <ctime>
+#include <cstdint>
+#include <atomic>
+#include <vector>
+#include <utility>
 using namespace std;
 
 // -----------------------------------------------------------------------
 
 bool useAutograder = true;
 int seed = 15;
+
+// -----------------------------------------------------------------------
+
+/*
+ * Function: splitmix64
+ * Usage: uint64_t z = splitmix64(state);
+ * ----------------------------------------
+ * Advances state and returns the next splitmix64 output; used to
+ * expand one seed into a full xoshiro256 state.
+ */
+inline uint64_t splitmix64(uint64_t& state) {
+    uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+// -----------------------------------------------------------------------
+
+/*
+ * Class: xoshiro256
+ * Usage: xoshiro256 gen(seed); uint64_t r = gen();
+ * ----------------------------------------
+ * xoshiro256** generator: fast, 256 bits of state and usable with the
+ * <random> distributions. Not shared between threads.
+ */
+class xoshiro256 {
+ private:
+    uint64_t s[4];
+
+    static uint64_t rotl(uint64_t x, int k) {
+        return (x << k) | (x >> (64 - k));
+    }
+
+ public:
+    typedef uint64_t result_type;
+
+    explicit xoshiro256(uint64_t seedValue) { reseed(seedValue); }
+
+    void reseed(uint64_t seedValue) {
+        for (int i = 0; i < 4; i++)
+            s[i] = splitmix64(seedValue);
+    }
+
+    static constexpr uint64_t min() { return 0; }
+    static constexpr uint64_t max() { return UINT64_MAX; }
+
+    uint64_t operator()() {
+        uint64_t result = rotl(s[1] * 5, 7) * 9;
+        uint64_t t = s[1] << 17;
+
+        s[2] ^= s[0];
+        s[3] ^= s[1];
+        s[1] ^= s[2];
+        s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = rotl(s[3], 45);
+        return result;
+    }
+
+    /* below:
+     * returns a uniform integer in [0, range) without division or
+     * floating point (Lemire's multiply-shift), range <= 2^32.
+     */
+    uint64_t below(uint64_t range) {
+        return ((operator()() >> 32) * range) >> 32;
+    }
+};
+
+// -----------------------------------------------------------------------
+
+/*
+ * Function: threadGenerator
+ * Usage: xoshiro256& gen = threadGenerator();
+ * ----------------------------------------
+ * Returns the calling thread's generator. With useAutograder the n-th
+ * thread to ask is seeded from (seed, n), so runs reproduce; otherwise
+ * the time is mixed in.
+ */
+inline xoshiro256& threadGenerator() {
+    static atomic<uint64_t> threadCount(0);
+    thread_local xoshiro256 gen([] {
+        uint64_t state = uint64_t(seed);
+        uint64_t stream = threadCount.fetch_add(1);
+        if (!useAutograder)
+            state ^= uint64_t(time(NULL));
+        return splitmix64(state) + stream * 0x9e3779b97f4a7c15ULL;
+    }());
+    return gen;
+}
+
+// -----------------------------------------------------------------------
+
+/*
+ * Function: setRandomSeed
+ * Usage: setRandomSeed(42);
+ * ----------------------------------------
+ * Reseeds the calling thread's generator.
+ */
+inline void setRandomSeed(uint64_t seedValue) {
+    threadGenerator().reseed(seedValue);
+}
+
+// -----------------------------------------------------------------------
+
 /*
  * Function: randomInteger
  * Usage: int n = randomInteger(low, high);
@@ -25,21 +134,93 @@ int seed = 15;
  * Returns a random integer in the range low to
  * high, inclusive.
  */
-int randomInteger(int low, int high) {
-    static bool initialized = true;
-    if (!initialized) {
-        if (useAutograder) {
-            srand(seed);
-            rand();
-        } else {
-            srand(int(time(NULL)));
-            rand();   // throwaway call to get randomness going
+inline int randomInteger(int low, int high) {
+    uint64_t range = uint64_t(int64_t(high) - low + 1);
+    return int(low + int64_t(threadGenerator().below(range)));
+}
+
+// -----------------------------------------------------------------------
+
+/*
+ * Enum: keyDistribution
+ * ----------------------------------------
+ * Key orders produced by randomKeys for workloads:
+ * UNIFORM     - independent keys in [0, n * 4)
+ * ASCENDING   - 0, 1, 2, ... (worst case for rebalancing)
+ * DESCENDING  - n - 1, n - 2, ..., 0
+ * ZIPFIAN     - skewed (theta 0.99) over n distinct keys, hot keys repeat
+ * CLUSTERED   - runs of nearby keys around random centres
+ */
+enum keyDistribution { UNIFORM, ASCENDING, DESCENDING, ZIPFIAN, CLUSTERED };
+
+// -----------------------------------------------------------------------
+
+/*
+ * Function: randomKeys
+ * Usage: vector<int> keys = randomKeys(ZIPFIAN, 1000000, 7);
+ * ----------------------------------------
+ * Returns n keys drawn from dist, the same for the same seed on every
+ * machine. Zipfian follows Gray et al.'s "Quickly Generating Billion
+ * Record Synthetic Databases" and scrambles ranks so hot keys are
+ * spread over the key space.
+ */
+inline vector<int> randomKeys(keyDistribution dist, int n,
+    uint64_t seedValue = uint64_t(seed)) {
+    xoshiro256 gen(seedValue);
+    vector<int> keys;
+    keys.reserve(n);
+
+    if (dist == UNIFORM) {
+        for (int i = 0; i < n; i++)
+            keys.push_back(int(gen.below(uint64_t(n) * 4)));
+
+    } else if (dist == ASCENDING) {
+        for (int i = 0; i < n; i++)
+            keys.push_back(i);
+
+    } else if (dist == DESCENDING) {
+        for (int i = n - 1; i >= 0; i--)
+            keys.push_back(i);
+
+    } else if (dist == ZIPFIAN) {
+        const double theta = 0.99;
+        double zetan = 0;
+        for (int i = 1; i <= n; i++)
+            zetan += 1.0 / pow(double(i), theta);
+
+        double zeta2 = 1.0 + 1.0 / pow(2.0, theta);
+        double alpha = 1.0 / (1.0 - theta);
+        double eta = (1.0 - pow(2.0 / n, 1.0 - theta))
+            / (1.0 - zeta2 / zetan);
+
+        for (int i = 0; i < n; i++) {
+            double u = double(gen() >> 11) * (1.0 / 9007199254740992.0);
+            double uz = u * zetan;
+            uint64_t rank;
+            if (uz < 1.0)
+                rank = 0;
+            else if (uz < zeta2)
+                rank = 1;
+            else
+                rank = uint64_t(n * pow(eta * u - eta + 1.0, alpha));
+            if (rank >= uint64_t(n))
+                rank = n - 1;
+
+            uint64_t mixed = rank;
+            keys.push_back(int(splitmix64(mixed) & 0x7fffffff));
+        }
+
+    } else if (dist == CLUSTERED) {
+        const int clusterSize = 64;
+        uint64_t space = uint64_t(n) * 4;
+        int centre = 0;
+        for (int i = 0; i < n; i++) {
+            if (i % clusterSize == 0)
+                centre = int(gen.below(space));
+            keys.push_back(centre + int(gen.below(clusterSize * 4)));
         }
-        initialized = true;
     }
-    double d = rand() / (double(RAND_MAX) + 1);
-    double s = d * (double(high) - low + 1);
-    return int(floor(low + s));
+    return keys;
 }
 
 // -----------------------------------------------------------------------
@@ -0,0 +1,498 @@
+// -----------------------------------------------------------------------
+
+// mymap - persistent_mymap.h
+//
+// persistent_mymap.h implements a seesaw balanced BST
+// whose versions share nodes. snapshot() is O(1): it
+// only counts one more owner of the root. put copies
+// the root-to-leaf path (and the nodes of any rebuilt
+// subtree) where nodes are shared and changes or
+// relinks the nodes only this version owns in place,
+// so old versions stay readable until they are
+// released.
+
+// -----------------------------------------------------------------------
+
+#pragma once
+#include <iostream>
+#include <atomic>
+#include <vector>
+#include <string>
+#include <sstream>
+#include <utility>
+#include <algorithm>
+using namespace std;
+
+// -----------------------------------------------------------------------
+
+template<typename keyType, typename valueType>
+class persistent_mymap {
+ private:
+    // shared nodes are never changed. there are no threads: a thread
+    // would point into the old version of a node after path copying
+    struct NODE {
+        const keyType key;  // used to build BST
+        valueType value;  // stored data for the map
+        NODE* left;  // links to left child
+        NODE* right;  // links to right child
+        int nL;  // number of nodes in left subtree
+        int nR;  // number of nodes in right subtree
+        atomic<int> refs;  // # of parents and versions holding the node
+
+        NODE(const keyType& k, const valueType& v, NODE* l, NODE* r,
+            int numLeft, int numRight)
+            : key(k), value(v), left(l), right(r),
+              nL(numLeft), nR(numRight), refs(1) {}
+    };
+
+    static const int maxDepth = 128;  // bound on seesaw tree height
+
+    NODE* root;  // pointer to root node of this version
+    int size;  // # of key/value pairs in this version
+
+    // scratch for _rebuild: the subtree in order, which of its nodes
+    // this version owns, and the shared nodes whose links it drops
+    vector<NODE*> subtree;
+    vector<bool> subtreeOwned;
+    vector<NODE*> dropped;
+
+    // ----------------------
+
+    /* _retain / _release
+     * count an owner of curr in / out; the last one
+     * out frees curr and lets go of its children.
+     * the count is atomic so versions held by other
+     * threads may be released at any time
+    */
+    static void _retain(NODE* curr) {
+        if (curr != nullptr)
+            curr->refs.fetch_add(1, memory_order_relaxed);
+    }
+
+    static void _release(NODE* curr) {
+        if (curr != nullptr
+            && curr->refs.fetch_sub(1, memory_order_acq_rel) == 1) {
+            _release(curr->left);
+            _release(curr->right);
+            delete curr;
+        }
+    }
+
+    // ----------------------
+
+    /* _isOwned
+     * true if curr has no owner but its parent (or
+     * this version, for the root), so it may change
+    */
+    static bool _isOwned(NODE* curr) {
+        return curr->refs.load(memory_order_acquire) == 1;
+    }
+
+    // ----------------------
+
+    NODE* _findNode(const keyType& key) const {
+        NODE* curr = this->root;
+
+        while (curr != nullptr) {
+            if (key < curr->key)
+                curr = curr->left;
+            else if (curr->key < key)
+                curr = curr->right;
+            else
+                return curr;
+        }
+        return nullptr;
+    }
+
+    // ----------------------
+
+    /* checkViolater
+     * checks if counts violate the seesaw
+     * balancing property
+    */
+    static bool checkViolater(int nL, int nR) {
+        return max(nL, nR) > 2 * min(nL, nR) + 1;
+    }
+
+    // ----------------------
+
+    /* _fillSubtree
+     * collects curr's subtree in order, with whether
+     * this version owns each node (owned says it owns
+     * curr). a shared child of an owned node is put in
+     * dropped, as its link goes away in the rebuild
+     * helper function for _rebuild
+    */
+    void _fillSubtree(NODE* curr, bool owned) {
+        NODE* stack[maxDepth];
+        bool stackOwned[maxDepth];
+        int top = 0;
+
+        while (curr != nullptr || top > 0) {
+            while (curr != nullptr) {
+                stack[top] = curr;
+                stackOwned[top++] = owned;
+                owned = _ownsChild(owned, curr->left);
+                curr = curr->left;
+            }
+            curr = stack[--top];
+            owned = stackOwned[top];
+            subtree.push_back(curr);
+            subtreeOwned.push_back(owned);
+            owned = _ownsChild(owned, curr->right);
+            curr = curr->right;
+        }
+    }
+
+    // ----------------------
+
+    /* _ownsChild
+     * true if this version owns child, given that it
+     * owns (owned) or shares its parent; notes a shared
+     * child of an owned parent in dropped
+     * helper function for _fillSubtree
+    */
+    bool _ownsChild(bool owned, NODE* child) {
+        if (!owned || child == nullptr)
+            return false;
+        if (_isOwned(child))
+            return true;
+
+        dropped.push_back(child);
+        return false;
+    }
+
+    // ----------------------
+
+    /* _buildNodes
+     * recursive helper function for _rebuild
+     * links subtree[start, end] into a balanced subtree
+     * with key/value inserted at position pos. owned
+     * nodes are relinked, shared ones copied
+    */
+    NODE* _buildNodes(int start, int end, int pos,
+        const keyType& key, const valueType& value) {
+        if (start > end)
+            return nullptr;
+
+        int middle = (start + end) / 2;
+        NODE* left = _buildNodes(start, middle - 1, pos, key, value);
+        NODE* right = _buildNodes(middle + 1, end, pos, key, value);
+
+        int nL = middle - start;
+        int nR = end - middle;
+        if (middle == pos)
+            return new NODE(key, value, left, right, nL, nR);
+
+        int i = (middle < pos) ? middle : middle - 1;
+        NODE* old = subtree[i];
+        if (!subtreeOwned[i])
+            return new NODE(old->key, old->value, left, right, nL, nR);
+
+        old->left = left;
+        old->right = right;
+        old->nL = nL;
+        old->nR = nR;
+        return old;
+    }
+
+    // ----------------------
+
+    /* _rebuild
+     * returns violater's subtree rebuilt balanced with
+     * key/value added. nodes this version owns (owned:
+     * violater and so on down) are relinked in place,
+     * shared ones are copied and left to their other
+     * owners. linkOwned says the link to violater is
+     * this version's, to be let go if violater is shared
+    */
+    NODE* _rebuild(NODE* violater, bool linkOwned, bool owned,
+        const keyType& key, const valueType& value) {
+        subtree.clear();
+        subtreeOwned.clear();
+        dropped.clear();
+        if (linkOwned && !owned)
+            dropped.push_back(violater);
+        _fillSubtree(violater, owned);
+
+        int pos = 0;
+        while (pos < int(subtree.size()) && subtree[pos]->key < key)
+            pos++;
+
+        NODE* rebuilt = _buildNodes(0, int(subtree.size()), pos, key, value);
+
+        // shared nodes were copied above, only now may they be freed
+        for (size_t i = 0; i < dropped.size(); i++)
+            _release(dropped[i]);
+        return rebuilt;
+    }
+
+    // ----------------------
+
+    /* _put
+     * returns curr's subtree with key/value put.
+     * owned says the link to curr is this version's
+     * (the root, or a child of a node it owns); curr is
+     * then changed in place if no other version shares
+     * it, and otherwise copied and that link let go.
+     * isNew says key is not in the tree, so the counts
+     * on the path grow and the topmost node pushed out
+     * of balance is rebuilt
+    */
+    NODE* _put(NODE* curr, bool owned, const keyType& key,
+        const valueType& value, bool isNew) {
+        if (curr == nullptr)
+            return new NODE(key, value, nullptr, nullptr, 0, 0);
+
+        bool linkOwned = owned;
+        owned = owned && _isOwned(curr);
+        bool goLeft = key < curr->key;
+
+        if (!goLeft && !(curr->key < key)) {  // found, update the value
+            if (owned) {
+                curr->value = value;
+                return curr;
+            }
+            _retain(curr->left);
+            _retain(curr->right);
+            NODE* copy = new NODE(curr->key, value, curr->left, curr->right,
+                curr->nL, curr->nR);
+            if (linkOwned)
+                _release(curr);
+            return copy;
+        }
+
+        if (isNew && checkViolater(curr->nL + goLeft, curr->nR + !goLeft))
+            return _rebuild(curr, linkOwned, owned, key, value);
+
+        NODE* child = goLeft ? curr->left : curr->right;
+        NODE* newChild = _put(child, owned, key, value, isNew);
+
+        if (owned) {
+            if (goLeft)
+                curr->left = newChild;
+            else
+                curr->right = newChild;
+            curr->nL += (isNew && goLeft);
+            curr->nR += (isNew && !goLeft);
+            return curr;
+        }
+
+        // copy curr, sharing the child off the path
+        _retain(goLeft ? curr->right : curr->left);
+        NODE* copy = new NODE(curr->key, curr->value,
+            goLeft ? newChild : curr->left, goLeft ? curr->right : newChild,
+            curr->nL + (isNew && goLeft), curr->nR + (isNew && !goLeft));
+        if (linkOwned)
+            _release(curr);
+        return copy;
+    }
+
+    // ----------------------
+
+    /* _BSTPrintBalance
+     * recursive helper function for checkBalance
+    */
+    void _BSTPrintBalance(NODE* curr, stringstream& temp) const {
+        if (curr == nullptr)
+            return;
+
+        temp << "key: " << curr->key << ", "
+            << "nL: " << curr->nL << ", "
+            << "nR: " << curr->nR << endl;
+
+        _BSTPrintBalance(curr->left, temp);
+        _BSTPrintBalance(curr->right, temp);
+    }
+
+    // ----------------------
+ public:
+    /* default constructor :
+     * Creates an empty persistent_mymap.
+     * Time complexity: O(1)
+    */
+    persistent_mymap() : root(nullptr), size(0) {}
+
+    // ----------------------
+
+    /* copy constructor / operator= / snapshot:
+     * The copy shares every node with "other"; neither sees the other's
+     * later puts. A version may be read and released by another thread
+     * while this one keeps putting, but one persistent_mymap object must
+     * not be used by two threads at once.
+     * Time complexity: O(1)
+    */
+    persistent_mymap(const persistent_mymap& other)
+        : root(other.root), size(other.size) {
+        _retain(this->root);
+    }
+
+    persistent_mymap& operator=(const persistent_mymap& other) {
+        _retain(other.root);
+        _release(this->root);
+        this->root = other.root;
+        this->size = other.size;
+        return *this;
+    }
+
+    persistent_mymap snapshot() const { return persistent_mymap(*this); }
+
+    // ----------------------
+
+    persistent_mymap(persistent_mymap&& other) noexcept
+        : root(other.root), size(other.size) {
+        other.root = nullptr;
+        other.size = 0;
+    }
+
+    persistent_mymap& operator=(persistent_mymap&& other) noexcept {
+        if (this != &other) {
+            _release(this->root);
+            this->root = other.root;
+            this->size = other.size;
+            other.root = nullptr;
+            other.size = 0;
+        }
+        return *this;
+    }
+
+    // ----------------------
+
+    /* destructor:
+     * Lets go of this version; nodes no other version shares are freed.
+     * Time complexity: O(number of nodes freed)
+    */
+    ~persistent_mymap() { _release(this->root); }
+
+    // ----------------------
+
+    /* put:
+     * Inserts or updates key/value in this version only. Nodes shared
+     * with a snapshot are copied along the root-to-leaf path, and if a
+     * node on it breaks the seesaw property its subtree is rebuilt;
+     * nodes this version alone owns are changed or relinked in place,
+     * so without snapshots a put allocates only the new key's node.
+     * Time complexity: O(logn + m), where m is the size of the subtree
+     * that needs to be re-balanced.
+    */
+    void put(const keyType& key, const valueType& value) {
+        bool isNew = (_findNode(key) == nullptr);
+
+        this->root = _put(this->root, true, key, value, isNew);
+        this->size += isNew;
+    }
+
+    // ----------------------
+
+    /* clear:
+     * Empties this version; snapshots keep their nodes.
+     * Time complexity: O(number of nodes freed)
+    */
+    void clear() {
+        _release(this->root);
+        this->root = nullptr;
+        this->size = 0;
+    }
+
+    // ----------------------
+
+    /* contains:
+     * Returns true if the key is in this version, return false if not.
+     * Time complexity: O(logn)
+    */
+    bool contains(const keyType& key) const {
+        return _findNode(key) != nullptr;
+    }
+
+    // ----------------------
+
+    /* get:
+     * Returns the value for the given key; if the key is not found, the
+     * default value, valueType(), is returned (but not added). The
+     * reference is valid until this version is next changed.
+     * Time complexity: O(logn)
+    */
+    const valueType& get(const keyType& key) const {
+        static const valueType defaultValue = valueType();
+
+        NODE* curr = _findNode(key);
+        return (curr != nullptr) ? curr->value : defaultValue;
+    }
+
+    // ----------------------
+
+    /* Size:
+     * Returns the # of key/value pairs in this version, 0 if empty.
+     * O(1)
+    */
+    int Size() const { return this->size; }
+
+    // ----------------------
+
+    /* forEach:
+     * Calls fn(key, value) for every pair of this version, in order.
+     * Time complexity: O(n), no allocation
+    */
+    template<typename Func>
+    void forEach(Func fn) const {
+        NODE* stack[maxDepth];
+        int top = 0;
+        NODE* curr = this->root;
+
+        while (curr != nullptr || top > 0) {
+            while (curr != nullptr) {
+                stack[top++] = curr;
+                curr = curr->left;
+            }
+            curr = stack[--top];
+            fn(curr->key, static_cast<const valueType&>(curr->value));
+            curr = curr->right;
+        }
+    }
+
+    // ----------------------
+
+    /* toString:
+     * Returns a string of this version, in order, in the format of
+     * mymap::toString.
+     * Time complexity: O(n)
+    */
+    string toString() const {
+        stringstream ss;
+        forEach([&ss](const keyType& k, const valueType& v) {
+            ss << "key: " << k << " value: " << v << endl;
+        });
+        return ss.str();
+    }
+
+    // ----------------------
+
+    /* toVector:
+     * Returns a vector of this version, in order.
+     * Time complexity: O(n)
+    */
+    vector<pair<keyType, valueType>> toVector() const {
+        vector<pair<keyType, valueType>> mapVector;
+        mapVector.reserve(this->size);
+
+        forEach([&mapVector](const keyType& k, const valueType& v) {
+            mapVector.push_back(make_pair(k, v));
+        });
+        return mapVector;
+    }
+
+    // ----------------------
+
+    /* checkBalance:
+     * Returns this version's tree in pre-order in mymap::checkBalance's
+     * format; the same puts give the same string as mymap.
+     * Time complexity: O(n)
+    */
+    string checkBalance() const {
+        stringstream ss;
+        _BSTPrintBalance(this->root, ss);
+        return ss.str();
+    }
+};
+
+// -----------------------------------------------------------------------
@@ -0,0 +1,403 @@
+// -----------------------------------------------------------------------
+
+// mymap - sharded_mymap.h
+//
+// sharded_mymap.h implements a thread safe map that
+// range partitions its keys across several independently
+// locked mymap shards, so writers to different key ranges
+// do not contend. Split points move as shards grow unevenly,
+// keys passing between neighbouring shards by split / join.
+
+// -----------------------------------------------------------------------
+
+#pragma once
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <atomic>
+#include <thread>
+#include <algorithm>
+#include <utility>
+#include "mymap.h"
+using namespace std;
+
+// -----------------------------------------------------------------------
+
+template<typename keyType, typename valueType>
+class sharded_mymap {
+ private:
+    struct shard {
+        mutable shared_mutex lock;  // shared for reads, unique for writes
+        mymap<keyType, valueType> map;
+    };
+
+    // shards smaller than this are never worth repartitioning
+    static const int minRepartition = 1024;
+
+    vector<unique_ptr<shard>> shards;
+    vector<keyType> bounds;  // shard i holds keys in [bounds[i-1], bounds[i])
+                             // shards past bounds.size() are still empty
+    mutable shared_mutex boundsLock;  // unique only to change bounds
+    mutable shared_mutex movingLock;  // unique while keys change shards
+    atomic<int> size;  // # of key/value pairs over all shards
+
+    // ----------------------
+
+    /* _shardOf
+     * index of the shard whose range holds key,
+     * boundsLock must be held
+    */
+    int _shardOf(const keyType& key) const {
+        return int(upper_bound(bounds.begin(), bounds.end(), key)
+            - bounds.begin());
+    }
+
+    // ----------------------
+
+    /* _lockShardOf
+     * locks the shard whose range holds key with lock
+     * and returns its index. the bounds are looked at
+     * again once the shard is locked, as keys may have
+     * moved to a neighbour meanwhile; they cannot move
+     * while the shard stays locked
+    */
+    template<typename Lock>
+    int _lockShardOf(const keyType& key, Lock& lock) const {
+        while (true) {
+            int i;
+            {
+                shared_lock<shared_mutex> guard(boundsLock);
+                i = _shardOf(key);
+            }
+
+            Lock held(shards[i]->lock);
+            shared_lock<shared_mutex> guard(boundsLock);
+            if (_shardOf(key) == i) {
+                lock = std::move(held);
+                return i;
+            }
+        }
+    }
+
+    // ----------------------
+
+    /* _isOverfull
+     * true if a shard of shardSize holds more than
+     * half again its share of the keys. that can
+     * happen with two shards (one holding over 3/4),
+     * a bound of twice the share could not
+    */
+    bool _isOverfull(int shardSize) const {
+        int average = size.load() / int(shards.size());
+        return shardSize > minRepartition
+            && shardSize > average + average / 2;
+    }
+
+    // ----------------------
+
+    /* _moveKeys
+     * moves amount keys from shard from to its
+     * neighbour to, the ones at the end facing it,
+     * by splitting them off and joining them on, and
+     * moves the split point between the two. only the
+     * two shards are locked
+     * Time complexity: O((logn)^2 + m), see mymap::split
+    */
+    void _moveKeys(int from, int to, int amount) {
+        unique_lock<shared_mutex> lowLock(shards[min(from, to)]->lock);
+        unique_lock<shared_mutex> highLock(shards[max(from, to)]->lock);
+        mymap<keyType, valueType>& source = shards[from]->map;
+        mymap<keyType, valueType>& target = shards[to]->map;
+
+        // the source keeps at least one key, so its range stays
+        amount = min(amount, source.Size() - 1);
+        if (amount <= 0)
+            return;
+
+        keyType split = source.select((to > from)
+            ? source.Size() - amount : amount).first;
+        if (to > from) {  // the top keys go up
+            mymap<keyType, valueType> moved = source.split(split);
+            target = mymap<keyType, valueType>::join(std::move(moved),
+                std::move(target));
+        } else {  // the bottom keys go down
+            mymap<keyType, valueType> kept = source.split(split);
+            target = mymap<keyType, valueType>::join(std::move(target),
+                std::move(source));
+            source = std::move(kept);
+        }
+
+        unique_lock<shared_mutex> guard(boundsLock);
+        int between = min(from, to);
+        if (between == int(bounds.size()))  // the first keys of to
+            bounds.push_back(split);
+        else
+            bounds[between] = split;
+    }
+
+    // ----------------------
+
+    /* _rebalance
+     * while a shard is overfull, moves keys from it to
+     * the nearest shard below its share, one pair of
+     * neighbours at a time along the way, so the
+     * shards in between keep their sizes. only the
+     * pair being moved between is locked; other
+     * shards stay open to reads and writes
+     * Time complexity: O(d (logn)^2) per round, where d
+     * is the distance moved, at most shardCount rounds
+    */
+    void _rebalance() {
+        unique_lock<shared_mutex> moving(movingLock);
+        int count = int(shards.size());
+
+        for (int round = 0; round < count; round++) {
+            vector<int> sizes(count);
+            for (int i = 0; i < count; i++)
+                sizes[i] = shardSize(i);
+
+            // another thread may have rebalanced already
+            int over = int(max_element(sizes.begin(), sizes.end())
+                - sizes.begin());
+            if (!_isOverfull(sizes[over]))
+                return;
+
+            int average = size.load() / count;
+            int under = -1;
+            for (int d = 1; d < count && under < 0; d++) {
+                if (over - d >= 0 && sizes[over - d] < average)
+                    under = over - d;
+                else if (over + d < count && sizes[over + d] < average)
+                    under = over + d;
+            }
+            if (under < 0)
+                return;
+
+            int amount = min(sizes[over] - average, average - sizes[under]);
+            int step = (under > over) ? 1 : -1;
+            for (int i = over; i != under; i += step)
+                _moveKeys(i, i + step, amount);
+        }
+    }
+
+    // ----------------------
+ public:
+    /* constructor :
+     * Creates an empty sharded_mymap with shardCount shards, one per
+     * hardware thread by default.
+     * Time complexity: O(shardCount)
+    */
+    explicit sharded_mymap(int shardCount = 0) : size(0) {
+        if (shardCount <= 0)
+            shardCount = max(1, int(thread::hardware_concurrency()));
+
+        for (int i = 0; i < shardCount; i++)
+            shards.push_back(unique_ptr<shard>(new shard()));
+    }
+
+    sharded_mymap(const sharded_mymap&) = delete;
+    sharded_mymap& operator=(const sharded_mymap&) = delete;
+
+    // ----------------------
+
+    /* put:
+     * Inserts or updates key/value in the shard owning key; only that
+     * shard is locked. When the shard ends up with more than half again
+     * its share of the keys, keys move from it toward the nearest
+     * shard below its share, see _rebalance.
+     * Time complexity: O(logn + m), plus O(shardCount (logn)^2) for a
+     * rebalance
+    */
+    void put(const keyType& key, const valueType& value) {
+        bool overfull;
+        {
+            unique_lock<shared_mutex> lock;
+            shard& s = *shards[_lockShardOf(key, lock)];
+
+            int before = s.map.Size();
+            s.map.put(key, value);
+            int after = s.map.Size();
+
+            if (after > before)
+                size.fetch_add(1);
+            overfull = _isOverfull(after);
+        }
+
+        if (overfull)
+            _rebalance();
+    }
+
+    // ----------------------
+
+    /* putBatch:
+     * Puts every key/value pair in [first, last) (later duplicates win).
+     * Pairs are grouped by shard and each shard is locked once and gets
+     * one mymap::putBatch.
+     * Time complexity: O(b logb + per shard putBatch cost)
+    */
+    template<typename Iter>
+    void putBatch(Iter first, Iter last) {
+        typedef vector<pair<keyType, valueType>> pairVector;
+        bool overfull = false;
+
+        pairVector left;  // pairs not put yet, in order
+        for (; first != last; ++first)
+            left.push_back(make_pair(first->first, first->second));
+
+        while (!left.empty()) {
+            vector<pairVector> groups(shards.size());
+            {
+                shared_lock<shared_mutex> guard(boundsLock);
+                for (auto& kv : left)
+                    groups[_shardOf(kv.first)].push_back(std::move(kv));
+            }
+            left.clear();
+
+            for (size_t i = 0; i < shards.size(); i++) {
+                pairVector& group = groups[i];
+                if (group.empty())
+                    continue;
+
+                shard& s = *shards[i];
+                unique_lock<shared_mutex> lock(s.lock);
+
+                // pairs whose keys moved on meanwhile go round again
+                {
+                    shared_lock<shared_mutex> guard(boundsLock);
+                    auto moved = stable_partition(group.begin(), group.end(),
+                        [this, i](const pair<keyType, valueType>& kv) {
+                            return _shardOf(kv.first) == int(i);
+                        });
+                    left.insert(left.end(), make_move_iterator(moved),
+                        make_move_iterator(group.end()));
+                    group.erase(moved, group.end());
+                }
+
+                int before = s.map.Size();
+                s.map.putBatch(group.begin(), group.end());
+                int after = s.map.Size();
+
+                size.fetch_add(after - before);
+                overfull = overfull || _isOverfull(after);
+            }
+        }
+
+        if (overfull)
+            _rebalance();
+    }
+
+    // ----------------------
+
+    /* contains:
+     * Returns true if the key is in the map, return false if not.
+     * Time complexity: O(logn)
+    */
+    bool contains(const keyType& key) const {
+        shared_lock<shared_mutex> lock;
+        const shard& s = *shards[_lockShardOf(key, lock)];
+
+        return s.map.contains(key);
+    }
+
+    // ----------------------
+
+    /* get:
+     * Returns a copy of the value for the given key; if the key is not
+     * found, the default value, valueType(), is returned.
+     * Time complexity: O(logn)
+    */
+    valueType get(const keyType& key) const {
+        shared_lock<shared_mutex> lock;
+        const shard& s = *shards[_lockShardOf(key, lock)];
+
+        return s.map.get(key);
+    }
+
+    // ----------------------
+
+    /* Size:
+     * Returns the # of key/value pairs over all shards, 0 if empty.
+     * O(1)
+    */
+    int Size() const { return size.load(); }
+
+    // ----------------------
+
+    /* shardCount:
+     * Returns the # of shards.
+     * O(1)
+    */
+    int shardCount() const { return int(shards.size()); }
+
+    // ----------------------
+
+    /* shardSize:
+     * Returns the # of key/value pairs in shard i, 0 <= i < shardCount(),
+     * the shards in key order.
+     * O(1)
+    */
+    int shardSize(int i) const {
+        shared_lock<shared_mutex> lock(shards[i]->lock);
+
+        return shards[i]->map.Size();
+    }
+
+    // ----------------------
+
+    /* forEach:
+     * Calls fn(key, value) for every pair in global key order, one shard
+     * at a time. Each shard is read consistently while it is locked;
+     * writes to shards not yet visited are seen. Keys do not move
+     * between shards meanwhile.
+     * Time complexity: O(n)
+    */
+    template<typename Func>
+    void forEach(Func fn) const {
+        shared_lock<shared_mutex> moving(movingLock);
+
+        for (size_t i = 0; i < shards.size(); i++) {
+            shared_lock<shared_mutex> lock(shards[i]->lock);
+            shards[i]->map.forEach([&fn](const keyType& k, valueType& v) {
+                fn(k, static_cast<const valueType&>(v));
+            });
+        }
+    }
+
+    // ----------------------
+
+    /* toVector:
+     * Returns a vector of the entire map, in order.
+     * Time complexity: O(n)
+    */
+    vector<pair<keyType, valueType>> toVector() const {
+        vector<pair<keyType, valueType>> mapVector;
+        mapVector.reserve(size.load());
+
+        forEach([&mapVector](const keyType& k, const valueType& v) {
+            mapVector.push_back(make_pair(k, v));
+        });
+        return mapVector;
+    }
+
+    // ----------------------
+
+    /* clear:
+     * Empties every shard and forgets the split points.
+     * Time complexity: O(n)
+    */
+    void clear() {
+        unique_lock<shared_mutex> moving(movingLock);
+        vector<unique_lock<shared_mutex>> locks;
+        for (size_t i = 0; i < shards.size(); i++)
+            locks.push_back(unique_lock<shared_mutex>(shards[i]->lock));
+
+        for (size_t i = 0; i < shards.size(); i++)
+            shards[i]->map.clear();
+        unique_lock<shared_mutex> guard(boundsLock);
+        bounds.clear();
+        size.store(0);
+    }
+};
+
+// -----------------------------------------------------------------------
@@ -0,0 +1,24 @@
+// -----------------------------------------------------------------------
+
+// mymap - tests/check.h
+//
+// check.h is the one assertion the tests use. Unlike
+// assert it stays on in release builds, and it names
+// the failed condition and where it is.
+
+// -----------------------------------------------------------------------
+
+#pragma once
+#include <cstdio>
+#include <cstdlib>
+
+#define CHECK(cond)                                                     \
+    do {                                                                \
+        if (!(cond)) {                                                  \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__,      \
+                __LINE__, #cond);                                       \
+            exit(1);                                                    \
+        }                                                               \
+    } while (0)
+
+// -----------------------------------------------------------------------
@@ -0,0 +1,181 @@
+// -----------------------------------------------------------------------
+
+// mymap - tests/test_bucket.cpp
+//
+// bucket_mymap against std::map under random puts and
+// erases, and hybrid_mymap through one generic body
+// for an arithmetic and a string key: the same code
+// must compile and behave alike on both engines,
+// iterating by reference and through it->first,
+// and reading through a const reference.
+
+// -----------------------------------------------------------------------
+
+#include <map>
+#include <string>
+#include <iterator>
+#include "bucket_mymap.h"
+#include "myrandom.h"
+#include "check.h"
+using namespace std;
+
+// -----------------------------------------------------------------------
+
+template<typename Map, typename K, typename V>
+static void checkSame(Map& m, const map<K, V>& expected) {
+    CHECK(m.Size() == int(expected.size()));
+
+    auto it = expected.begin();
+    for (auto& kv : m) {
+        CHECK(it != expected.end());
+        CHECK(kv.first == it->first && kv.second == it->second);
+        ++it;
+    }
+    CHECK(it == expected.end());
+
+    // and backwards
+    auto rit = expected.rbegin();
+    for (auto mit = m.rbegin(); mit != m.rend(); ++mit, ++rit) {
+        CHECK(rit != expected.rend());
+        CHECK(mit->first == rit->first && mit->second == rit->second);
+    }
+    CHECK(rit == expected.rend());
+}
+
+// -----------------------------------------------------------------------
+
+template<typename Map, typename K, typename V>
+static void checkBounds(Map& m, const map<K, V>& expected, const K& key) {
+    auto lower = expected.lower_bound(key);
+    auto mLower = m.lower_bound(key);
+    CHECK((lower == expected.end()) == (mLower == m.end()));
+    if (lower != expected.end())
+        CHECK(mLower->first == lower->first);
+
+    auto upper = expected.upper_bound(key);
+    auto mUpper = m.upper_bound(key);
+    CHECK((upper == expected.end()) == (mUpper == m.end()));
+    if (upper != expected.end())
+        CHECK(mUpper->first == upper->first);
+
+    auto mFound = m.find(key);
+    CHECK((mFound != m.end()) == (expected.count(key) == 1));
+    if (mFound != m.end())
+        CHECK(mFound->second == expected.at(key));
+}
+
+// -----------------------------------------------------------------------
+
+static void testBucketAgainstMap() {
+    typedef bucket_mymap<int, string> bucketMap;
+    bucketMap m;
+    map<int, string> expected;
+    xoshiro256 gen(19);
+
+    // ascending and descending runs fill whole buckets, random keys
+    // split them; erases empty buckets and take them out of the tree
+    for (int key = 0; key < 3000; key++) {
+        m.put(key, to_string(key));
+        expected[key] = to_string(key);
+        m.put(-key - 1, "d");
+        expected[-key - 1] = "d";
+    }
+    for (int i = 0; i < 60000; i++) {
+        int key = int(gen.below(20000)) - 10000;
+        if (gen.below(2) == 0) {
+            CHECK(m.erase(key) == int(expected.erase(key)));
+        } else {
+            m[key] += "x";
+            expected[key] += "x";
+        }
+        if (i % 6000 == 0) {
+            checkSame(m, expected);
+            checkBounds(m, expected, key);
+        }
+    }
+    checkSame(m, expected);
+
+    for (int i = 0; i < 2000; i++)
+        checkBounds(m, expected, int(gen.below(24000)) - 12000);
+
+    // erase through iterators, every other pair
+    auto it = m.begin();
+    auto eit = expected.begin();
+    while (it != m.end()) {
+        CHECK(it->first == eit->first);
+        it = m.erase(it);
+        eit = expected.erase(eit);
+        if (it != m.end()) {
+            ++it;
+            ++eit;
+        }
+    }
+    checkSame(m, expected);
+
+    bucketMap copy(m);
+    while (m.Size() > 0)
+        m.erase(m.begin()->first);
+    CHECK(m.begin() == m.end() && m.toVector().empty());
+    checkSame(copy, expected);
+}
+
+// -----------------------------------------------------------------------
+
+/* useHybrid
+ * the same code for any key type: key(i) makes the
+ * i-th key, in key order
+*/
+template<typename K, typename KeyOf>
+static void useHybrid(KeyOf key) {
+    hybrid_mymap<K, int> m;
+    map<K, int> expected;
+
+    for (int i = 0; i < 2000; i++) {
+        m.put(key(i), i);
+        expected[key(i)] = i;
+    }
+    for (auto& kv : m)
+        kv.second *= 2;
+    for (auto& kv : expected)
+        kv.second *= 2;
+    checkSame(m, expected);
+
+    for (int i = 0; i < 2000; i += 3) {
+        CHECK(m.erase(key(i)) == 1);
+        expected.erase(key(i));
+    }
+    CHECK(m.erase(key(0)) == 0);
+    checkSame(m, expected);
+
+    typename hybrid_mymap<K, int>::iterator it = m.find(key(4));
+    CHECK(it != m.end() && it->first == key(4) && it->second == 8);
+    auto range = m.equal_range(key(4));
+    CHECK(range.first == it && std::next(range.first) == range.second);
+    checkBounds(m, expected, key(3));
+    CHECK(m.contains(key(5)) && !m.contains(key(6)) && m.get(key(5)) == 10);
+    CHECK(*m.getPtr(key(5)) == 10 && m.getPtr(key(6)) == nullptr);
+
+    // the read only calls work through a const reference
+    const hybrid_mymap<K, int>& readOnly = m;
+    CHECK(readOnly.Size() == int(expected.size()));
+    CHECK(readOnly.toVector().size() == expected.size());
+    CHECK(!readOnly.toString().empty() && !readOnly.checkBalance().empty());
+
+    m.clear();
+    CHECK(m.Size() == 0 && m.begin() == m.end());
+}
+
+// -----------------------------------------------------------------------
+
+int main() {
+    testBucketAgainstMap();
+    useHybrid<int>([](int i) { return i; });
+    useHybrid<double>([](int i) { return i * 0.5; });
+    useHybrid<string>([](int i) {
+        string s = to_string(i);
+        return string(4 - s.size(), '0') + s;
+    });
+    return 0;
+}
+
+// -----------------------------------------------------------------------
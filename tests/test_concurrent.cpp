@@ -0,0 +1,216 @@
+// -----------------------------------------------------------------------
+
+// mymap - tests/test_concurrent.cpp
+//
+// concurrent_mymap against std::map, then a stress
+// run: readers walk snapshots and look keys up while
+// a writer puts and erases. Every snapshot must be in
+// order and hold the keys that are never erased, and
+// every node a writer replaced must be freed once the
+// readers are gone.
+
+// -----------------------------------------------------------------------
+
+#include <map>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <cstdint>
+#include "concurrent_mymap.h"
+#include "myrandom.h"
+#include "check.h"
+using namespace std;
+
+// -----------------------------------------------------------------------
+
+/* tracked
+ * a value that counts its live copies, so nodes that
+ * are never freed (or freed twice) show up
+*/
+struct tracked {
+    static atomic<long> live;
+    int64_t v;
+
+    tracked() : v(0) { live.fetch_add(1); }
+    tracked(int64_t value) : v(value) { live.fetch_add(1); }
+    tracked(const tracked& other) : v(other.v) { live.fetch_add(1); }
+    tracked& operator=(const tracked& other) {
+        v = other.v;
+        return *this;
+    }
+    ~tracked() { live.fetch_sub(1); }
+};
+
+atomic<long> tracked::live(0);
+
+typedef concurrent_mymap<int, tracked> trackedMap;
+
+// values are key * 1000 + a version, so a reader can tell a torn or
+// misplaced value from a stale one
+static int64_t valueFor(int key, int version) {
+    return int64_t(key) * 1000 + version % 1000;
+}
+
+// -----------------------------------------------------------------------
+
+static void checkSame(trackedMap& m, const map<int, int64_t>& expected) {
+    CHECK(m.Size() == int(expected.size()));
+
+    trackedMap::reader r = m.getReader();
+    auto it = expected.begin();
+    bool same = true;
+    r.forEach([&it, &expected, &same](const int& k, const tracked& v) {
+        same = same && it != expected.end() && k == it->first
+            && v.v == it->second;
+        if (it != expected.end())
+            ++it;
+    });
+    CHECK(same && it == expected.end());
+}
+
+// -----------------------------------------------------------------------
+
+static void testAgainstMap() {
+    {
+        trackedMap m;
+        map<int, int64_t> expected;
+        xoshiro256 gen(9);
+
+        for (int i = 0; i < 50000; i++) {
+            int key = int(gen.below(5000));
+            if (gen.below(3) == 0) {
+                CHECK(m.erase(key) == int(expected.erase(key)));
+            } else {
+                m.put(key, valueFor(key, i));
+                expected[key] = valueFor(key, i);
+            }
+            if (i % 5000 == 0)
+                checkSame(m, expected);
+        }
+        checkSame(m, expected);
+
+        // erasing from the ends keeps taking the same side of the tree
+        for (int key = 0; key < 2500; key++) {
+            m.erase(key);
+            expected.erase(key);
+            m.erase(4999 - key);
+            expected.erase(4999 - key);
+        }
+        checkSame(m, expected);
+
+        for (int key = 0; key < 20000; key++)
+            m.put(key, valueFor(key, 0));
+        for (int key = 0; key < 20000; key += 2)
+            m.erase(key);
+        CHECK(m.Size() == 10000);
+        CHECK(!m.contains(0) && m.contains(1) && m.get(19999).v == 19999000);
+    }
+    CHECK(tracked::live.load() == 0);
+}
+
+// -----------------------------------------------------------------------
+
+static void testStress() {
+    const int readers = 4;
+    const int pinned = 100;  // keys [0, pinned) are never erased
+    const int keyRange = 20000;
+    const int writes = 200000;
+
+    {
+        trackedMap m;
+        for (int key = 0; key < pinned; key++)
+            m.put(key, valueFor(key, 0));
+
+        atomic<bool> done(false);
+        atomic<long> snapshots(0);
+        atomic<int> failures(0);
+
+        vector<thread> threads;
+        for (int t = 0; t < readers; t++) {
+            threads.push_back(thread([&, t] {
+                trackedMap::reader r = m.getReader();
+                xoshiro256 gen(uint64_t(t) + 100);
+
+                while (!done.load()) {
+                    // one snapshot: strictly ascending, values that match
+                    // their keys and every pinned key present
+                    int last = -1;
+                    int seenPinned = 0;
+                    bool ok = true;
+                    r.forEach([&](const int& k, const tracked& v) {
+                        ok = ok && k > last && v.v / 1000 == k;
+                        seenPinned += (k < pinned);
+                        last = k;
+                    });
+                    if (!ok || seenPinned != pinned)
+                        failures.fetch_add(1);
+                    snapshots.fetch_add(1);
+
+                    for (int i = 0; i < 100; i++) {
+                        int key = int(gen.below(keyRange));
+                        tracked v = r.get(key);
+                        if (v.v != 0 && v.v / 1000 != key)
+                            failures.fetch_add(1);
+                        if (key < pinned && !r.contains(key))
+                            failures.fetch_add(1);
+                    }
+
+                    // one-off reads claim and release a record each time
+                    if (!m.contains(int(gen.below(pinned))))
+                        failures.fetch_add(1);
+                }
+            }));
+        }
+
+        // the writer, mirrored in std::map
+        map<int, int64_t> expected;
+        for (int key = 0; key < pinned; key++)
+            expected[key] = valueFor(key, 0);
+
+        xoshiro256 gen(5);
+        for (int i = 0; i < writes; i++) {
+            int key = pinned + int(gen.below(keyRange - pinned));
+            if (gen.below(2) == 0) {
+                m.erase(key);
+                expected.erase(key);
+            } else {
+                m.put(key, valueFor(key, i));
+                expected[key] = valueFor(key, i);
+            }
+        }
+
+        // keep writing until every reader has seen a few snapshots
+        for (int i = 0; snapshots.load() < 2 * readers; i++) {
+            m.put(pinned, valueFor(pinned, i));
+            expected[pinned] = valueFor(pinned, i);
+            this_thread::yield();
+        }
+
+        done.store(true);
+        for (thread& t : threads)
+            t.join();
+        CHECK(failures.load() == 0);
+        checkSame(m, expected);
+
+        // with no reader left, a reclaim frees every retired node, so
+        // fewer than a batch of them can be waiting after any write
+        for (int i = 0; i < 200; i++) {
+            int key = pinned + int(gen.below(keyRange - pinned));
+            m.erase(key);
+            expected.erase(key);
+            CHECK(tracked::live.load() < long(expected.size()) + 64);
+        }
+        checkSame(m, expected);
+    }
+    CHECK(tracked::live.load() == 0);
+}
+
+// -----------------------------------------------------------------------
+
+int main() {
+    testAgainstMap();
+    testStress();
+    return 0;
+}
+
+// -----------------------------------------------------------------------
@@ -0,0 +1,117 @@
+// -----------------------------------------------------------------------
+
+// mymap - tests/test_frozen.cpp
+//
+// frozen_mymap against std::map, for an arithmetic key
+// (16 keys per block) and a string key (one per block):
+// lookups of present and absent keys, and iteration
+// the way mymap's iterators allow, through *it as a
+// pair, it->first, pre- and post-increment and
+// decrement, including after a copy assignment.
+
+// -----------------------------------------------------------------------
+
+#include <map>
+#include <string>
+#include <iterator>
+#include <type_traits>
+#include "mymap.h"
+#include "myrandom.h"
+#include "check.h"
+using namespace std;
+
+// -----------------------------------------------------------------------
+
+template<typename Frozen, typename K, typename V>
+static void checkSame(const Frozen& f, const map<K, V>& expected) {
+    CHECK(f.Size() == int(expected.size()));
+
+    auto it = expected.begin();
+    for (const pair<const K, V>& kv : f) {
+        CHECK(it != expected.end());
+        CHECK(kv.first == it->first && kv.second == it->second);
+        ++it;
+    }
+    CHECK(it == expected.end());
+
+    // post-increment hands back the old position
+    typename Frozen::iterator fit = f.begin();
+    for (it = expected.begin(); it != expected.end(); it++) {
+        typename Frozen::iterator old = fit++;
+        CHECK(old->first == it->first && (*old).second == it->second);
+    }
+    CHECK(fit == f.end());
+
+    // and backwards
+    auto rit = expected.rbegin();
+    while (fit != f.begin()) {
+        --fit;
+        CHECK(rit != expected.rend() && fit->first == rit->first);
+        ++rit;
+    }
+    CHECK(rit == expected.rend());
+    CHECK(std::distance(f.begin(), f.end()) == f.Size());
+}
+
+// -----------------------------------------------------------------------
+
+/* testFrozen
+ * freezes a mymap of n random keys, key(i) making
+ * the i-th key in key order, and checks it against
+ * std::map
+*/
+template<typename K, typename KeyOf>
+static void testFrozen(int n, KeyOf key) {
+    typedef frozen_mymap<K, int> frozenMap;
+    typedef typename frozenMap::iterator frozenIter;
+    static_assert(is_same<decltype(*declval<frozenIter>()),
+        const pair<const K, int>&>::value, "*it is a pair");
+    static_assert(is_same<decltype(++declval<frozenIter&>()),
+        frozenIter&>::value, "++it returns the iterator");
+
+    mymap<K, int> m;
+    map<K, int> expected;
+    xoshiro256 gen(uint64_t(n) + 5);
+
+    for (int i = 0; i < n; i++) {
+        int r = int(gen.below(uint64_t(4) * n + 1));
+        m.put(key(2 * r), r);
+        expected[key(2 * r)] = r;
+    }
+
+    frozenMap f = m.freeze();
+    checkSame(f, expected);
+    CHECK(f.toVector() == m.toVector());
+
+    // odd keys are never in, nor is anything past either end
+    for (int r = -1; r <= 4 * n + 1; r++) {
+        auto it = expected.find(key(2 * r));
+        CHECK(f.contains(key(2 * r)) == (it != expected.end()));
+        CHECK(f.get(key(2 * r)) == ((it != expected.end()) ? it->second : 0));
+        CHECK(f.getPtr(key(2 * r + 1)) == nullptr);
+        CHECK(!f.contains(key(2 * r + 1)));
+    }
+
+    frozenMap copy;
+    CHECK(copy.Size() == 0 && copy.begin() == copy.end());
+    copy = f;
+    checkSame(copy, expected);
+    copy = frozenMap();
+    CHECK(copy.Size() == 0);
+    checkSame(f, expected);
+}
+
+// -----------------------------------------------------------------------
+
+int main() {
+    for (int n : {0, 1, 15, 16, 17, 300, 5000}) {
+        testFrozen<int>(n, [](int i) { return i; });
+        testFrozen<string>(n, [](int i) {
+            string s = to_string(i + 10);
+            return string(8 - s.size(), '0') + s;
+        });
+    }
+    return 0;
+}
+
+// -----------------------------------------------------------------------
@@ -0,0 +1,168 @@
+// -----------------------------------------------------------------------
+
+// mymap - tests/test_journal.cpp
+//
+// journaled_mymap reopened against what was put: from
+// the log alone, from a checkpoint with the log after
+// it, from a checkpoint and an emptied log, and with
+// a torn record at the end of the log. Puts from
+// several threads, each syncing, must come back as
+// the map held them, the last put of a key winning in
+// the log as it did in memory.
+
+// -----------------------------------------------------------------------
+
+#include <map>
+#include <string>
+#include <vector>
+#include <thread>
+#include <cstdio>
+#include "mymap.h"
+#include "mymap_journal.h"
+#include "myrandom.h"
+#include "check.h"
+using namespace std;
+
+static const char* snapPath = "test_journal.snap";
+static const char* logPath = "test_journal.log";
+
+typedef journaled_mymap<int, string> journaledMap;
+
+// -----------------------------------------------------------------------
+
+static void removeFiles() {
+    remove(snapPath);
+    remove(logPath);
+}
+
+static long fileSize(const char* name) {
+    FILE* f = fopen(name, "rb");
+    if (f == nullptr)
+        return -1;
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fclose(f);
+    return size;
+}
+
+static void checkSame(journaledMap& m, const map<int, string>& expected) {
+    CHECK(m.Size() == int(expected.size()));
+
+    auto it = expected.begin();
+    for (auto& kv : m.getMap()) {
+        CHECK(it != expected.end());
+        CHECK(kv.first == it->first && kv.second == it->second);
+        ++it;
+    }
+    CHECK(it == expected.end());
+}
+
+// -----------------------------------------------------------------------
+
+/* testReopen
+ * puts, checkpoints and reopens with a commit window
+ * of windowMicros
+*/
+static void testReopen(long windowMicros) {
+    removeFiles();
+    map<int, string> expected;
+    xoshiro256 gen(uint64_t(windowMicros) + 3);
+
+    {
+        journaledMap m(snapPath, logPath, windowMicros);
+        for (int i = 0; i < 2000; i++) {
+            int key = int(gen.below(1500));
+            m.put(key, to_string(i));
+            expected[key] = to_string(i);
+        }
+        m.sync();
+    }
+    CHECK(fileSize(snapPath) == -1);
+    {
+        journaledMap m(snapPath, logPath, windowMicros);
+        checkSame(m, expected);
+
+        // the snapshot now holds every put and the log none
+        m.checkpoint();
+        CHECK(fileSize(snapPath) > 0);
+        CHECK(fileSize(logPath) == long(sizeof(mymap_journal_header)));
+    }
+    {
+        journaledMap m(snapPath, logPath, windowMicros);
+        checkSame(m, expected);
+
+        for (int i = 0; i < 500; i++) {
+            int key = int(gen.below(3000));
+            m.put(key, "after " + to_string(i));
+            expected[key] = "after " + to_string(i);
+        }
+        m.sync();
+    }
+    {
+        journaledMap m(snapPath, logPath, windowMicros);
+        checkSame(m, expected);
+        m.checkpoint();
+        m.put(-1, "last");
+        expected[-1] = "last";
+    }
+
+    // a torn record at the end, as a crash mid-write leaves, is dropped
+    FILE* log = fopen(logPath, "ab");
+    const char torn[5] = {9, 0, 0, 0, 1};
+    fwrite(torn, 1, sizeof(torn), log);
+    fclose(log);
+    {
+        journaledMap m(snapPath, logPath, windowMicros);
+        checkSame(m, expected);
+        CHECK(m.get(-1) == "last" && m.contains(-1) && !m.contains(-2));
+    }
+    removeFiles();
+}
+
+// -----------------------------------------------------------------------
+
+static void testThreads() {
+    removeFiles();
+    const int threads = 4;
+    map<int, string> before;
+
+    {
+        journaledMap m(snapPath, logPath, 500);
+        vector<thread> putters;
+        for (int t = 0; t < threads; t++) {
+            putters.push_back(thread([&m, t] {
+                xoshiro256 gen(uint64_t(t) + 40);
+                for (int i = 0; i < 3000; i++) {
+                    m.put(int(gen.below(1000)),
+                        to_string(t) + ":" + to_string(i));
+                    if (i % 50 == 0)
+                        m.sync();
+                    if (t == 0 && i == 1500)
+                        m.checkpoint();
+                }
+                m.sync();
+            }));
+        }
+        for (thread& p : putters)
+            p.join();
+
+        for (auto& kv : m.getMap())
+            before[kv.first] = kv.second;
+    }
+    {
+        journaledMap m(snapPath, logPath, 500);
+        checkSame(m, before);
+    }
+    removeFiles();
+}
+
+// -----------------------------------------------------------------------
+
+int main() {
+    testReopen(0);
+    testReopen(1000);
+    testThreads();
+    return 0;
+}
+
+// -----------------------------------------------------------------------
@@ -0,0 +1,1388 @@
+// -----------------------------------------------------------------------
+
+// mymap - tests/test_mymap.cpp
+//
+// mymap against std::map under seeded random
+// workloads, for every Stats and Balance policy
+// (seesaw, alpha weight balance and scapegoat):
+// after each stretch of changes the two must hold
+// the same keys and values in the same order. The
+// copies (structural, sorted bulk load) must match
+// the map they came from, shape included, and moves,
+// emplace and try_emplace must not copy a value. The
+// shape is read back from checkBalance(): every
+// node's counts must match its subtrees and meet the
+// Balance policy. Order statistics are checked
+// against ranks taken from std::map, bounds and
+// scans against its own lower and upper bounds.
+// Batches must end as the same puts or inserts one
+// at a time would. With mymap_stats the counters
+// must add up. Iterators must walk both ways like
+// std::map's. A custom Compare, stateful or
+// transparent, must order and find keys as it does
+// for std::map. Everything runs with eager erase and
+// again with lazy erase, which leaves tombstones.
+// The parallel walks, copy and clear must give what
+// their one-thread forms give, for any # of threads,
+// and the set operations what std::map gives. The
+// batched lookups must agree with get and contains.
+// A value copy that throws midway through a batch
+// or a set operation must leave a whole tree behind,
+// leaking nothing.
+
+// -----------------------------------------------------------------------
+
+#include <map>
+#include <vector>
+#include <string>
+#include <string_view>
+#include <sstream>
+#include <utility>
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+#include <memory>
+#include <type_traits>
+#include <cstdio>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <atomic>
+#include "mymap.h"
+#include "myrandom.h"
+#include "check.h"
+using namespace std;
+
+// -----------------------------------------------------------------------
+
+typedef map<int, int> intMap;
+typedef vector<pair<int, int>> pairVector;
+
+/* policyMap
+ * a mymap of int to int with the given policies
+*/
+template<typename Stats, typename Balance>
+using policyMap = mymap<int, int, less<int>,
+    allocator<pair<const int, int>>, Stats, Balance>;
+
+// -----------------------------------------------------------------------
+
+template<typename Map>
+static void checkSame(Map& m, const intMap& expected) {
+    CHECK(m.Size() == int(expected.size()));
+
+    auto it = expected.begin();
+    for (auto& kv : m) {
+        CHECK(it != expected.end());
+        CHECK(kv.first == it->first && kv.second == it->second);
+        ++it;
+    }
+    CHECK(it == expected.end());
+
+    CHECK(m.toVector() == pairVector(expected.begin(), expected.end()));
+}
+
+// -----------------------------------------------------------------------
+
+struct shapeNode {
+    int key;
+    int nL;
+    int nR;
+};
+
+/* subtreeSize
+ * rebuilds the subtree at nodes[pos] from the
+ * pre-order list, its keys in (lo, hi), and returns
+ * its size; clears ok when a node's counts do not
+ * match its subtrees or, if balanced, break Balance
+*/
+template<typename Balance>
+static int subtreeSize(const vector<shapeNode>& nodes, size_t& pos,
+    long long lo, long long hi, int depth, int& maxDepth, bool balanced,
+    bool& ok) {
+    if (pos == nodes.size() || nodes[pos].key <= lo || nodes[pos].key >= hi)
+        return 0;
+
+    shapeNode n = nodes[pos++];
+    maxDepth = max(maxDepth, depth);
+    int left = subtreeSize<Balance>(nodes, pos, lo, n.key, depth + 1,
+        maxDepth, balanced, ok);
+    int right = subtreeSize<Balance>(nodes, pos, n.key, hi, depth + 1,
+        maxDepth, balanced, ok);
+
+    ok = ok && left == n.nL && right == n.nR;
+    if (balanced && !Balance::depthTriggered)
+        ok = ok && !Balance::isUnbalanced(n.nL, n.nR);
+    return left + right + 1;
+}
+
+/* checkShape
+ * checks the tree behind m node by node and returns
+ * its depth (a lone root is 1). m must hold no
+ * tombstones, checkBalance() does not show them.
+ * balanced = false only checks the counts: lazy
+ * erase lowers them without rebalancing
+*/
+template<typename Balance, typename Map>
+static int checkShape(Map& m, bool balanced = true) {
+    vector<shapeNode> nodes;
+    stringstream lines(m.checkBalance());
+    string line;
+
+    while (getline(lines, line)) {
+        shapeNode n;
+        CHECK(sscanf(line.c_str(), "key: %d, nL: %d, nR: %d",
+            &n.key, &n.nL, &n.nR) == 3);
+        nodes.push_back(n);
+    }
+
+    size_t pos = 0;
+    int depth = 0;
+    bool ok = true;
+    int total = subtreeSize<Balance>(nodes, pos, -(1LL << 40), 1LL << 40, 1,
+        depth, balanced, ok);
+    CHECK(ok && pos == nodes.size() && total == m.Size());
+    return depth;
+}
+
+// -----------------------------------------------------------------------
+
+/* checkOrder
+ * select, rank, countRange and percentile at the
+ * ends and at random spots
+*/
+template<typename Map>
+static void checkOrder(Map& m, const intMap& expected, xoshiro256& gen) {
+    vector<int> keys;
+    for (auto& kv : expected)
+        keys.push_back(kv.first);
+    int n = int(keys.size());
+
+    for (int i = 0; i < 200 && n > 0; i++) {
+        int k = (i == 0) ? 0 : (i == 1) ? n - 1 : int(gen.below(n));
+        pair<int, int> kv = m.select(k);
+        CHECK(kv.first == keys[k] && kv.second == expected.at(keys[k]));
+        CHECK(m.rank(keys[k]) == k);
+    }
+
+    for (int i = 0; i < 200; i++) {
+        int lo = int(gen.below(5200)) - 100;
+        int hi = int(gen.below(5200)) - 100;
+        int smaller = int(lower_bound(keys.begin(), keys.end(), lo)
+            - keys.begin());
+        int notAbove = int(upper_bound(keys.begin(), keys.end(), hi)
+            - keys.begin());
+        CHECK(m.rank(lo) == smaller);
+        CHECK(m.countRange(lo, hi) == max(notAbove - smaller, 0));
+    }
+
+    bool threw = false;
+    try {
+        m.select(n);
+    } catch (const out_of_range&) {
+        threw = true;
+    }
+    CHECK(threw);
+
+    if (n == 0)
+        return;
+    double ps[] = {-1.0, 0.0, 0.001, 0.25, 0.5, 0.999, 1.0, 2.0};
+    for (double p : ps) {
+        double clamped = min(max(p, 0.0), 1.0);
+        int k = max(int(ceil(clamped * n)) - 1, 0);
+        CHECK(m.percentile(p).first == keys[k]);
+    }
+}
+
+// -----------------------------------------------------------------------
+
+/* checkBounds
+ * find, lower_bound, upper_bound, equal_range and
+ * scan around random keys, present or not
+*/
+template<typename Map>
+static void checkBounds(Map& m, const intMap& expected, xoshiro256& gen) {
+    for (int i = 0; i < 200; i++) {
+        int key = int(gen.below(5200)) - 100;
+
+        auto lower = expected.lower_bound(key);
+        auto mLower = m.lower_bound(key);
+        CHECK((lower == expected.end()) == (mLower == m.end()));
+        if (lower != expected.end())
+            CHECK(mLower->first == lower->first);
+
+        auto upper = expected.upper_bound(key);
+        auto mUpper = m.upper_bound(key);
+        CHECK((upper == expected.end()) == (mUpper == m.end()));
+        if (upper != expected.end())
+            CHECK(mUpper->first == upper->first);
+
+        auto range = m.equal_range(key);
+        CHECK(range.first == mLower && range.second == mUpper);
+
+        auto found = m.find(key);
+        CHECK((found != m.end()) == (expected.count(key) == 1));
+        if (found != m.end())
+            CHECK(found == mLower && found->second == expected.at(key));
+
+        // every key in [key, hi], in order
+        int hi = key + int(gen.below(300)) - 20;
+        pairVector seen;
+        m.scan(key, hi, [&seen](const int& k, int& v) {
+            seen.push_back(make_pair(k, v));
+        });
+        pairVector inRange;
+        if (hi >= key)
+            inRange.assign(lower, expected.upper_bound(hi));
+        CHECK(seen == inRange);
+    }
+}
+
+// -----------------------------------------------------------------------
+
+/* checkMany
+ * getMany and containsMany for groups of random
+ * keys, present or not, of sizes around the group
+ * the lookups run in
+*/
+template<typename Map>
+static void checkMany(Map& m, const intMap& expected, xoshiro256& gen) {
+    int sizes[] = {0, 1, 2, 31, 32, 33, 200};
+
+    for (int size : sizes) {
+        vector<int> keys;
+        for (int i = 0; i < size; i++)
+            keys.push_back(int(gen.below(5200)) - 100);
+
+        vector<int> values;
+        m.getMany(keys.begin(), keys.end(), back_inserter(values));
+        vector<int> found;
+        m.containsMany(keys, back_inserter(found));
+        CHECK(int(values.size()) == size && int(found.size()) == size);
+
+        for (int i = 0; i < size; i++) {
+            auto it = expected.find(keys[i]);
+            CHECK(found[i] == (it != expected.end()));
+            CHECK(values[i] == (it != expected.end() ? it->second : 0));
+        }
+
+        // out comes back one past the last value written
+        vector<int> slots(size_t(size) + 1, -7);
+        auto end = m.getMany(keys, slots.begin());
+        CHECK(end == slots.begin() + size && slots.back() == -7);
+    }
+}
+
+// -----------------------------------------------------------------------
+
+/* checkCounters
+ * the histograms of mymap_stats add up to their
+ * counters; mymap_no_stats has nothing to check
+*/
+static void checkCounters(const mymap_no_stats&) {}
+
+static void checkCounters(const mymap_stats& s) {
+    long long rebuilds = 0;
+    long long descents = 0;
+    for (int i = 0; i < mymap_stats::histogramSize; i++) {
+        rebuilds += s.rebuildSizeLog2[i];
+        descents += s.depths[i];
+    }
+    CHECK(rebuilds == s.rebalances && descents == s.searches);
+    CHECK(s.rebuiltNodes >= s.rebalances);
+}
+
+// -----------------------------------------------------------------------
+
+/* checkIterators
+ * walks m backwards, by reverse iterators and by
+ * const iterators, and steps around random spots
+*/
+template<typename Map>
+static void checkIterators(Map& m, const intMap& expected,
+    xoshiro256& gen) {
+    typedef typename Map::const_iterator constIter;
+    const Map& c = m;
+
+    auto rit = expected.rbegin();
+    for (auto mit = m.rbegin(); mit != m.rend(); ++mit, ++rit) {
+        CHECK(rit != expected.rend());
+        CHECK(mit->first == rit->first && mit->second == rit->second);
+    }
+    CHECK(rit == expected.rend());
+
+    auto it = expected.end();
+    for (constIter cit = c.end(); cit != c.begin(); ) {
+        --cit;
+        --it;
+        CHECK(cit->first == it->first && (*cit).second == it->second);
+    }
+    CHECK(it == expected.begin());
+    CHECK(distance(c.cbegin(), c.cend()) == distance(expected.begin(),
+        expected.end()));
+
+    if (expected.empty()) {
+        CHECK(m.begin() == m.end() && m.rbegin() == m.rend());
+        return;
+    }
+
+    // ++ and -- from random keys, and the post forms
+    for (int i = 0; i < 100; i++) {
+        auto eit = expected.lower_bound(int(gen.below(5000)));
+        if (eit == expected.end())
+            eit = expected.begin();
+        auto mit = m.find(eit->first);
+        constIter cit = mit;
+        CHECK(cit == mit && cit->first == eit->first);
+
+        auto old = mit++;
+        CHECK(old->first == eit->first);
+        if (next(eit) == expected.end())
+            CHECK(mit == m.end());
+        else
+            CHECK(mit->first == next(eit)->first);
+
+        old = mit--;
+        CHECK(mit->first == eit->first && prev(old) == mit);
+        if (eit != expected.begin())
+            CHECK(prev(mit)->first == prev(eit)->first);
+    }
+    CHECK(prev(m.end())->first == expected.rbegin()->first);
+}
+
+// -----------------------------------------------------------------------
+
+/* checkAll
+ * every check that compares m with expected; with
+ * lazy erase the shape is read from a compacted copy
+*/
+template<typename Balance, typename Map>
+static void checkAll(Map& m, const intMap& expected, xoshiro256& gen,
+    bool lazy) {
+    checkSame(m, expected);
+    if (lazy) {
+        Map compacted(m);
+        compacted.compact();
+        checkShape<Balance>(compacted, false);
+    } else {
+        checkShape<Balance>(m);
+    }
+    checkOrder(m, expected, gen);
+    checkBounds(m, expected, gen);
+    checkIterators(m, expected, gen);
+    checkMany(m, expected, gen);
+    checkCounters(m.stats());
+}
+
+// -----------------------------------------------------------------------
+
+/* testRandom
+ * random puts and erases over a small key range, so
+ * keys are added, overwritten, erased and put back,
+ * checked along the way
+*/
+template<typename Balance, typename Map>
+static void testRandom(uint64_t seedValue, bool lazy) {
+    Map m;
+    intMap expected;
+    xoshiro256 gen(seedValue);
+    m.setLazyErase(lazy);
+
+    for (int i = 0; i < 40000; i++) {
+        int key = int(gen.below(5000));
+        bool isNew = expected.count(key) == 0;
+
+        switch (gen.below(7)) {
+        case 0:
+            m.put(key, i);
+            expected[key] = i;
+            break;
+        case 1:
+            m[key] += i;
+            expected[key] += i;
+            break;
+        case 2: {
+            auto r = m.try_emplace(key, i);
+            CHECK(r.second == isNew && r.first->first == key);
+            expected.emplace(key, i);
+            CHECK(r.first->second == expected[key]);
+            break;
+        }
+        case 3: {
+            auto r = m.emplace(key, i);
+            CHECK(r.second == isNew && r.first->first == key);
+            expected.emplace(key, i);
+            break;
+        }
+        case 4:  // scan may change the values it visits
+            m.scan(key, key + 20, [](const int&, int& v) { v++; });
+            for (auto it = expected.lower_bound(key);
+                it != expected.end() && it->first <= key + 20; ++it)
+                it->second++;
+            break;
+        case 5:
+            CHECK(m.erase(key) == int(expected.erase(key)));
+            break;
+        default: {  // erase at an iterator, which returns the next one
+            auto it = expected.lower_bound(key);
+            if (it == expected.end())
+                break;
+            auto next = m.erase(m.find(it->first));
+            it = expected.erase(it);
+            CHECK((next == m.end()) == (it == expected.end()));
+            if (it != expected.end())
+                CHECK(next->first == it->first);
+            break;
+        }
+        }
+
+        if (i % 4000 == 0)
+            checkAll<Balance>(m, expected, gen, lazy);
+    }
+    checkAll<Balance>(m, expected, gen, lazy);
+
+    m.compact();
+    checkAll<Balance>(m, expected, gen, lazy);
+}
+
+// -----------------------------------------------------------------------
+
+template<typename Balance, typename Map>
+static void testCopy(uint64_t seedValue, bool lazy) {
+    Map m;
+    intMap expected;
+    xoshiro256 gen(seedValue);
+    m.setLazyErase(lazy);
+
+    for (int i = 0; i < 20000; i++) {
+        int key = int(gen.below(50000));
+        m.put(key, -i);
+        expected[key] = -i;
+    }
+    for (int i = 0; i < 5000; i++) {
+        int key = int(gen.below(50000));
+        CHECK(m.erase(key) == int(expected.erase(key)));
+    }
+
+    // a copy clones the shape, tombstones included, not just the keys
+    Map copy(m);
+    checkSame(copy, expected);
+    CHECK(copy.checkBalance() == m.checkBalance());
+
+    Map assigned;
+    assigned.put(-1, -1);
+    assigned = m;
+    checkSame(assigned, expected);
+    CHECK(assigned.checkBalance() == m.checkBalance());
+    assigned = assigned;
+    checkSame(assigned, expected);
+
+    // the copies are independent of m
+    copy.put(-5, 5);
+    m.put(-6, 6);
+    CHECK(copy.contains(-5) && !copy.contains(-6));
+    CHECK(!assigned.contains(-5) && !assigned.contains(-6));
+    m.clear();
+    checkSame(m, intMap());
+    checkSame(assigned, expected);
+
+    // a sorted bulk load gives the keys of the range, perfectly balanced
+    Map loaded;
+    loaded.put(7, 7);
+    loaded.assignSorted(expected.begin(), expected.end());
+    checkSame(loaded, expected);
+    int n = loaded.Size();
+    CHECK(checkShape<mymap_seesaw_balance>(loaded) == int(log2(n)) + 1);
+
+    pairVector all = assigned.toVector();
+    Map fromVector;
+    fromVector.assignSorted(all.begin(), all.end());
+    CHECK(fromVector.checkBalance() == loaded.checkBalance());
+
+    loaded.assignSorted(all.end(), all.end());
+    checkSame(loaded, intMap());
+
+    bool threw = false;
+    try {
+        loaded.percentile(0.5);
+    } catch (const out_of_range&) {
+        threw = true;
+    }
+    CHECK(threw);
+}
+
+// -----------------------------------------------------------------------
+
+/* testShape
+ * ascending, descending and random puts, the first
+ * two of which keep rebuilding the same side of the
+ * tree; the depth stays within log base 1 / alpha
+*/
+template<typename Balance, typename Map>
+static void testShape(double alpha) {
+    for (int order = 0; order < 3; order++) {
+        Map m;
+        xoshiro256 gen(uint64_t(order) + 10);
+        for (int i = 0; i < 20000; i++) {
+            int key = (order == 0) ? i : (order == 1) ? -i
+                : int(gen.below(1000000));
+            m.put(key, i);
+
+            if (i % 2000 == 1999 || i < 100) {
+                int depth = checkShape<Balance>(m);
+                double bound = log(double(m.Size()) + 1) / log(1 / alpha);
+                CHECK(depth <= int(bound) + 2);
+            }
+        }
+    }
+}
+
+// -----------------------------------------------------------------------
+
+/* testBatch
+ * putBatch and insert of unsorted batches with
+ * repeated keys, small ones (put one at a time) and
+ * large ones (merged and rebuilt), and of sorted ones
+*/
+template<typename Balance, typename Map>
+static void testBatch(uint64_t seedValue, bool lazy) {
+    Map m;
+    intMap expected;
+    xoshiro256 gen(seedValue);
+    int sizes[] = {0, 1, 3, 40, 700, 5000, 20000, 2};
+    m.setLazyErase(lazy);
+
+    for (int round = 0; round < 16; round++) {
+        int size = sizes[round % 8];
+        int range = (round < 8) ? 30000 : 3000;
+        pairVector batch;
+        for (int i = 0; i < size; i++) {
+            int key = int(gen.below(range));
+            batch.push_back(make_pair(key, round * 100000 + i));
+        }
+
+        if (round % 2 == 0) {  // later repeats win, as with put
+            m.putBatch(batch.begin(), batch.end());
+            for (auto& kv : batch)
+                expected[kv.first] = kv.second;
+        } else {  // keys in mymap and earlier repeats win
+            m.insert(batch.begin(), batch.end());
+            for (auto& kv : batch)
+                expected.insert(kv);
+        }
+        checkSame(m, expected);
+        if (!lazy)
+            checkShape<Balance>(m);
+
+        // the next batch may put some of them back
+        for (int i = 0; i < size / 4; i++) {
+            int key = int(gen.below(range));
+            CHECK(m.erase(key) == int(expected.erase(key)));
+        }
+    }
+
+    // an already sorted, repeat free batch skips the sort
+    intMap sorted;
+    for (int i = 0; i < 10000; i++)
+        sorted[int(gen.below(60000))] = -i;
+    pairVector batch(sorted.begin(), sorted.end());
+    m.putBatch(batch.begin(), batch.end(), true);
+    for (auto& kv : batch)
+        expected[kv.first] = kv.second;
+    checkSame(m, expected);
+    m.compact();
+    checkShape<Balance>(m, !lazy);
+
+    Map empty;
+    empty.insert(batch.begin(), batch.end(), true);
+    checkSame(empty, sorted);
+    checkShape<Balance>(empty);
+}
+
+// -----------------------------------------------------------------------
+
+/* testErase
+ * erasing from both ends keeps rebuilding the same
+ * sides; lazy erase leaves tombstones that are put
+ * back, compacted, or erased again in eager mode
+*/
+template<typename Balance, typename Map>
+static void testErase() {
+    const int n = 10000;
+    xoshiro256 gen(15);
+
+    Map m;
+    intMap expected;
+    for (int key = 0; key < n; key++) {
+        m.put(key, key);
+        expected[key] = key;
+    }
+    for (int i = 0; i < n / 2; i++) {
+        CHECK(m.erase(i) == 1 && m.erase(n - 1 - i) == 1);
+        expected.erase(i);
+        expected.erase(n - 1 - i);
+        if (i % 500 == 0) {
+            checkSame(m, expected);
+            checkShape<Balance>(m);
+        }
+    }
+    CHECK(m.Size() == 0 && m.begin() == m.end() && m.erase(0) == 0);
+
+    Map lazy;
+    lazy.setLazyErase(true);
+    for (int key = 0; key < n; key++) {
+        lazy.put(key, key);
+        expected[key] = key;
+    }
+    for (int i = 0; i < 300; i++) {
+        int key = int(gen.below(n));
+        CHECK(lazy.erase(key) == int(expected.erase(key)));
+        CHECK(!lazy.contains(key) && lazy.get(key) == 0);
+        CHECK(lazy.find(key) == lazy.end() && lazy.getPtr(key) == nullptr);
+    }
+    checkSame(lazy, expected);
+    checkOrder(lazy, expected, gen);
+    checkBounds(lazy, expected, gen);
+    checkIterators(lazy, expected, gen);
+    checkMany(lazy, expected, gen);
+
+    // erased keys come back with their new values
+    for (int key = 0; key < n; key += 7) {
+        lazy.put(key, -key);
+        expected[key] = -key;
+    }
+    checkSame(lazy, expected);
+
+    Map copy(lazy);
+    intMap copyExpected(expected);
+    lazy.compact();
+    checkSame(lazy, expected);
+    checkShape<Balance>(lazy);
+    checkSame(copy, copyExpected);
+
+    // eager erase around the tombstones left in the copy
+    copy.setLazyErase(false);
+    for (int i = 0; i < 3000; i++) {
+        int key = int(gen.below(n));
+        CHECK(copy.erase(key) == int(copyExpected.erase(key)));
+    }
+    checkSame(copy, copyExpected);
+    copy.compact();
+    checkShape<Balance>(copy, false);
+
+    // erasing most keys lazily compacts as it goes
+    for (int key = 0; key < n; key++) {
+        if (key % 10 != 0) {
+            lazy.erase(key);
+            expected.erase(key);
+        }
+    }
+    checkSame(lazy, expected);
+    Map compacted(lazy);
+    compacted.compact();
+    checkShape<Balance>(compacted, false);
+}
+
+// -----------------------------------------------------------------------
+
+/* testParallel
+ * parallelForEach, parallelToVector, parallelCopy
+ * and parallelClear on 1 to 8 threads and on the
+ * default (one per core)
+*/
+template<typename Map>
+static void testParallel(bool lazy) {
+    Map m;
+    intMap expected;
+    xoshiro256 gen(17);
+    m.setLazyErase(lazy);
+
+    for (int i = 0; i < 30000; i++) {
+        int key = int(gen.below(40000));
+        m.put(key, i);
+        expected[key] = i;
+    }
+    for (int i = 0; i < 10000; i++) {
+        int key = int(gen.below(40000));
+        CHECK(m.erase(key) == int(expected.erase(key)));
+    }
+
+    long long keySum = 0;
+    for (auto& kv : expected)
+        keySum += kv.first;
+
+    int threadCounts[] = {1, 2, 3, 8, 0};
+    for (int threads : threadCounts) {
+        // every live key exactly once, values changed in place
+        atomic<long long> sum(0);
+        atomic<int> visits(0);
+        m.parallelForEach([&sum, &visits](const int& k, int& v) {
+            sum.fetch_add(k);
+            visits.fetch_add(1);
+            v++;
+        }, threads);
+        CHECK(sum.load() == keySum && visits.load() == m.Size());
+        for (auto& kv : expected)
+            kv.second++;
+        checkSame(m, expected);
+
+        CHECK(m.parallelToVector(threads) == m.toVector());
+
+        Map copy;
+        copy.put(-1, -1);
+        copy.parallelCopy(m, threads);
+        checkSame(copy, expected);
+        CHECK(copy.checkBalance() == m.checkBalance());
+        copy.put(-2, 2);
+        CHECK(!m.contains(-2));
+
+        copy.parallelClear(threads);
+        checkSame(copy, intMap());
+        copy.put(3, 3);
+        CHECK(copy.Size() == 1 && copy.get(3) == 3);
+    }
+
+    m.parallelCopy(m);
+    checkSame(m, expected);
+
+    Map empty;
+    Map copy(m);
+    copy.parallelCopy(empty, 4);
+    checkSame(copy, intMap());
+    CHECK(empty.parallelToVector(4).empty());
+    empty.parallelForEach([](const int&, int&) { CHECK(false); }, 4);
+    empty.parallelClear(4);
+}
+
+// -----------------------------------------------------------------------
+
+/* fillRandom
+ * puts about n keys from [0, range) in m and in
+ * expected, then erases some, which leaves
+ * tombstones in a lazy map
+*/
+template<typename Map>
+static void fillRandom(Map& m, intMap& expected, int n, int range,
+    xoshiro256& gen) {
+    for (int i = 0; i < n; i++) {
+        int key = int(gen.below(range));
+        int value = int(gen.below(1000000));
+        m.put(key, value);
+        expected[key] = value;
+    }
+    for (int i = 0; i < n / 4; i++) {
+        int key = int(gen.below(range));
+        m.erase(key);
+        expected.erase(key);
+    }
+}
+
+/* testSetOps
+ * mergeFrom, intersectWith and differenceWith for
+ * maps of alike and of very different sizes, so the
+ * one-key-at-a-time path is taken too
+*/
+template<typename Balance, typename Map>
+static void testSetOps(bool lazy) {
+    xoshiro256 gen(20);
+    int sizes[][2] = {{5000, 5000}, {20000, 30}, {30, 20000}, {0, 3000},
+        {3000, 0}};
+
+    for (auto& size : sizes) {
+        Map ours;
+        Map theirs;
+        intMap a;
+        intMap b;
+        ours.setLazyErase(lazy);
+        theirs.setLazyErase(lazy);
+        fillRandom(ours, a, size[0], 30000, gen);
+        fillRandom(theirs, b, size[1], 30000, gen);
+
+        intMap keepOurs(a);
+        intMap takeTheirs(a);
+        intMap summed(a);
+        intMap both;
+        intMap bothTheirs;
+        intMap difference(a);
+        for (auto& kv : b) {
+            keepOurs.insert(kv);
+            takeTheirs[kv.first] = kv.second;
+            summed[kv.first] += kv.second;
+            difference.erase(kv.first);
+            if (a.count(kv.first) == 1) {
+                both[kv.first] = a[kv.first];
+                bothTheirs[kv.first] = kv.second;
+            }
+        }
+
+        Map m(ours);
+        m.mergeFrom(theirs);
+        checkSame(m, keepOurs);
+        checkSame(theirs, b);
+
+        m = ours;
+        m.mergeFrom(theirs, TAKE_THEIRS);
+        checkSame(m, takeTheirs);
+
+        m = ours;
+        m.mergeFrom(theirs, [](const int&, int& mine, const int& other) {
+            mine += other;
+        });
+        checkSame(m, summed);
+
+        // the moving merge takes theirs' nodes and empties it
+        m = ours;
+        Map moved(theirs);
+        m.mergeFrom(std::move(moved), TAKE_THEIRS);
+        checkSame(m, takeTheirs);
+        checkSame(moved, intMap());
+        if (!lazy)
+            checkShape<Balance>(m);
+        m.put(-1, -1);
+        moved.put(-2, -2);
+        CHECK(m.contains(-1) && !m.contains(-2) && moved.Size() == 1);
+
+        m = ours;
+        m.intersectWith(theirs);
+        checkSame(m, both);
+        checkShape<Balance>(m);
+
+        m = ours;
+        m.intersectWith(theirs, TAKE_THEIRS);
+        checkSame(m, bothTheirs);
+
+        m = ours;
+        m.differenceWith(theirs);
+        checkSame(m, difference);
+        checkShape<Balance>(m);
+    }
+
+    // with itself: union and intersection change nothing
+    Map m;
+    intMap expected;
+    fillRandom(m, expected, 3000, 10000, gen);
+    m.mergeFrom(m, TAKE_THEIRS);
+    m.intersectWith(m);
+    checkSame(m, expected);
+    m.differenceWith(m);
+    checkSame(m, intMap());
+}
+
+// -----------------------------------------------------------------------
+
+/* fragile
+ * a value whose copies throw once copiesLeft runs
+ * out (-1: never), and that counts its live objects;
+ * it has no move, so every move is a copy
+*/
+struct fragile {
+    static long live;
+    static long copiesLeft;
+    int v;
+
+    fragile(int value = 0) : v(value) { live++; }
+    fragile(const fragile& other) : v(other.v) {
+        copied();
+        live++;
+    }
+    fragile& operator=(const fragile& other) {
+        copied();
+        v = other.v;
+        return *this;
+    }
+    ~fragile() { live--; }
+
+    static void copied() {
+        if (copiesLeft == 0)
+            throw runtime_error("fragile: copy failed");
+        if (copiesLeft > 0)
+            copiesLeft--;
+    }
+};
+
+long fragile::live = 0;
+long fragile::copiesLeft = -1;
+
+typedef mymap<int, fragile> fragileMap;
+
+/* checkFragile
+ * m is a whole tree holding the keys of before, each
+ * with its old value or the batch's (-key); the
+ * shape is read from a compacted copy, as with lazy
+ * erase m may hold tombstones
+*/
+static void checkFragile(fragileMap& m, const intMap& before) {
+    CHECK(m.Size() == int(before.size()));
+
+    auto it = before.begin();
+    for (auto& kv : m) {
+        CHECK(it != before.end() && kv.first == it->first);
+        CHECK(kv.second.v == it->second || kv.second.v == -it->first);
+        ++it;
+    }
+    CHECK(it == before.end());
+
+    fragileMap compacted(m);
+    compacted.compact();
+    checkShape<mymap_seesaw_balance>(compacted, false);
+}
+
+// -----------------------------------------------------------------------
+
+/* testThrowingBatch
+ * putBatch and insert whose value copies start
+ * throwing at points all through the merge
+*/
+static void testThrowingBatch() {
+    const int n = 3000;
+    long failAfter[] = {0, 1, 2, 100, 701, 1498, 1499};
+
+    for (int lazy = 0; lazy < 2; lazy++) {
+        for (long after : failAfter) {
+            {
+                fragileMap m;
+                intMap before;
+                m.setLazyErase(lazy == 1);
+                for (int key = 0; key < 2 * n; key += 2) {
+                    m.put(key, fragile(key));
+                    before[key] = key;
+                }
+                for (int key = 0; key < 2 * n; key += 10) {
+                    m.erase(key);
+                    before.erase(key);
+                }
+
+                // half the keys are in m, sorted so the only copies
+                // are the batch's own and the merge's
+                vector<pair<int, fragile>> batch;
+                for (int key = n; key < 2 * n; key++)
+                    batch.push_back(make_pair(key, fragile(-key)));
+
+                fragile::copiesLeft = long(batch.size()) + after;
+                bool threw = false;
+                try {
+                    if (after % 2 == 0)
+                        m.putBatch(batch.begin(), batch.end(), true);
+                    else
+                        m.insert(batch.begin(), batch.end(), true);
+                } catch (const runtime_error&) {
+                    threw = true;
+                }
+                fragile::copiesLeft = -1;
+                CHECK(threw);
+                checkFragile(m, before);
+
+                m.put(-1, fragile(1));
+                CHECK(m.Size() == int(before.size()) + 1);
+            }
+            CHECK(fragile::live == 0);
+        }
+    }
+}
+
+// -----------------------------------------------------------------------
+
+/* testThrowingSetOps
+ * mergeFrom and intersectWith whose value copies
+ * start throwing partway through the merge
+*/
+static void testThrowingSetOps() {
+    const int n = 3000;
+    long failAfter[] = {0, 1, 2, 100, 701, 1100};
+
+    for (int lazy = 0; lazy < 2; lazy++) {
+        for (long after : failAfter) {
+            for (int op = 0; op < 4; op++) {
+                fragileMap m;
+                fragileMap other;
+                intMap before;
+                intMap otherBefore;
+                m.setLazyErase(lazy == 1);
+                other.setLazyErase(lazy == 1);
+                for (int key = 0; key < 2 * n; key += 2) {
+                    m.put(key, fragile(key));
+                    before[key] = key;
+                }
+                for (int key = n; key < 3 * n; key++) {
+                    other.put(key, fragile(-key));
+                    otherBefore[key] = -key;
+                }
+                for (int key = 0; key < 3 * n; key += 10) {
+                    m.erase(key);
+                    before.erase(key);
+                    other.erase(key + 5);
+                    otherBefore.erase(key + 5);
+                }
+
+                fragile::copiesLeft = after;
+                bool threw = false;
+                try {
+                    if (op == 0)
+                        m.mergeFrom(other);
+                    else if (op == 1)
+                        m.mergeFrom(other, TAKE_THEIRS);
+                    else if (op == 2)
+                        m.intersectWith(other, TAKE_THEIRS);
+                    else
+                        m.mergeFrom(std::move(other), TAKE_THEIRS);
+                } catch (const runtime_error&) {
+                    threw = true;
+                }
+                fragile::copiesLeft = -1;
+                CHECK(threw);
+                checkFragile(m, before);
+                if (op < 3)
+                    checkFragile(other, otherBefore);
+                else
+                    CHECK(other.Size() == 0 && other.begin() == other.end());
+
+                m.put(-1, fragile(1));
+                CHECK(m.Size() == int(before.size()) + 1);
+            }
+            CHECK(fragile::live == 0);
+        }
+    }
+}
+
+// -----------------------------------------------------------------------
+
+/* testIterators
+ * values changed through iterators, and std::
+ * algorithms over mymap
+*/
+template<typename Map>
+static void testIterators() {
+    Map m;
+    intMap expected;
+    for (int key = 0; key < 3000; key += 3) {
+        m.put(key, key);
+        expected[key] = key;
+    }
+
+    for (auto& kv : m)
+        kv.second *= 2;
+    for (auto it = m.rbegin(); it != m.rend(); ++it)
+        it->second += 1;
+    for (auto& kv : expected)
+        kv.second = kv.second * 2 + 1;
+    checkSame(m, expected);
+
+    auto found = find_if(m.begin(), m.end(),
+        [](const pair<const int, int>& kv) { return kv.first > 1000; });
+    CHECK(found != m.end() && found->first == 1002);
+    CHECK(count_if(m.begin(), m.end(),
+        [](const pair<const int, int>& kv) { return kv.second % 4 == 1; })
+        == 500);
+
+    pairVector backwards(m.rbegin(), m.rend());
+    CHECK(backwards == pairVector(expected.rbegin(), expected.rend()));
+
+    Map empty;
+    CHECK(empty.begin() == empty.end() && empty.rbegin() == empty.rend());
+}
+
+// -----------------------------------------------------------------------
+
+template<typename Map>
+static void testMove(uint64_t seedValue) {
+    Map m;
+    intMap expected;
+    xoshiro256 gen(seedValue);
+
+    for (int i = 0; i < 5000; i++) {
+        int key = int(gen.below(20000));
+        m.put(key, i);
+        expected[key] = i;
+    }
+    string shape = m.checkBalance();
+
+    // the nodes move over as they are, the source is left empty
+    Map moved(std::move(m));
+    checkSame(moved, expected);
+    CHECK(moved.checkBalance() == shape);
+    checkSame(m, intMap());
+    m.put(1, 1);
+    CHECK(m.Size() == 1 && m.get(1) == 1);
+
+    Map assigned;
+    assigned.put(-1, -1);
+    assigned = std::move(moved);
+    checkSame(assigned, expected);
+    checkSame(moved, intMap());
+
+    m.swap(assigned);
+    checkSame(m, expected);
+    CHECK(assigned.Size() == 1 && assigned.contains(1));
+}
+
+// -----------------------------------------------------------------------
+
+static void testStats() {
+    typedef policyMap<mymap_stats, mymap_seesaw_balance> statsMap;
+    static_assert(is_empty<mymap_no_stats>::value,
+        "mymap_no_stats must cost no space");
+    CHECK(sizeof(mymap<int, int>) < sizeof(statsMap));
+
+    statsMap m;
+    const int n = 4096;
+    for (int key = 0; key < n; key++)
+        m.put(key, key);
+
+    // one descent per put (the first, into an empty tree, visits no
+    // node), one node per new key, and ascending keys keep rebuilding
+    // the right spine
+    const mymap_stats& s = m.stats();
+    CHECK(s.nodesAllocated == n && s.searches == n);
+    CHECK(s.rebalances > 0 && s.comparisons > n);
+    CHECK(s.comparisonsPerSearch() > 1.0);
+    checkCounters(s);
+
+    for (int key = 0; key < n; key++)
+        m.put(key, -key);
+    CHECK(s.nodesAllocated == n && s.searches == 2 * n);
+
+    for (int key = 0; key < 100; key++)
+        CHECK(m.contains(key * 3));
+    CHECK(s.searches == 2 * n + 100);
+
+    // every descent landed within the balanced depth
+    int deepest = 0;
+    for (int d = 0; d < mymap_stats::histogramSize; d++) {
+        if (s.depths[d] > 0)
+            deepest = d;
+    }
+    CHECK(deepest > 0 && deepest <= int(log(n + 1.0) / log(1.5)) + 2);
+
+    string json = s.toJSON();
+    CHECK(json.find("{\"nodesAllocated\": 4096, ") == 0);
+    CHECK(json.find("\"depths\": [1, ") != string::npos);
+
+    m.resetStats();
+    CHECK(s.nodesAllocated == 0 && s.searches == 0 && s.comparisons == 0);
+    CHECK(s.toJSON().find("\"depths\": []}") != string::npos);
+    CHECK(m.Size() == n);
+}
+
+// -----------------------------------------------------------------------
+
+/* testBalanceCosts
+ * what sets the policies apart: a larger alpha
+ * rebuilds fewer nodes, and scapegoat erases
+ * rebuild nothing
+*/
+static void testBalanceCosts() {
+    typedef policyMap<mymap_stats, mymap_seesaw_balance> seesawMap;
+    typedef policyMap<mymap_stats, mymap_alpha_balance<4, 5>> alphaMap;
+    typedef policyMap<mymap_stats, mymap_scapegoat_balance<>> scapegoatMap;
+    seesawMap seesaw;
+    alphaMap alpha;
+    scapegoatMap scapegoat;
+    policyMap<mymap_stats, mymap_alpha_balance<2, 3>> twoThirds;
+
+    for (int key = 0; key < 20000; key++) {
+        seesaw.put(key, key);
+        alpha.put(key, key);
+        scapegoat.put(key, key);
+        twoThirds.put(key, key);
+    }
+    CHECK(alpha.stats().rebuiltNodes < seesaw.stats().rebuiltNodes);
+    CHECK(scapegoat.stats().rebuiltNodes < seesaw.stats().rebuiltNodes);
+
+    // seesaw is alpha = 2/3 written out
+    CHECK(twoThirds.checkBalance() == seesaw.checkBalance());
+    CHECK(twoThirds.stats().rebuiltNodes == seesaw.stats().rebuiltNodes);
+
+    long long before = scapegoat.stats().rebalances;
+    for (int key = 0; key < 20000; key += 2)
+        scapegoat.erase(key);
+    CHECK(scapegoat.stats().rebalances == before);
+    CHECK(scapegoat.Size() == 10000 && scapegoat.begin()->first == 1);
+}
+
+// -----------------------------------------------------------------------
+
+/* byDirection
+ * a stateful Compare: ascending or descending as
+ * chosen at construction
+*/
+struct byDirection {
+    bool descending;
+
+    explicit byDirection(bool down = false) : descending(down) {}
+
+    bool operator()(int a, int b) const {
+        return descending ? b < a : a < b;
+    }
+};
+
+/* noCase
+ * orders strings ignoring case, so "Key" and "key"
+ * are the same key
+*/
+struct noCase {
+    bool operator()(const string& a, const string& b) const {
+        return lexicographical_compare(a.begin(), a.end(), b.begin(),
+            b.end(), [](char x, char y) {
+                return tolower((unsigned char)x) < tolower((unsigned char)y);
+            });
+    }
+};
+
+static void testCompare() {
+    typedef mymap<int, int, byDirection> directedMap;
+    typedef map<int, int, byDirection> directedExpected;
+    directedMap m(byDirection(true));
+    directedExpected expected(byDirection(true));
+    xoshiro256 gen(14);
+
+    for (int i = 0; i < 20000; i++) {
+        int key = int(gen.below(3000));
+        if (gen.below(4) == 0) {
+            CHECK(m.erase(key) == int(expected.erase(key)));
+        } else {
+            m.put(key, i);
+            expected[key] = i;
+        }
+    }
+    CHECK(m.key_comp().descending && m.Size() == int(expected.size()));
+    CHECK(m.toVector() == pairVector(expected.begin(), expected.end()));
+
+    // bounds, ranks and ranges follow Compare's order
+    for (int i = 0; i < 500; i++) {
+        int key = int(gen.below(3200)) - 100;
+        auto lower = expected.lower_bound(key);
+        auto mLower = m.lower_bound(key);
+        CHECK((lower == expected.end()) == (mLower == m.end()));
+        if (lower != expected.end())
+            CHECK(mLower->first == lower->first);
+        CHECK(m.rank(key) == int(distance(expected.begin(), lower)));
+        CHECK(m.contains(key) == (expected.count(key) == 1));
+    }
+    CHECK(m.select(0).first == expected.begin()->first);
+    CHECK(m.countRange(2000, 1000) == int(distance(
+        expected.lower_bound(2000), expected.upper_bound(1000))));
+    CHECK(m.countRange(1000, 2000) == 0);
+
+    directedMap copy(m);
+    CHECK(copy.key_comp().descending);
+    copy.put(-1, -1);
+    CHECK(prev(copy.end())->first == -1);
+
+    // keys equal under Compare are one key
+    mymap<string, int, noCase> names;
+    names.put("Apple", 1);
+    names.put("APPLE", 2);
+    names.put("banana", 3);
+    names.put("apricot", 4);
+    CHECK(names.Size() == 3 && names.get("apple") == 2);
+    CHECK(names.begin()->first == "Apple");
+    CHECK(names.find("BANANA") != names.end() && !names.contains("cherry"));
+    CHECK(names.rank("B") == 2 && names.erase("APRICOT") == 1);
+
+    // a transparent Compare finds keys without building a string
+    mymap<string, int, less<>> words;
+    for (int i = 0; i < 1000; i++)
+        words.put("w" + to_string(i), i);
+    string_view probe("w123");
+    CHECK(words.contains(probe) && words.get(probe) == 123);
+    CHECK(words.find("w999")->second == 999 && !words.contains("w1000"));
+    CHECK(*words.getPtr(string_view("w5")) == 5);
+    CHECK(words.lower_bound(string_view("w10"))->first == "w10");
+    CHECK(words.upper_bound("w99")->first == "w990");
+}
+
+// -----------------------------------------------------------------------
+
+/* counted
+ * a value that counts its copy constructions and
+ * copy assignments; moves are free
+*/
+struct counted {
+    static long copies;
+    int v;
+
+    counted() : v(0) {}
+    counted(int value) : v(value) {}
+    counted(const counted& other) : v(other.v) { copies++; }
+    counted(counted&& other) noexcept : v(other.v) {}
+    counted& operator=(const counted& other) {
+        v = other.v;
+        copies++;
+        return *this;
+    }
+    counted& operator=(counted&& other) noexcept {
+        v = other.v;
+        return *this;
+    }
+};
+
+long counted::copies = 0;
+
+static void testNoCopies() {
+    mymap<string, counted> m;
+
+    for (int i = 0; i < 1000; i++) {
+        m.put(to_string(i), counted(i));
+        m.try_emplace(to_string(i), -1);  // already there, left alone
+        m.try_emplace(to_string(-i - 1), i);
+        m.emplace(to_string(i + 5000), i);
+        m[to_string(i)].v++;
+    }
+    CHECK(counted::copies == 0);
+    CHECK(m.Size() == 3000 && m.get("7").v == 8 && m.get("-8").v == 7);
+
+    // a move-only value goes in and comes out by reference
+    mymap<string, unique_ptr<int>> owners;
+    for (int i = 0; i < 500; i++) {
+        string key = to_string(i);
+        owners.put(std::move(key), unique_ptr<int>(new int(i)));
+    }
+    auto r = owners.try_emplace("250");
+    CHECK(!r.second && *r.first->second == 250);
+    owners["9999"].reset(new int(9999));
+    CHECK(owners.Size() == 501 && **owners.getPtr("9999") == 9999);
+}
+
+// -----------------------------------------------------------------------
+
+/* testPolicy
+ * the whole suite for one choice of policies; alpha
+ * is the weight balance Balance keeps
+*/
+template<typename Stats, typename Balance>
+static void testPolicy(double alpha) {
+    typedef policyMap<Stats, Balance> Map;
+
+    for (int lazy = 0; lazy < 2; lazy++) {
+        for (uint64_t s = 1; s <= 3; s++)
+            testRandom<Balance, Map>(s, lazy == 1);
+        testCopy<Balance, Map>(4, lazy == 1);
+        testBatch<Balance, Map>(6, lazy == 1);
+        testParallel<Map>(lazy == 1);
+        testSetOps<Balance, Map>(lazy == 1);
+    }
+    testShape<Balance, Map>(alpha);
+    testErase<Balance, Map>();
+    testIterators<Map>();
+    testMove<Map>(5);
+}
+
+// -----------------------------------------------------------------------
+
+int main() {
+    testPolicy<mymap_no_stats, mymap_seesaw_balance>(2.0 / 3);
+    testPolicy<mymap_stats, mymap_seesaw_balance>(2.0 / 3);
+    testPolicy<mymap_no_stats, mymap_alpha_balance<3, 4>>(3.0 / 4);
+    testPolicy<mymap_stats, mymap_alpha_balance<3, 4>>(3.0 / 4);
+    testPolicy<mymap_no_stats, mymap_scapegoat_balance<>>(2.0 / 3);
+    testPolicy<mymap_stats, mymap_scapegoat_balance<>>(2.0 / 3);
+    testStats();
+    testBalanceCosts();
+    testThrowingBatch();
+    testThrowingSetOps();
+    testCompare();
+    testNoCopies();
+    return 0;
+}
+
+// -----------------------------------------------------------------------
@@ -0,0 +1,144 @@
+// -----------------------------------------------------------------------
+
+// mymap - tests/test_persistent.cpp
+//
+// persistent_mymap against std::map: without
+// snapshots a put copies no node (rebuilds relink
+// nodes in place) and the shapes match mymap's; with
+// snapshots taken and released along the way every
+// version keeps its own contents, and every node is
+// freed once the last version holding it is gone.
+
+// -----------------------------------------------------------------------
+
+#include <map>
+#include <vector>
+#include <utility>
+#include "mymap.h"
+#include "persistent_mymap.h"
+#include "myrandom.h"
+#include "check.h"
+using namespace std;
+
+// -----------------------------------------------------------------------
+
+/* tracked
+ * a value that counts its live objects and its copy
+ * constructions, each of which is a node being made
+*/
+struct tracked {
+    static long live;
+    static long copies;
+    int v;
+
+    tracked() : v(0) { live++; }
+    tracked(int value) : v(value) { live++; }
+    tracked(const tracked& other) : v(other.v) {
+        live++;
+        copies++;
+    }
+    tracked& operator=(const tracked& other) {
+        v = other.v;
+        return *this;
+    }
+    ~tracked() { live--; }
+};
+
+long tracked::live = 0;
+long tracked::copies = 0;
+
+typedef persistent_mymap<int, tracked> trackedMap;
+
+// -----------------------------------------------------------------------
+
+static void checkSame(const trackedMap& m, const map<int, int>& expected) {
+    CHECK(m.Size() == int(expected.size()));
+
+    auto it = expected.begin();
+    bool same = true;
+    m.forEach([&it, &expected, &same](const int& k, const tracked& v) {
+        same = same && it != expected.end() && k == it->first
+            && v.v == it->second;
+        if (it != expected.end())
+            ++it;
+    });
+    CHECK(same && it == expected.end());
+}
+
+// -----------------------------------------------------------------------
+
+static void testNoSnapshots() {
+    {
+        trackedMap m;
+        mymap<int, int> shape;
+        map<int, int> expected;
+        xoshiro256 gen(22);
+
+        // ascending keys rebuild often, random keys now and then
+        for (int i = 0; i < 30000; i++) {
+            int key = (i < 10000) ? i : int(gen.below(40000));
+            bool isNew = expected.count(key) == 0;
+            long before = tracked::copies;
+
+            m.put(key, tracked(i));
+            shape.put(key, i);
+            expected[key] = i;
+            CHECK(tracked::copies - before == (isNew ? 1 : 0));
+        }
+        checkSame(m, expected);
+        CHECK(m.checkBalance() == shape.checkBalance());
+        CHECK(tracked::live == long(expected.size()));
+    }
+    CHECK(tracked::live == 0);
+}
+
+// -----------------------------------------------------------------------
+
+static void testSnapshots() {
+    {
+        trackedMap m;
+        map<int, int> expected;
+        vector<pair<trackedMap, map<int, int>>> versions;
+        xoshiro256 gen(7);
+
+        for (int i = 0; i < 40000; i++) {
+            int key = int(gen.below(20000));
+            m.put(key, tracked(i));
+            expected[key] = i;
+
+            if (i % 997 == 0)
+                versions.push_back(make_pair(m.snapshot(), expected));
+
+            // let go of an older version now and then, so its nodes
+            // become this version's own again
+            if (i % 2503 == 0 && versions.size() > 2)
+                versions.erase(versions.begin() + versions.size() / 2);
+        }
+        checkSame(m, expected);
+        for (size_t v = 0; v < versions.size(); v++)
+            checkSame(versions[v].first, versions[v].second);
+
+        // with every snapshot gone, puts change nodes in place again
+        versions.clear();
+        long before = tracked::copies;
+        long added = 0;
+        for (int key = -1000; key < 1000; key++) {
+            added += expected.count(key) == 0;
+            m.put(key, tracked(-key));
+            expected[key] = -key;
+        }
+        CHECK(tracked::copies - before == added);
+        checkSame(m, expected);
+    }
+    CHECK(tracked::live == 0);
+}
+
+// -----------------------------------------------------------------------
+
+int main() {
+    testNoSnapshots();
+    testSnapshots();
+    return 0;
+}
+
+// -----------------------------------------------------------------------
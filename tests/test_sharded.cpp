@@ -0,0 +1,180 @@
+// -----------------------------------------------------------------------
+
+// mymap - tests/test_sharded.cpp
+//
+// sharded_mymap against std::map: split points must
+// adapt to skewed writes with as few as two shards,
+// concurrent writers (putBatch too) must leave
+// every key in global order and Size() exact, and
+// readers must find every key while keys move
+// between shards under them.
+
+// -----------------------------------------------------------------------
+
+#include <map>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <utility>
+#include "sharded_mymap.h"
+#include "myrandom.h"
+#include "check.h"
+using namespace std;
+
+// -----------------------------------------------------------------------
+
+static void checkSame(const sharded_mymap<int, int>& m,
+    const map<int, int>& expected) {
+    CHECK(m.Size() == int(expected.size()));
+
+    vector<pair<int, int>> all = m.toVector();
+    CHECK(all.size() == expected.size());
+    auto it = expected.begin();
+    for (size_t i = 0; i < all.size(); i++, ++it)
+        CHECK(all[i].first == it->first && all[i].second == it->second);
+}
+
+// -----------------------------------------------------------------------
+
+/* largestShare
+ * the largest shard's size over the map's size
+*/
+static double largestShare(const sharded_mymap<int, int>& m) {
+    int largest = 0;
+    for (int i = 0; i < m.shardCount(); i++)
+        largest = max(largest, m.shardSize(i));
+    return double(largest) / m.Size();
+}
+
+// -----------------------------------------------------------------------
+
+static void testSkewedTwoShards() {
+    // ascending keys: every put lands at the top of the key range
+    sharded_mymap<int, int> ascending(2);
+    map<int, int> expected;
+    for (int i = 0; i < 100000; i++) {
+        ascending.put(i, -i);
+        expected[i] = -i;
+    }
+    CHECK(ascending.shardSize(0) > 0 && ascending.shardSize(1) > 0);
+    CHECK(largestShare(ascending) <= 0.75);
+    checkSame(ascending, expected);
+
+    // 9 in 10 writes go to a narrow hot range
+    sharded_mymap<int, int> hot(2);
+    expected.clear();
+    xoshiro256 gen(10);
+    for (int i = 0; i < 100000; i++) {
+        int key = (i % 10 != 0) ? 1000000 + int(gen.below(50000))
+            : int(gen.below(1000000));
+        hot.put(key, i);
+        expected[key] = i;
+    }
+    CHECK(largestShare(hot) <= 0.75);
+    checkSame(hot, expected);
+}
+
+// -----------------------------------------------------------------------
+
+static void testConcurrentWriters() {
+    const int threads = 4;
+    const int perThread = 20000;
+    sharded_mymap<int, int> m(3);
+
+    // each thread owns the keys = t (mod threads); half are written one
+    // by one, the rest in batches. the keys are skewed to the top. a
+    // value only depends on its key, so the order of writes to a key
+    // does not matter
+    vector<thread> writers;
+    for (int t = 0; t < threads; t++) {
+        writers.push_back(thread([&m, t] {
+            xoshiro256 gen(uint64_t(t) + 1);
+            vector<pair<int, int>> batch;
+            for (int i = 0; i < perThread; i++) {
+                int key = int(gen.below(1 << 20)) | (i % 4 == 0 ? 0 : 1 << 24);
+                key = key - key % threads + t;
+                if (i % 2 == 0) {
+                    m.put(key, key / 3);
+                } else {
+                    batch.push_back(make_pair(key, key / 3));
+                    if (batch.size() == 64) {
+                        m.putBatch(batch.begin(), batch.end());
+                        batch.clear();
+                    }
+                }
+            }
+            m.putBatch(batch.begin(), batch.end());
+        }));
+    }
+    for (thread& w : writers)
+        w.join();
+
+    // replay the same writes in order for the expected contents
+    map<int, int> expected;
+    for (int t = 0; t < threads; t++) {
+        xoshiro256 gen(uint64_t(t) + 1);
+        for (int i = 0; i < perThread; i++) {
+            int key = int(gen.below(1 << 20)) | (i % 4 == 0 ? 0 : 1 << 24);
+            key = key - key % threads + t;
+            expected[key] = key / 3;
+        }
+    }
+    checkSame(m, expected);
+    CHECK(largestShare(m) <= 0.5 + 0.01);
+}
+
+// -----------------------------------------------------------------------
+
+static void testReadersDuringMoves() {
+    const int readers = 3;
+    const int n = 40000;
+    sharded_mymap<int, int> m(6);
+    map<int, int> expected;
+
+    // even keys, spread out, before the readers start
+    for (int i = 0; i < n; i++) {
+        m.put(2 * i, i);
+        expected[2 * i] = i;
+    }
+
+    // the writer puts odd keys into the top shard's range, so keys keep
+    // moving down toward the other shards
+    atomic<bool> done(false);
+    atomic<long> misses(0);
+    vector<thread> threads;
+    for (int t = 0; t < readers; t++) {
+        threads.push_back(thread([&m, &done, &misses, t, n] {
+            xoshiro256 gen(uint64_t(t) + 70);
+            while (!done.load()) {
+                int i = int(gen.below(uint64_t(n)));
+                if (!m.contains(2 * i) || m.get(2 * i) != i)
+                    misses.fetch_add(1);
+            }
+        }));
+    }
+
+    xoshiro256 gen(69);
+    for (int i = 0; i < 3 * n; i++) {
+        int key = 2 * (n - n / 8 + int(gen.below(uint64_t(n) / 8))) + 1;
+        m.put(key, i);
+        expected[key] = i;
+    }
+    done.store(true);
+    for (thread& t : threads)
+        t.join();
+
+    CHECK(misses.load() == 0);
+    checkSame(m, expected);
+    CHECK(largestShare(m) <= 0.25 + 0.01);
+}
+
+// -----------------------------------------------------------------------
+
+int main() {
+    testSkewedTwoShards();
+    testConcurrentWriters();
+    testReadersDuringMoves();
+    return 0;
+}
+
+// -----------------------------------------------------------------------
@@ -0,0 +1,234 @@
+// -----------------------------------------------------------------------
+
+// mymap - tests/test_snapshot.cpp
+//
+// save / load round trips and the corruptions load
+// must reject: a changed header field fails the
+// checksum, and a count that does not match the
+// records is caught even when the checksum was made
+// to match, or, in a version 1 file, is too large
+// for the payload. A failed load leaves the map
+// unchanged; a failed save leaves the old snapshot
+// and no temporary file behind.
+
+// -----------------------------------------------------------------------
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <stdexcept>
+#include <cstdio>
+#include "mymap.h"
+#include "mapped_mymap.h"
+#include "check.h"
+using namespace std;
+
+static const char* path = "test_snapshot.snap";
+
+/* fuse
+ * a value whose serializer throws when it is
+ * negative, to fail a save midway
+*/
+struct fuse {
+    int v;
+};
+
+template<>
+struct mymap_serializer<fuse> {
+    static const uint32_t fixedSize = 0;
+
+    template<typename Out>
+    static void write(Out& out, const fuse& value) {
+        if (value.v < 0)
+            throw runtime_error("fuse blown");
+        out.write(&value.v, sizeof(value.v));
+    }
+
+    static const char* read(const char* in, const char* end, fuse& value) {
+        return mymap_serializer<int>::read(in, end, value.v);
+    }
+};
+
+// -----------------------------------------------------------------------
+
+static vector<char> readFile(const char* name) {
+    ifstream in(name, ios::binary);
+    return vector<char>(istreambuf_iterator<char>(in),
+        istreambuf_iterator<char>());
+}
+
+static void writeFile(const char* name, const vector<char>& bytes) {
+    ofstream out(name, ios::binary | ios::trunc);
+    out.write(bytes.data(), streamsize(bytes.size()));
+}
+
+// -----------------------------------------------------------------------
+
+/* setCount
+ * rewrites the header's count; with fixChecksum the
+ * checksum is recomputed, as a forger would
+*/
+static void setCount(vector<char>& bytes, uint64_t count,
+    bool fixChecksum) {
+    mymap_snapshot_header header;
+    memcpy(&header, bytes.data(), sizeof(header));
+    header.count = count;
+
+    if (fixChecksum) {
+        mymap_checksum payload;
+        payload.update(bytes.data() + sizeof(header),
+            bytes.size() - sizeof(header));
+        header.checksum = mymap_snapshot_checksum(header, payload.value());
+    }
+    memcpy(bytes.data(), &header, sizeof(header));
+}
+
+// -----------------------------------------------------------------------
+
+template<typename K, typename V>
+static bool loadFails(mymap<K, V>& m) {
+    try {
+        m.load(path);
+    } catch (const runtime_error&) {
+        return true;
+    }
+    return false;
+}
+
+// -----------------------------------------------------------------------
+
+static void testStrings() {
+    mymap<string, string> m;
+    for (int i = 0; i < 5; i++)
+        m.put("key" + to_string(i), string(size_t(i) * 3, 'v'));
+    m.save(path);
+
+    mymap<string, string> loaded;
+    loaded.load(path);
+    CHECK(loaded.Size() == 5);
+    CHECK(loaded.toString() == m.toString());
+
+    vector<char> good = readFile(path);
+    mymap<string, string> target;
+    target.put("stays", "put");
+
+    // a bumped count fails the checksum ...
+    vector<char> bytes = good;
+    setCount(bytes, 7, false);
+    writeFile(path, bytes);
+    CHECK(loadFails(target));
+
+    // ... and with a matching checksum the payload runs out first
+    setCount(bytes, 7, true);
+    writeFile(path, bytes);
+    CHECK(loadFails(target));
+
+    // too small a count leaves records over
+    bytes = good;
+    setCount(bytes, 4, true);
+    writeFile(path, bytes);
+    CHECK(loadFails(target));
+
+    // a changed payload byte fails the checksum
+    bytes = good;
+    bytes.back() ^= 1;
+    writeFile(path, bytes);
+    CHECK(loadFails(target));
+
+    // a version 1 count is not checksummed: one too large for the
+    // payload fails before anything is sized by it
+    bytes = good;
+    mymap_snapshot_header header;
+    memcpy(&header, bytes.data(), sizeof(header));
+    header.version = 1;
+    header.count = uint64_t(INT32_MAX);
+    mymap_checksum payload;
+    payload.update(bytes.data() + sizeof(header),
+        bytes.size() - sizeof(header));
+    header.checksum = payload.value();
+    memcpy(bytes.data(), &header, sizeof(header));
+    writeFile(path, bytes);
+    CHECK(loadFails(target));
+
+    CHECK(target.Size() == 1 && target.get("stays") == "put");
+}
+
+// -----------------------------------------------------------------------
+
+static void testFixedSize() {
+    mymap<int, double> m;
+    for (int i = 0; i < 10000; i++)
+        m.put(i * 7 % 10007, i * 0.5);
+    m.save(path);
+
+    mymap<int, double> loaded;
+    loaded.load(path);
+    CHECK(loaded.toString() == m.toString());
+
+    mapped_mymap<int, double> mapped(path);
+    CHECK(mapped.Size() == 10000 && mapped.get(7) == 0.5);
+
+    vector<char> bytes = readFile(path);
+    setCount(bytes, 10001, true);
+    writeFile(path, bytes);
+    CHECK(loadFails(loaded));
+    CHECK(loaded.Size() == 10000);
+
+    // version 1 files, checksummed over the payload only, still load
+    bytes = readFile(path);
+    mymap_snapshot_header header;
+    memcpy(&header, bytes.data(), sizeof(header));
+    header.version = 1;
+    header.count = 10000;
+    mymap_checksum payload;
+    payload.update(bytes.data() + sizeof(header),
+        bytes.size() - sizeof(header));
+    header.checksum = payload.value();
+    memcpy(bytes.data(), &header, sizeof(header));
+    writeFile(path, bytes);
+
+    mymap<int, double> old;
+    old.load(path);
+    CHECK(old.toString() == m.toString());
+}
+
+// -----------------------------------------------------------------------
+
+static void testFailedSave() {
+    mymap<int, fuse> m;
+    for (int i = 0; i < 1000; i++)
+        m.put(i, fuse{i});
+    m.save(path);
+    vector<char> good = readFile(path);
+
+    // the save throws midway, after a buffer has been written out
+    for (int i = 0; i < 300000; i++)
+        m.put(i, fuse{i});
+    m.put(299990, fuse{-1});
+    bool threw = false;
+    try {
+        m.save(path);
+    } catch (const runtime_error&) {
+        threw = true;
+    }
+    CHECK(threw);
+    CHECK(readFile(path) == good);
+    FILE* tmp = fopen((string(path) + ".tmp").c_str(), "rb");
+    CHECK(tmp == nullptr);
+
+    mymap<int, fuse> loaded;
+    loaded.load(path);
+    CHECK(loaded.Size() == 1000 && loaded.get(999).v == 999);
+}
+
+// -----------------------------------------------------------------------
+
+int main() {
+    testStrings();
+    testFixedSize();
+    testFailedSave();
+    remove(path);
+    return 0;
+}
+
+// -----------------------------------------------------------------------
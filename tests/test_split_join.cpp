@@ -0,0 +1,126 @@
+// -----------------------------------------------------------------------
+
+// mymap - tests/test_split_join.cpp
+//
+// split and join against std::map: many split /
+// join cycles of one map (the shard rebalancing
+// pattern, whose shared node storage must not grow
+// with the number of cycles) and joins that are
+// rejected, which must leave both maps as they were.
+
+// -----------------------------------------------------------------------
+
+#include <map>
+#include <vector>
+#include <stdexcept>
+#include <utility>
+#include "mymap.h"
+#include "myrandom.h"
+#include "check.h"
+using namespace std;
+
+// -----------------------------------------------------------------------
+
+static void checkSame(mymap<int, int>& m, const map<int, int>& expected) {
+    CHECK(m.Size() == int(expected.size()));
+
+    auto it = expected.begin();
+    for (const auto& kv : m) {
+        CHECK(it != expected.end());
+        CHECK(kv.first == it->first && kv.second == it->second);
+        ++it;
+    }
+    CHECK(it == expected.end());
+}
+
+// -----------------------------------------------------------------------
+
+static void testCycles(bool lazyErase) {
+    xoshiro256 gen(21);
+    mymap<int, int> m;
+    map<int, int> expected;
+    m.setLazyErase(lazyErase);
+
+    for (int i = 0; i < 1000; i++) {
+        int key = int(gen.below(4000));
+        m.put(key, i);
+        expected[key] = i;
+    }
+
+    // each cycle cuts the map at a random key and joins the halves
+    // back; every 10th cycle also writes to both halves first
+    for (int cycle = 0; cycle < 2000; cycle++) {
+        int cut = int(gen.below(4000));
+        mymap<int, int> upper = m.split(cut);
+
+        if (cycle % 10 == 0) {
+            int low = int(gen.below(uint64_t(cut) + 1));
+            int high = cut + int(gen.below(uint64_t(4000 - cut)));
+            if (low < cut) {
+                m.put(low, -cycle);
+                expected[low] = -cycle;
+            }
+            upper.put(high, cycle);
+            expected[high] = cycle;
+
+            int gone = int(gen.below(4000));
+            (gone < cut ? m : upper).erase(gone);
+            expected.erase(gone);
+        }
+
+        m = mymap<int, int>::join(std::move(m), std::move(upper));
+        CHECK(upper.Size() == 0);
+        if (cycle % 100 == 0)
+            checkSame(m, expected);
+    }
+    checkSame(m, expected);
+}
+
+// -----------------------------------------------------------------------
+
+static void testRejectedJoin() {
+    mymap<int, int> left;
+    mymap<int, int> right;
+    map<int, int> leftExpected;
+    map<int, int> rightExpected;
+
+    for (int i = 0; i < 100; i++) {
+        left.put(i, i);
+        leftExpected[i] = i;
+        right.put(i + 50, -i);
+        rightExpected[i + 50] = -i;
+    }
+
+    bool threw = false;
+    try {
+        mymap<int, int>::join(std::move(left), std::move(right));
+    } catch (const invalid_argument&) {
+        threw = true;
+    }
+    CHECK(threw);
+    checkSame(left, leftExpected);
+    checkSame(right, rightExpected);
+
+    // tombstones overlapping is not an overlap, they are compacted
+    left.setLazyErase(true);
+    for (int i = 50; i < 100; i++) {
+        left.erase(i);
+        leftExpected.erase(i);
+    }
+    mymap<int, int> joined = mymap<int, int>::join(std::move(left),
+        std::move(right));
+    map<int, int> all(leftExpected);
+    all.insert(rightExpected.begin(), rightExpected.end());
+    checkSame(joined, all);
+}
+
+// -----------------------------------------------------------------------
+
+int main() {
+    testCycles(false);
+    testCycles(true);
+    testRejectedJoin();
+    return 0;
+}
+
+// -----------------------------------------------------------------------